@@ -0,0 +1,112 @@
+#type compute
+#version 450 core
+// Clustered forward lighting: the view frustum is split in CLUSTER_X * CLUSTER_Y screen tiles and
+// CLUSTER_Z exponential depth slices. One invocation per cluster builds the view space box of its
+// cluster and keeps the point lights whose sphere touches it. The lights are loaded in shared memory
+// in batches, each batch is tested by the whole group. Constants match Renderer.h.
+// A cluster keeps its first MAX_LIGHTS_PER_CLUSTER lights, the ones past it are counted in ClusterOverflow
+
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 128
+#define GROUP_SIZE 64
+
+layout(local_size_x = GROUP_SIZE) in;
+
+struct PointLight {
+    vec4 positionRadius;	// World space position, radius in w
+    vec4 colorIntensity;
+};
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 u_ViewProjection;
+    mat4 u_View;
+    mat4 u_Projection;
+    vec4 u_FrustumPlanes[6];
+    vec4 u_CameraPosition;
+};
+
+layout(std430, binding = 5) readonly buffer Lights { PointLight lights[]; };
+layout(std430, binding = 6) writeonly buffer ClusterLights { uint clusterLights[]; };	// MAX_LIGHTS_PER_CLUSTER per cluster
+layout(std430, binding = 7) writeonly buffer ClusterCounts { uint clusterCounts[]; };
+layout(std430, binding = 8) buffer ClusterOverflow {
+    uint overflowClusters;
+    uint droppedLights;
+};
+
+uniform mat4 u_InverseProjection;
+uniform int u_LightCount;
+uniform float u_Near;
+uniform float u_Far;
+
+shared vec4 s_Lights[GROUP_SIZE];	// View space position, radius in w
+
+// View space point on the ray through an NDC position, at a view space depth (positive)
+vec3 pointAtDepth(vec2 ndc, float depth)
+{
+    vec4 onNearPlane = u_InverseProjection * vec4(ndc, -1.0, 1.0);
+    vec3 direction = onNearPlane.xyz / onNearPlane.w;
+    return direction * (depth / -direction.z);
+}
+
+void main()
+{
+    const uint clusterCount = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+    uint cluster = gl_GlobalInvocationID.x;
+    bool valid = cluster < clusterCount;
+
+    // Box of the cluster in view space
+    uint x = cluster % CLUSTER_X;
+    uint y = (cluster / CLUSTER_X) % CLUSTER_Y;
+    uint z = cluster / (CLUSTER_X * CLUSTER_Y);
+
+    vec2 ndcMin = vec2(x, y) / vec2(CLUSTER_X, CLUSTER_Y) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(x + 1, y + 1) / vec2(CLUSTER_X, CLUSTER_Y) * 2.0 - 1.0;
+    float sliceNear = u_Near * pow(u_Far / u_Near, float(z) / CLUSTER_Z);
+    float sliceFar = u_Near * pow(u_Far / u_Near, float(z + 1) / CLUSTER_Z);
+
+    vec3 boxMin = vec3(1e30);
+    vec3 boxMax = vec3(-1e30);
+    for (int corner = 0; corner < 4; corner++) {
+        vec2 ndc = vec2((corner & 1) != 0 ? ndcMax.x : ndcMin.x, (corner & 2) != 0 ? ndcMax.y : ndcMin.y);
+        vec3 nearPoint = pointAtDepth(ndc, sliceNear);
+        vec3 farPoint = pointAtDepth(ndc, sliceFar);
+        boxMin = min(boxMin, min(nearPoint, farPoint));
+        boxMax = max(boxMax, max(nearPoint, farPoint));
+    }
+
+    uint count = 0;
+    uint touching = 0;
+    for (int batch = 0; batch < u_LightCount; batch += GROUP_SIZE) {
+        int index = batch + int(gl_LocalInvocationID.x);
+        if (index < u_LightCount) {
+            vec4 light = lights[index].positionRadius;
+            s_Lights[gl_LocalInvocationID.x] = vec4((u_View * vec4(light.xyz, 1.0)).xyz, light.w);
+        }
+        barrier();
+
+        int batchSize = min(GROUP_SIZE, u_LightCount - batch);
+        for (int i = 0; i < batchSize && valid; i++) {
+            vec4 light = s_Lights[i];
+            vec3 closest = clamp(light.xyz, boxMin, boxMax);
+            vec3 offset = closest - light.xyz;
+            if (dot(offset, offset) <= light.w * light.w) {
+                if (count < MAX_LIGHTS_PER_CLUSTER) {
+                    clusterLights[cluster * MAX_LIGHTS_PER_CLUSTER + count] = uint(batch + i);
+                    count++;
+                }
+                touching++;
+            }
+        }
+        barrier();
+    }
+
+    if (valid) {
+        clusterCounts[cluster] = count;
+        if (touching > count) {
+            atomicAdd(overflowClusters, 1u);
+            atomicAdd(droppedLights, touching - count);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#type compute
+#version 450 core
+// Frustum culls every queued instance and compacts the visible ones into the instance buffer used
+// by the indirect draws. Each command owns the range [baseInstance, baseInstance + capacity) and
+// instanceCount is used as the atomic insertion counter (the CPU resets it to 0 every frame).
+// When occlusion culling is enabled, boxes are also tested against the Hi-Z pyramid (see hiz.glsl)
+
+layout(local_size_x = 64) in;
+
+// Must match InstanceData in Renderer.h
+struct InstanceData {
+    mat4 transform;
+    vec4 color;
+    vec4 normalMatrix[3];
+};
+
+struct InstanceBounds {
+    vec3 min;
+    uint command;
+    vec3 max;
+    uint flags;		// 1 = occluder
+};
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int  baseVertex;
+    uint baseInstance;
+};
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 u_ViewProjection;
+    mat4 u_View;
+    mat4 u_Projection;
+    vec4 u_FrustumPlanes[6];
+    vec4 u_CameraPosition;
+};
+
+layout(std430, binding = 1) readonly buffer Instances { InstanceData instances[]; };
+layout(std430, binding = 2) readonly buffer Bounds { InstanceBounds bounds[]; };
+layout(std430, binding = 3) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 4) writeonly buffer VisibleInstances { InstanceData visible[]; };
+
+layout(binding = 0, offset = 0) uniform atomic_uint u_VisibleCount;
+layout(binding = 0, offset = 4) uniform atomic_uint u_OccludedCount;
+
+layout(binding = 0) uniform sampler2D u_HiZ;
+
+uniform int u_InstanceCount;
+uniform bool u_OcclusionCulling;
+
+bool isVisible(vec3 minBound, vec3 maxBound)
+{
+    vec3 center = (minBound + maxBound) * 0.5;
+    vec3 extent = (maxBound - minBound) * 0.5;
+
+    for (int i = 0; i < 6; i++) {
+        vec4 plane = u_FrustumPlanes[i];
+        float dist = dot(plane.xyz, center) + plane.w;
+        float radius = dot(abs(plane.xyz), extent);
+        if (dist + radius < 0.0)
+            return false;
+    }
+    return true;
+}
+
+bool isOccluded(vec3 minBound, vec3 maxBound)
+{
+    // Screen space rectangle and nearest depth of the box
+    vec3 screenMin = vec3(1.0);
+    vec3 screenMax = vec3(0.0);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = vec3((i & 1) != 0 ? maxBound.x : minBound.x,
+                           (i & 2) != 0 ? maxBound.y : minBound.y,
+                           (i & 4) != 0 ? maxBound.z : minBound.z);
+        vec4 clip = u_ViewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false;	// Crosses the camera plane
+
+        vec3 screen = clip.xyz / clip.w * 0.5 + 0.5;
+        screenMin = min(screenMin, screen);
+        screenMax = max(screenMax, screen);
+    }
+    screenMin = clamp(screenMin, 0.0, 1.0);
+    screenMax = clamp(screenMax, 0.0, 1.0);
+
+    // Pick the level where the rectangle spans at most 2x2 texels
+    vec2 size = (screenMax.xy - screenMin.xy) * vec2(textureSize(u_HiZ, 0));
+    int levels = textureQueryLevels(u_HiZ);
+    int level = min(int(ceil(log2(max(max(size.x, size.y), 1.0)))), levels - 1);
+
+    ivec2 levelSize = textureSize(u_HiZ, level);
+    ivec2 low = clamp(ivec2(screenMin.xy * vec2(levelSize)), ivec2(0), levelSize - 1);
+    ivec2 high = clamp(ivec2(screenMax.xy * vec2(levelSize)), ivec2(0), levelSize - 1);
+
+    float farthest = max(max(texelFetch(u_HiZ, low, level).r, texelFetch(u_HiZ, ivec2(high.x, low.y), level).r),
+                         max(texelFetch(u_HiZ, ivec2(low.x, high.y), level).r, texelFetch(u_HiZ, high, level).r));
+
+    return screenMin.z > farthest;
+}
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(u_InstanceCount))
+        return;
+
+    InstanceBounds b = bounds[id];
+    if (!isVisible(b.min, b.max))
+        return;
+
+    if (u_OcclusionCulling && (b.flags & 1u) == 0u && isOccluded(b.min, b.max)) {
+        atomicCounterIncrement(u_OccludedCount);
+        return;
+    }
+
+    uint slot = atomicAdd(commands[b.command].instanceCount, 1u);
+    visible[commands[b.command].baseInstance + slot] = instances[id];
+    atomicCounterIncrement(u_VisibleCount);
+}
@@ -0,0 +1,144 @@
+#type vertex
+#version 450 core
+// Lighting pass of the deferred path: one full screen triangle, lit from the G-buffer written by
+// gbuffer.glsl. Same lighting as shader.glsl (sun and clustered point lights), paid once per pixel
+
+out vec2 v_UV;
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    v_UV = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+
+#type fragment
+#version 450 core
+
+// Must match shaders/cluster.glsl
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+layout(location = 0) out vec4 a_Color;
+
+in vec2 v_UV;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 colorIntensity;
+};
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 u_ViewProjection;
+    mat4 u_View;
+    mat4 u_Projection;
+    vec4 u_FrustumPlanes[6];
+    vec4 u_CameraPosition;
+};
+
+layout(std430, binding = 5) readonly buffer Lights { PointLight lights[]; };
+layout(std430, binding = 6) readonly buffer ClusterLights { uint clusterLights[]; };
+layout(std430, binding = 7) readonly buffer ClusterCounts { uint clusterCounts[]; };
+
+layout(binding = 0) uniform sampler2D u_Albedo;
+layout(binding = 1) uniform sampler2D u_Normal;
+layout(binding = 2) uniform sampler2D u_Depth;
+
+uniform mat4 u_InverseViewProjection;
+uniform vec3 u_LightPosition;
+uniform float u_AmbientStrength;
+uniform vec4 u_LightColor;
+
+uniform bool u_ClusteredLights;
+uniform vec4 u_ClusterParams;	// Depth slice scale and bias, viewport width and height
+
+layout(binding = 3) uniform sampler2DArrayShadow u_ShadowMap;
+uniform bool u_Shadows;
+uniform int u_CascadeCount;
+uniform vec4 u_CascadeSplits;		// View depth where every cascade ends
+uniform mat4 u_ShadowMatrices[4];
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// Same as shader.glsl, the cluster comes from the pixel and the rebuilt view depth
+vec3 pointLights(vec3 position, vec3 normal, float viewDepth)
+{
+    float slice = floor(log(max(viewDepth, 1e-4)) * u_ClusterParams.x + u_ClusterParams.y);
+    uvec3 cluster = uvec3(
+        uint(gl_FragCoord.x / u_ClusterParams.z * CLUSTER_X),
+        uint(gl_FragCoord.y / u_ClusterParams.w * CLUSTER_Y),
+        uint(clamp(slice, 0.0, CLUSTER_Z - 1.0)));
+    cluster = min(cluster, uvec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+    uint index = cluster.x + CLUSTER_X * (cluster.y + CLUSTER_Y * cluster.z);
+
+    vec3 result = vec3(0.0);
+    uint count = clusterCounts[index];
+    for (uint i = 0; i < count; i++) {
+        PointLight light = lights[clusterLights[index * MAX_LIGHTS_PER_CLUSTER + i]];
+        vec3 toLight = light.positionRadius.xyz - position;
+        float distance2 = dot(toLight, toLight);
+
+        float ratio = distance2 / (light.positionRadius.w * light.positionRadius.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / (distance2 + 1.0);
+
+        float diff = max(dot(normal, toLight * inversesqrt(max(distance2, 1e-8))), 0.0);
+        result += diff * attenuation * light.colorIntensity.rgb * light.colorIntensity.w;
+    }
+    return result;
+}
+
+// Same as shader.glsl: 1 when lit, 3x3 PCF where every tap compares 4 texels
+float shadow(vec3 position, float viewDepth)
+{
+    if (viewDepth > u_CascadeSplits[u_CascadeCount - 1])
+        return 1.0;
+
+    int cascade = 0;
+    while (cascade < u_CascadeCount - 1 && viewDepth > u_CascadeSplits[cascade])
+        cascade++;
+
+    vec4 coord = u_ShadowMatrices[cascade] * vec4(position, 1.0);
+    coord.xyz = coord.xyz / coord.w * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(u_ShadowMap, vec4(coord.xy + vec2(x, y) * texel, cascade, coord.z - 0.0002));
+    return lit / 9.0;
+}
+
+void main()
+{
+    float depth = texture(u_Depth, v_UV).r;
+    if (depth >= 1.0)
+        discard;	// Background, the skybox is drawn afterwards
+
+    vec4 clip = vec4(v_UV * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = u_InverseViewProjection * clip;
+    vec3 position = world.xyz / world.w;
+    vec3 normal = octDecode(texture(u_Normal, v_UV).rg);
+    vec4 albedo = texture(u_Albedo, v_UV);
+
+    vec3 lightColor = u_LightColor.xyz;
+    vec3 ambient = u_AmbientStrength * lightColor;
+    float diff = max(dot(normal, normalize(u_LightPosition - position)), 0.0);
+    vec3 diffuse = diff * lightColor;
+    float viewDepth = -(u_View * vec4(position, 1.0)).z;
+    if (u_Shadows)
+        diffuse *= shadow(position, viewDepth);
+    if (u_ClusteredLights)
+        diffuse += pointLights(position, normal, viewDepth);
+
+    a_Color = vec4(ambient + diffuse, 1.0) * albedo;
+    gl_FragDepth = depth;
+}
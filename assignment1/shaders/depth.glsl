@@ -0,0 +1,26 @@
+#type vertex
+#version 450 core
+// Depth only pass used to render the large occluders before building the Hi-Z pyramid
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 2) in mat4 a_Transform;
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 u_ViewProjection;
+    mat4 u_View;
+    mat4 u_Projection;
+    vec4 u_FrustumPlanes[6];
+    vec4 u_CameraPosition;
+};
+
+void main()
+{
+    gl_Position = u_ViewProjection * a_Transform * vec4(a_Position, 1.0);
+}
+
+#type fragment
+#version 450 core
+
+void main()
+{
+}
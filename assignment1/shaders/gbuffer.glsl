@@ -0,0 +1,55 @@
+#type vertex
+#version 450 core
+// Geometry pass of the deferred path: same inputs as shader.glsl, no lighting. The colour and
+// the normal are stored in the G-buffer, the position is rebuilt from the depth by deferred.glsl
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_Normal;
+
+// Per instance attributes (see Renderer::submit)
+layout(location = 2) in mat4 a_Transform;
+layout(location = 6) in vec4 a_Color;
+layout(location = 7) in mat3 a_NormalMatrix;	// Inverse transpose of the model matrix, computed on the CPU
+layout(location = 10) in vec4 a_VertexColor;	// Colour of the part in merged meshes, white otherwise
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 u_ViewProjection;
+    mat4 u_View;
+    mat4 u_Projection;
+    vec4 u_FrustumPlanes[6];
+    vec4 u_CameraPosition;
+};
+
+out vec4 v_Color;
+out vec3 v_Normal;
+
+void main()
+{
+    v_Color = a_Color * a_VertexColor;
+    v_Normal = a_NormalMatrix * a_Normal;
+    gl_Position = u_ViewProjection * a_Transform * vec4(a_Position, 1.0);
+    gl_PointSize = 7.0;
+}
+
+#type fragment
+#version 450 core
+
+layout(location = 0) out vec4 o_Albedo;
+layout(location = 1) out vec2 o_Normal;
+
+in vec4 v_Color;
+in vec3 v_Normal;
+
+// Octahedral encoding: a unit vector in two signed components
+vec2 octEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : folded;
+}
+
+void main()
+{
+    o_Albedo = v_Color;
+    o_Normal = octEncode(normalize(v_Normal));
+}
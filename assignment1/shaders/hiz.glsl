@@ -0,0 +1,49 @@
+#type compute
+#version 450 core
+// Builds one level of the hierarchical depth pyramid. Each texel keeps the farthest depth
+// of the texels it covers in the previous level, so a box whose nearest depth is farther is hidden
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D u_Source;		// Depth buffer when u_SourceLevel < 0, otherwise the pyramid itself
+layout(r32f, binding = 0) uniform writeonly image2D u_Destination;
+
+uniform int u_SourceLevel;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(coord, imageSize(u_Destination))))
+        return;
+
+    if (u_SourceLevel < 0) {
+        imageStore(u_Destination, coord, vec4(texelFetch(u_Source, coord, 0).r));
+        return;
+    }
+
+    ivec2 sourceSize = textureSize(u_Source, u_SourceLevel);
+    ivec2 last = sourceSize - 1;
+    ivec2 source = coord * 2;
+
+    float depth = max(max(texelFetch(u_Source, min(source, last), u_SourceLevel).r,
+                          texelFetch(u_Source, min(source + ivec2(1, 0), last), u_SourceLevel).r),
+                      max(texelFetch(u_Source, min(source + ivec2(0, 1), last), u_SourceLevel).r,
+                          texelFetch(u_Source, min(source + ivec2(1, 1), last), u_SourceLevel).r));
+
+    // Odd sizes: the last texel of this level also covers the 3rd column/row of the previous one
+    ivec2 size = imageSize(u_Destination);
+    bool extraX = (sourceSize.x & 1) != 0 && coord.x == size.x - 1;
+    bool extraY = (sourceSize.y & 1) != 0 && coord.y == size.y - 1;
+    if (extraX) {
+        depth = max(depth, texelFetch(u_Source, min(source + ivec2(2, 0), last), u_SourceLevel).r);
+        depth = max(depth, texelFetch(u_Source, min(source + ivec2(2, 1), last), u_SourceLevel).r);
+    }
+    if (extraY) {
+        depth = max(depth, texelFetch(u_Source, min(source + ivec2(0, 2), last), u_SourceLevel).r);
+        depth = max(depth, texelFetch(u_Source, min(source + ivec2(1, 2), last), u_SourceLevel).r);
+    }
+    if (extraX && extraY)
+        depth = max(depth, texelFetch(u_Source, min(source + ivec2(2, 2), last), u_SourceLevel).r);
+
+    imageStore(u_Destination, coord, vec4(depth));
+}
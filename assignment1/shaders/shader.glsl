@@ -6,45 +6,136 @@
 layout(location = 0) in vec3 a_Position;
 layout(location = 1) in vec3 a_Normal;
 
-uniform vec4 u_Color;
-uniform mat4 u_ViewProjection;
-uniform mat4 u_Transform;
+// Per instance attributes (see Renderer::submit)
+layout(location = 2) in mat4 a_Transform;
+layout(location = 6) in vec4 a_Color;
+layout(location = 7) in mat3 a_NormalMatrix;	// Inverse transpose of the model matrix, computed on the CPU
+layout(location = 10) in vec4 a_VertexColor;	// Colour of the part in merged meshes, white otherwise
+
+layout(std140, binding = 0) uniform CameraData {
+    mat4 u_ViewProjection;
+    mat4 u_View;
+    mat4 u_Projection;
+    vec4 u_FrustumPlanes[6];
+    vec4 u_CameraPosition;
+};
 
 out vec4 v_Color;
-out vec4 v_Normal;
+out vec3 v_Normal;
 out vec3 v_FragPos; // for the light
+out float v_ViewDepth; // selects the cluster
 
 void main()
 {
-    v_Color = u_Color;
-    v_Normal = u_Transform * vec4(a_Normal, 1.0);
-    v_FragPos = vec3(u_Transform * vec4(a_Position, 1.0));
-    gl_Position = u_ViewProjection * u_Transform * vec4(a_Position, 1.0);
+    v_Color = a_Color * a_VertexColor;
+    v_Normal = a_NormalMatrix * a_Normal;
+    v_FragPos = vec3(a_Transform * vec4(a_Position, 1.0));
+    v_ViewDepth = -(u_View * vec4(v_FragPos, 1.0)).z;
+    gl_Position = u_ViewProjection * a_Transform * vec4(a_Position, 1.0);
     gl_PointSize = 7.0;
 }
 
 #type fragment
 #version 450 core
 
+// Must match shaders/cluster.glsl
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define MAX_LIGHTS_PER_CLUSTER 128
+
 layout(location = 0) out vec4 a_Color;
 
 in vec4 v_Color;
-in vec4 v_Normal; 
+in vec3 v_Normal;
 in vec3 v_FragPos; 
+in float v_ViewDepth;
+
+struct PointLight {
+    vec4 positionRadius;
+    vec4 colorIntensity;
+};
+
+layout(std430, binding = 5) readonly buffer Lights { PointLight lights[]; };
+layout(std430, binding = 6) readonly buffer ClusterLights { uint clusterLights[]; };
+layout(std430, binding = 7) readonly buffer ClusterCounts { uint clusterCounts[]; };
 
 uniform vec3 u_LightPosition;
 uniform float u_AmbientStrength;
 uniform vec4 u_LightColor;
 
+uniform bool u_ClusteredLights;
+uniform vec4 u_ClusterParams;	// Depth slice scale and bias, viewport width and height
+
+layout(binding = 3) uniform sampler2DArrayShadow u_ShadowMap;
+uniform bool u_Shadows;
+uniform int u_CascadeCount;
+uniform vec4 u_CascadeSplits;		// View depth where every cascade ends
+uniform mat4 u_ShadowMatrices[4];
+
+// Only the point lights of the cluster containing the fragment are evaluated
+vec3 pointLights(vec3 normal)
+{
+    float slice = floor(log(max(v_ViewDepth, 1e-4)) * u_ClusterParams.x + u_ClusterParams.y);
+    uvec3 cluster = uvec3(
+        uint(gl_FragCoord.x / u_ClusterParams.z * CLUSTER_X),
+        uint(gl_FragCoord.y / u_ClusterParams.w * CLUSTER_Y),
+        uint(clamp(slice, 0.0, CLUSTER_Z - 1.0)));
+    cluster = min(cluster, uvec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+    uint index = cluster.x + CLUSTER_X * (cluster.y + CLUSTER_Y * cluster.z);
+
+    vec3 result = vec3(0.0);
+    uint count = clusterCounts[index];
+    for (uint i = 0; i < count; i++) {
+        PointLight light = lights[clusterLights[index * MAX_LIGHTS_PER_CLUSTER + i]];
+        vec3 toLight = light.positionRadius.xyz - v_FragPos;
+        float distance2 = dot(toLight, toLight);
+
+        // Smooth window, reaches 0 at the radius
+        float ratio = distance2 / (light.positionRadius.w * light.positionRadius.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / (distance2 + 1.0);
+
+        float diff = max(dot(normal, toLight * inversesqrt(max(distance2, 1e-8))), 0.0);
+        result += diff * attenuation * light.colorIntensity.rgb * light.colorIntensity.w;
+    }
+    return result;
+}
+
+// Cascaded shadow maps of the scene light (see Renderer::buildShadowMaps). 1 when lit, 3x3 PCF where every tap compares 4 texels
+float shadow(vec3 position, float viewDepth)
+{
+    if (viewDepth > u_CascadeSplits[u_CascadeCount - 1])
+        return 1.0;
+
+    int cascade = 0;
+    while (cascade < u_CascadeCount - 1 && viewDepth > u_CascadeSplits[cascade])
+        cascade++;
+
+    vec4 coord = u_ShadowMatrices[cascade] * vec4(position, 1.0);
+    coord.xyz = coord.xyz / coord.w * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(u_ShadowMap, 0).xy);
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(u_ShadowMap, vec4(coord.xy + vec2(x, y) * texel, cascade, coord.z - 0.0002));
+    return lit / 9.0;
+}
+
 void main()
 {
     vec3 lightColor = u_LightColor.xyz;
     vec3 ambient = u_AmbientStrength * lightColor;
 
-    vec4 norm = normalize(v_Normal);
+    vec3 norm = normalize(v_Normal);
     vec3 lightDir = normalize(u_LightPosition - v_FragPos);
-    float diff = max(dot(norm.xyz, lightDir), 0.0);
+    float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
+    if (u_Shadows)
+        diffuse *= shadow(v_FragPos, v_ViewDepth);
+    if (u_ClusteredLights)
+        diffuse += pointLights(norm);
     vec4 result = vec4(ambient + diffuse, 1.0) * v_Color;
     a_Color = result;
 
@@ -0,0 +1,20 @@
+#type vertex
+#version 450 core
+// Depth only pass of one shadow cascade, drawn from the scene light
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 2) in mat4 a_Transform;
+
+uniform mat4 u_LightViewProjection;
+
+void main()
+{
+    gl_Position = u_LightViewProjection * a_Transform * vec4(a_Position, 1.0);
+}
+
+#type fragment
+#version 450 core
+
+void main()
+{
+}
@@ -0,0 +1,58 @@
+#type compute
+#version 450 core
+// Decodes a cooked mesh (see MeshCooker.h) into the mesh arena: the vertex and index sections are
+// read as they are in the file. Positions are dequantised over the bounds, normals are octahedral
+// and 16-bit indices come in pairs. Each invocation handles one vertex and one index per pass.
+// Indices past the vertex count (a corrupt file) become 0, the mesh never reads another one's vertices
+
+#define GROUP_SIZE 64
+#define ARENA_VERTEX_FLOATS 10	// Vertex of MeshArena.h: position, normal, colour
+
+layout(local_size_x = GROUP_SIZE) in;
+
+layout(std430, binding = 0) readonly buffer CookedVertices { uint cookedVertices[]; };	// 3 per vertex
+layout(std430, binding = 1) writeonly buffer Vertices { float vertices[]; };
+layout(std430, binding = 2) readonly buffer CookedIndices { uint cookedIndices[]; };
+layout(std430, binding = 3) writeonly buffer Indices { uint indices[]; };
+
+uniform int u_VertexCount;
+uniform int u_IndexCount;
+uniform int u_BaseVertex;		// Where the mesh starts in the arena
+uniform int u_FirstIndex;
+uniform bool u_ShortIndices;
+uniform vec3 u_BoundsMin;
+uniform vec3 u_BoundsExtent;
+
+// Same as deferred.glsl
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main()
+{
+    const uint stride = gl_NumWorkGroups.x * GROUP_SIZE;
+
+    for (uint i = gl_GlobalInvocationID.x; i < uint(u_VertexCount); i += stride) {
+        vec2 xy = unpackUnorm2x16(cookedVertices[i * 3]);
+        float z = unpackUnorm2x16(cookedVertices[i * 3 + 1]).x;
+        vec3 position = u_BoundsMin + vec3(xy, z) * u_BoundsExtent;
+        vec3 normal = octDecode(unpackSnorm2x16(cookedVertices[i * 3 + 2]));
+
+        uint base = (uint(u_BaseVertex) + i) * ARENA_VERTEX_FLOATS;
+        for (int axis = 0; axis < 3; axis++) {
+            vertices[base + axis] = position[axis];
+            vertices[base + 3 + axis] = normal[axis];
+        }
+        for (int c = 0; c < 4; c++)
+            vertices[base + 6 + c] = 1.0;
+    }
+
+    for (uint i = gl_GlobalInvocationID.x; i < uint(u_IndexCount); i += stride) {
+        uint index = u_ShortIndices ? (cookedIndices[i >> 1] >> ((i & 1u) * 16u)) & 0xFFFFu : cookedIndices[i];
+        indices[uint(u_FirstIndex) + i] = index < uint(u_VertexCount) ? index : 0u;
+    }
+}
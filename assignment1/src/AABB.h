@@ -0,0 +1,68 @@
+#pragma once
+#include <cfloat>
+#include <glm/glm.hpp>
+
+struct AABB {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	AABB() = default;
+	AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+	glm::vec3 center() const { return (min + max) * 0.5f; }
+	glm::vec3 extent() const { return (max - min) * 0.5f; }
+	bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+	void merge(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+	void merge(const AABB& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+
+	bool intersects(const AABB& other) const {
+		return min.x <= other.max.x && max.x >= other.min.x
+			&& min.y <= other.max.y && max.y >= other.min.y
+			&& min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	float surfaceArea() const {
+		const glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	/**
+	 * \brief Box enclosing this box once transformed
+	 */
+	AABB transformed(const glm::mat4& transform) const {
+		const glm::vec3 c = glm::vec3(transform * glm::vec4(center(), 1.0f));
+		const glm::vec3 e = extent();
+		const glm::vec3 r = glm::abs(glm::vec3(transform[0])) * e.x
+			+ glm::abs(glm::vec3(transform[1])) * e.y
+			+ glm::abs(glm::vec3(transform[2])) * e.z;
+		return { c - r, c + r };
+	}
+};
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+	glm::vec3 invDirection;
+
+	Ray(const glm::vec3& origin, const glm::vec3& direction)
+		: origin(origin), direction(direction), invDirection(1.0f / direction) {}
+
+	glm::vec3 at(float t) const { return origin + direction * t; }
+
+	/**
+	 * \brief Slab test
+	 * \param tNear Distance where the ray enters the box (0 if the origin is inside)
+	 * \return true if the box is hit between 0 and maxT
+	 */
+	bool intersects(const AABB& box, float maxT, float& tNear) const {
+		const glm::vec3 t0 = (box.min - origin) * invDirection;
+		const glm::vec3 t1 = (box.max - origin) * invDirection;
+		const glm::vec3 tMin = glm::min(t0, t1);
+		const glm::vec3 tMax = glm::max(t0, t1);
+
+		tNear = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+		const float tFar = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, maxT));
+		return tNear <= tFar;
+	}
+};
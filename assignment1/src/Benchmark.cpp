@@ -0,0 +1,89 @@
+#include "Benchmark.h"
+#include <chrono>
+#include <cstdio>
+#include "Components.h"
+#include "Systems.h"
+#include "TransformSoA.h"
+#include "Renderer.h"
+
+namespace {
+	using Clock = std::chrono::high_resolution_clock;
+
+	float elapsedMs(Clock::time_point start) {
+		return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	}
+}
+
+Benchmark::Result Benchmark::ecsUpdate(uint32_t entityCount, uint32_t iterations)
+{
+	Registry registry;
+	registry.pool<Transform>().reserve(entityCount);
+	registry.pool<Velocity>().reserve(entityCount);
+	registry.pool<WorldTransform>().reserve(entityCount);
+	registry.pool<Color>().reserve(entityCount);
+
+	for (uint32_t i = 0; i < entityCount; i++) {
+		const Entity entity = registry.create();
+		const float x = (float)(i % 1000), z = (float)(i / 1000);
+		registry.add<Transform>(entity, { { x, 0, z }, glm::quat(1, 0, 0, 0), glm::vec3(1) });
+		registry.add<Velocity>(entity, { { 0.1f, 0, 0 }, { 0, 45.0f, 0 } });
+		registry.add<WorldTransform>(entity);
+		registry.add<Color>(entity);
+	}
+
+	// Warm up the caches and the worker threads
+	Systems::movement(registry, 1.0f / 60.0f);
+	Systems::transforms(registry);
+
+	const auto start = Clock::now();
+	for (uint32_t i = 0; i < iterations; i++) {
+		Systems::movement(registry, 1.0f / 60.0f);
+		Systems::transforms(registry);
+	}
+	const float ms = elapsedMs(start) / (float)iterations;
+
+	return { "ECS update", entityCount, ms, ms * 1e6f / (float)entityCount };
+}
+
+Benchmark::Result Benchmark::transformCompose(uint32_t count, bool simd, uint32_t iterations)
+{
+	TransformSoA transforms;
+	transforms.resize(count);
+	for (uint32_t i = 0; i < count; i++)
+		transforms.set(i, { (float)(i % 1000), 0, (float)(i / 1000) }, Transform::fromEuler({ (float)(i % 360), (float)(i % 90), 0 }), { 1, 2, 1 });
+
+	// Single threaded, only the kernels are compared
+	std::vector<InstanceData> instances(count);
+	float ms = 0.0f;
+	for (uint32_t i = 0; i <= iterations; i++) {
+		const auto start = Clock::now();
+		if (simd)
+			transforms.compose(0, count, instances.data());
+		else
+			transforms.composeGlm(0, count, instances.data());
+
+		if (i > 0)	// The first one warms up the caches
+			ms += elapsedMs(start);
+	}
+	ms /= (float)iterations;
+
+	return { simd ? "Transforms SIMD" : "Transforms glm", count, ms, ms * 1e6f / (float)count };
+}
+
+std::vector<Benchmark::Result> Benchmark::runAll()
+{
+	std::vector<Result> results;
+	for (uint32_t count : { 10000u, 100000u, 1000000u })
+		results.push_back(ecsUpdate(count));
+	for (uint32_t count : { 10000u, 100000u, 1000000u }) {
+		results.push_back(transformCompose(count, false));
+		results.push_back(transformCompose(count, true));
+	}
+	return results;
+}
+
+void Benchmark::print(const std::vector<Result>& results)
+{
+	for (const Result& result : results)
+		std::printf("%-24s %8u items %10.3f ms %8.2f ns/item\n", result.name, result.count, result.ms, result.nsPerItem);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Micro benchmarks run from the UI or with --benchmark, they do not need a GL context
+ */
+class Benchmark
+{
+public:
+	struct Result {
+		const char* name;
+		uint32_t count;		// Items processed per iteration
+		float ms;			// Mean time of one iteration
+		float nsPerItem;
+	};
+
+	/**
+	 * \brief ECS update cost: movement then transform systems over entityCount moving entities
+	 */
+	static Result ecsUpdate(uint32_t entityCount, uint32_t iterations = 10);
+
+	/**
+	 * \brief Matrix composition of count transforms, with the TransformSoA SIMD kernel or glm (translate * mat4_cast * scale)
+	 */
+	static Result transformCompose(uint32_t count, bool simd, uint32_t iterations = 10);
+
+	/**
+	 * \brief Every benchmark at 10k, 100k and 1M items
+	 */
+	static std::vector<Result> runAll();
+
+	static void print(const std::vector<Result>& results);
+};
@@ -0,0 +1,83 @@
+#include "BinaryFile.h"
+#include <iostream>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <cstdio>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool BinaryFile::write(const std::string& path, const void* data, size_t size)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cout << "Failed to write " << path << std::endl;
+		return false;
+	}
+
+	const char* bytes = (const char*)data;
+	bool written = true;
+	while (written && size > 0) {
+		const DWORD chunk = size > (1u << 30) ? (1u << 30) : (DWORD)size;
+		DWORD done = 0;
+		written = WriteFile(file, bytes, chunk, &done, nullptr) && done > 0;
+		bytes += done;
+		size -= done;
+	}
+	written = written && FlushFileBuffers(file);
+	CloseHandle(file);
+
+	if (!written)
+		std::cout << "Failed to write " << path << std::endl;
+	return written;
+}
+
+bool BinaryFile::replace(const std::string& from, const std::string& to)
+{
+	if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		std::cout << "Failed to replace " << to << std::endl;
+		return false;
+	}
+	return true;
+}
+#else
+bool BinaryFile::write(const std::string& path, const void* data, size_t size)
+{
+	const int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file < 0) {
+		std::cout << "Failed to write " << path << std::endl;
+		return false;
+	}
+
+	const char* bytes = (const char*)data;
+	bool written = true;
+	while (written && size > 0) {
+		const ssize_t done = ::write(file, bytes, size);
+		written = done > 0;
+		if (written) {
+			bytes += done;
+			size -= (size_t)done;
+		}
+	}
+	written = written && fsync(file) == 0;
+	written = close(file) == 0 && written;
+
+	if (!written)
+		std::cout << "Failed to write " << path << std::endl;
+	return written;
+}
+
+bool BinaryFile::replace(const std::string& from, const std::string& to)
+{
+	// rename overwrites the destination atomically
+	if (std::rename(from.c_str(), to.c_str()) != 0) {
+		std::cout << "Failed to replace " << to << std::endl;
+		return false;
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * \brief Layout, writing and replacing of the binary files (cooked meshes, scene files), a crash never leaves a partial one
+ */
+class BinaryFile
+{
+public:
+	static constexpr size_t SectionAlignment = 16;	// Start of every section
+
+	static size_t align(size_t offset) { return (offset + SectionAlignment - 1) & ~(SectionAlignment - 1); }
+
+	/**
+	 * \return true if the section is aligned and inside a file of the given size, checked before a mapped file is read
+	 */
+	static bool fits(uint64_t offset, uint64_t bytes, size_t size)
+	{
+		return offset % SectionAlignment == 0 && offset <= size && bytes <= size - offset;
+	}
+
+	/**
+	 * \brief Writes the whole file and waits until the OS has it on disk
+	 */
+	static bool write(const std::string& path, const void* data, size_t size);
+
+	/**
+	 * \brief Moves from over to in one step, to is either the old or the new file even after a crash
+	 */
+	static bool replace(const std::string& from, const std::string& to);
+};
@@ -17,6 +17,31 @@ void Camera::setWindowSize(uint32_t width, uint32_t height)
 {
     this->width = width;
     this->height = height;
+    recalculateMatrix();
+}
+
+void Camera::setOrientation(const glm::quat& rotation)
+{
+    orientation = previousOrientation = tickOrientation = glm::normalize(rotation);
+    recalculateMatrix();
+}
+
+void Camera::rotate(float pitch, float yaw)
+{
+    // The pitch applies after the orientation (view space), the yaw before it (world space)
+    const glm::quat pitchRotation = glm::angleAxis(glm::radians(pitch), glm::vec3(1, 0, 0));
+    const glm::quat yawRotation = glm::angleAxis(glm::radians(yaw), glm::vec3(0, 1, 0));
+    tickOrientation = glm::normalize(pitchRotation * tickOrientation * yawRotation);
+}
+
+void Camera::interpolate(float alpha)
+{
+    // Still: the matrices and their version are left alone, render on demand stays idle
+    const glm::quat drawn = previousOrientation == tickOrientation ? tickOrientation : glm::slerp(previousOrientation, tickOrientation, alpha);
+    if (drawn != orientation) {
+        orientation = drawn;
+        recalculateMatrix();
+    }
 }
 
 void Camera::onUpdate(float dt) {
@@ -52,15 +77,13 @@ void Camera::onUpdate(float dt) {
 void Camera::recalculateMatrix()
 {
     glm::mat4 view = glm::lookAt(position, { position.x, position.y, 0 }, glm::vec3(0.0f, 1.0f, 0.0f));
-    view = glm::translate(view, position);
-    view = glm::rotate(view, glm::radians(rotation.x), { 1, 0, 0 });
-    view = glm::rotate(view, glm::radians(rotation.y), { 0, 1, 0 });
-    view = glm::rotate(view, glm::radians(rotation.z), { 0, 0, 1 });
-    view = glm::translate(view, -position);
-    glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), (float)width / (float)height, 0.1f, 1000.0f);
+    view = view * Transform::toMatrix(position, orientation, position, glm::vec3(1.0f)) * glm::translate(glm::mat4(1.0f), -position);
+    glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), (float)width / (float)height, NearPlane, FarPlane);
 
     this->view = view;
     this->proj = projectionMatrix;
 
     viewProj = projectionMatrix * view;
+    frustum = Frustum::fromMatrix(viewProj);
+    version++;
 }
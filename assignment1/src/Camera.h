@@ -1,15 +1,44 @@
 #pragma once
 #include <glm/glm.hpp>
+#include "Frustum.h"
+#include "Transform.h"
 
 class SceneManager;
 
 class Camera {
 
 public:
+	static constexpr float NearPlane = 0.1f;
+	static constexpr float FarPlane = 1000.0f;
+
 	Camera(const SceneManager& manager, uint32_t width, uint32_t height);
 
 	void setPosition(const glm::vec3& pos) { position = pos; recalculateMatrix(); }
-	void setRotation(const glm::vec3& rot) { rotation = rot; recalculateMatrix(); }
+	void setRotation(const glm::vec3& rot) { setOrientation(Transform::fromEuler(rot)); }
+
+	/**
+	 * \brief Turns at once, no interpolation from the old orientation
+	 */
+	void setOrientation(const glm::quat& rotation);
+
+	/**
+	 * \brief Pitches around the view x axis and yaws around the world y axis, no gimbal lock. Changes the orientation
+	 * of the current tick, it is drawn by interpolate
+	 * \param pitch Degrees
+	 * \param yaw Degrees
+	 */
+	void rotate(float pitch, float yaw);
+
+	/**
+	 * \brief Call at every tick before rotate: the orientation of the last tick is where the interpolation starts
+	 */
+	void onFixedUpdate() { previousOrientation = tickOrientation; }
+
+	/**
+	 * \brief Draws the orientation between the last two ticks, like the Olafs
+	 * \param alpha Fraction of a tick since the last one
+	 */
+	void interpolate(float alpha);
 	void setWindowSize(uint32_t width, uint32_t height);
 
 
@@ -18,9 +47,20 @@ public:
 	const glm::mat4& getViewProjection() const { return viewProj;}
 	const glm::mat4& getView() const { return view; }
 	const glm::mat4& getProjection() const { return proj; }
+	const Frustum& getFrustum() const { return frustum; }
+
+	/**
+	 * \brief Incremented every time the matrices are recalculated, used to know if the last frame is still valid
+	 */
+	uint32_t getVersion() const { return version; }
 
 	inline const glm::vec3& getPosition() const { return position; }
-	inline const glm::vec3& getRotation() const { return rotation; }
+	inline const glm::quat& getOrientation() const { return orientation; }
+
+	/**
+	 * \return Euler angles in degrees, for the UI
+	 */
+	inline glm::vec3 getRotation() const { return Transform::toEuler(orientation); }
 	inline const uint32_t getWidth() const { return width; }
 	inline const uint32_t getHeight() const { return height; }
 
@@ -30,11 +70,15 @@ private:
 
 	const SceneManager& manager;
 	glm::vec3 position = glm::vec3(0.0f);
-	glm::vec3 rotation = glm::vec3(0.0f);
+	glm::quat orientation = glm::quat(1, 0, 0, 0);		// Drawn, between the last two ticks
+	glm::quat previousOrientation = glm::quat(1, 0, 0, 0);
+	glm::quat tickOrientation = glm::quat(1, 0, 0, 0);
 
 	glm::mat4 view =glm::mat4(1.0f);
 	glm::mat4 proj = glm::mat4(1.0f);
 	glm::mat4 viewProj = glm::mat4(1.0f);
+	Frustum frustum;
+	uint32_t version = 0;
 
 	uint32_t width, height;
 	bool zoomEnabled = true;
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "ECS.h"
+#include "Light.h"
+#include "Transform.h"
+#include "MeshArena.h"
+
+class Shader;
+
+// The Transform is the local transform, relative to the Parent if the entity has one
+
+// Computed by Systems::transforms, read by the render system
+struct WorldTransform {
+	glm::mat4 matrix = glm::mat4(1);
+};
+
+struct MeshRenderer {
+	MeshID mesh = 0;
+	Shader* shader = nullptr;	// nullptr is the Renderer default shader
+	int mode = -1;				// OpenGL mode, -1 is the Renderer default mode
+};
+
+struct Color {
+	glm::vec4 value = glm::vec4(1);
+};
+
+// Integrated by Systems::movement, every tick
+struct Velocity {
+	glm::vec3 linear = glm::vec3(0);	// Units per second
+	glm::vec3 angular = glm::vec3(0);	// Degrees per second around each world axis
+};
+
+// The Light and PointLight structs of the Renderer are used as is as components
+
+// Hierarchy, one level deep: the parent of an entity must not have a Parent itself
+struct Parent {
+	Entity entity = NullEntity;
+};
+
+struct Children {
+	std::vector<Entity> entities;
+};
@@ -0,0 +1,40 @@
+#include "ECS.h"
+
+Entity Registry::create()
+{
+	uint32_t index;
+	if (!freeIndices.empty()) {
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	} else {
+		index = (uint32_t)generations.size();
+		assert(index < 0xFFFFFF, "Too many entities");
+		generations.push_back(0);
+	}
+
+	aliveCount++;
+	return index | ((Entity)generations[index] << 24);
+}
+
+void Registry::destroy(Entity entity)
+{
+	if (!isAlive(entity))
+		return;
+
+	for (auto& pool : pools) {
+		if (pool)
+			pool->remove(entity);
+	}
+
+	// Old handles no longer match once the index is reused
+	const uint32_t index = entity & 0xFFFFFF;
+	generations[index]++;
+	freeIndices.push_back(index);
+	aliveCount--;
+}
+
+bool Registry::isAlive(Entity entity) const
+{
+	const uint32_t index = entity & 0xFFFFFF;
+	return entity != NullEntity && index < generations.size() && generations[index] == (uint8_t)(entity >> 24);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <assert.h>
+
+// Index in the low 24 bits, generation in the high 8 bits (detects handles to destroyed entities)
+using Entity = uint32_t;
+constexpr Entity NullEntity = ~0u;
+
+class ComponentPoolBase
+{
+public:
+	virtual ~ComponentPoolBase() = default;
+	virtual void remove(Entity entity) = 0;
+	virtual bool has(Entity entity) const = 0;
+};
+
+/**
+ * \brief Sparse set: components are packed in a dense array (iterated linearly by the systems),
+ * the sparse array maps an entity index to its dense slot
+ */
+template<typename T>
+class ComponentPool : public ComponentPoolBase
+{
+public:
+	static constexpr uint32_t Invalid = ~0u;
+
+	T& add(Entity entity, const T& component) {
+		const uint32_t index = entity & 0xFFFFFF;
+		if (index >= sparse.size())
+			sparse.resize(index + 1, Invalid);
+
+		if (sparse[index] != Invalid)
+			return components[sparse[index]] = component;
+
+		sparse[index] = (uint32_t)components.size();
+		entities.push_back(entity);
+		components.push_back(component);
+		return components.back();
+	}
+
+	/**
+	 * \brief Swaps the last component into the removed slot, the order of the dense array is not kept
+	 */
+	void remove(Entity entity) override {
+		if (!has(entity))
+			return;
+
+		const uint32_t slot = sparse[entity & 0xFFFFFF];
+		const Entity last = entities.back();
+
+		components[slot] = std::move(components.back());
+		entities[slot] = last;
+		sparse[last & 0xFFFFFF] = slot;
+
+		components.pop_back();
+		entities.pop_back();
+		sparse[entity & 0xFFFFFF] = Invalid;
+	}
+
+	bool has(Entity entity) const override {
+		const uint32_t index = entity & 0xFFFFFF;
+		return index < sparse.size() && sparse[index] != Invalid && entities[sparse[index]] == entity;
+	}
+
+	T& get(Entity entity) { assert(has(entity), "Entity has no such component"); return components[sparse[entity & 0xFFFFFF]]; }
+	T* tryGet(Entity entity) { return has(entity) ? &components[sparse[entity & 0xFFFFFF]] : nullptr; }
+
+	uint32_t size() const { return (uint32_t)components.size(); }
+	T* data() { return components.data(); }
+	const Entity* getEntities() const { return entities.data(); }
+
+	void reserve(uint32_t count) { components.reserve(count); entities.reserve(count); }
+
+private:
+	std::vector<uint32_t> sparse;	// Indexed by entity index
+	std::vector<Entity> entities;	// Dense, parallel to components
+	std::vector<T> components;
+};
+
+/**
+ * \brief Owns the entities and one pool per component type. Every component type is stored in its own
+ * array (structure of arrays), a system only touches the arrays it needs
+ */
+class Registry
+{
+public:
+	Entity create();
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+	uint32_t getEntityCount() const { return aliveCount; }
+
+	template<typename T>
+	T& add(Entity entity, const T& component = T()) { return pool<T>().add(entity, component); }
+
+	template<typename T>
+	void remove(Entity entity) { pool<T>().remove(entity); }
+
+	template<typename T>
+	bool has(Entity entity) { return pool<T>().has(entity); }
+
+	template<typename T>
+	T& get(Entity entity) { return pool<T>().get(entity); }
+
+	template<typename T>
+	T* tryGet(Entity entity) { return pool<T>().tryGet(entity); }
+
+	template<typename T>
+	ComponentPool<T>& pool() {
+		const uint32_t id = typeId<T>();
+		if (id >= pools.size())
+			pools.resize(id + 1);
+		if (!pools[id])
+			pools[id] = std::make_unique<ComponentPool<T>>();
+		return *(ComponentPool<T>*)pools[id].get();
+	}
+
+	/**
+	 * \brief Calls f(entity, T&, Others&...) for every entity with all the components. The dense array of T
+	 * is walked in order, put the rarest component first
+	 */
+	template<typename T, typename... Others, typename F>
+	void each(F&& f) {
+		ComponentPool<T>& first = pool<T>();
+		T* components = first.data();
+		const Entity* entities = first.getEntities();
+
+		for (uint32_t i = 0; i < first.size(); i++) {
+			const Entity entity = entities[i];
+			if ((pool<Others>().has(entity) && ...))
+				f(entity, components[i], pool<Others>().get(entity)...);
+		}
+	}
+
+private:
+	static uint32_t nextTypeId() { static uint32_t next = 0; return next++; }
+
+	template<typename T>
+	static uint32_t typeId() { static const uint32_t id = nextTypeId(); return id; }
+
+	std::vector<std::unique_ptr<ComponentPoolBase>> pools;	// Indexed by typeId
+	std::vector<uint8_t> generations;						// Indexed by entity index
+	std::vector<uint32_t> freeIndices;
+	uint32_t aliveCount = 0;
+};
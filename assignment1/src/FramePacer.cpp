@@ -0,0 +1,155 @@
+#include "FramePacer.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <timeapi.h>
+	#pragma comment(lib, "winmm.lib")
+#endif
+
+static constexpr uint32_t FRAME_HISTORY = 240;
+
+namespace {
+	// The Windows scheduler ticks every 15.6 ms by default, a sleep of the limiter would overshoot whole frames
+	void setFineTimer(bool fine)
+	{
+#ifdef _WIN32
+		if (fine)
+			timeBeginPeriod(1);
+		else
+			timeEndPeriod(1);
+#else
+		(void)fine;
+#endif
+	}
+}
+
+FramePacer::FramePacer()
+	: nextFrame(Clock::now()), history(FRAME_HISTORY, 0.0f)
+{
+}
+
+FramePacer::~FramePacer()
+{
+	if (mode == Mode::Limiter)
+		setFineTimer(false);
+}
+
+void FramePacer::setMode(Mode mode)
+{
+	if (this->mode == mode)
+		return;
+
+	// Only raised while the limiter sleeps, it costs power system wide
+	if (this->mode == Mode::Limiter)
+		setFineTimer(false);
+	if (mode == Mode::Limiter)
+		setFineTimer(true);
+
+	this->mode = mode;
+	intervalDirty = true;
+
+	// Statistics are per mode
+	historyIndex = 0;
+	historyCount = 0;
+	stats = Stats();
+	nextFrame = Clock::now();
+}
+
+void FramePacer::applySwapInterval()
+{
+	if (!intervalDirty)
+		return;
+
+	if (!adaptiveChecked) {
+		adaptiveSupported = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+		adaptiveChecked = true;
+	}
+
+	glfwSwapInterval(getSwapInterval());
+	intervalDirty = false;
+}
+
+int FramePacer::getSwapInterval() const
+{
+	switch (mode) {
+	case Mode::Uncapped:
+	case Mode::Limiter:
+		return 0;
+
+	case Mode::AdaptiveVSync:
+		return adaptiveSupported ? -1 : 1;
+
+	default:
+		return 1;
+	}
+}
+
+void FramePacer::waitForNextFrame()
+{
+	if (mode != Mode::Limiter)
+		return;
+
+	// The OS sleep is only accurate to a millisecond or two (with the 1 ms timer on Windows), so sleep short and spin the rest
+	constexpr auto spinMargin = std::chrono::microseconds(2000);
+	const auto frameTime = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+
+	nextFrame += frameTime;
+	auto now = Clock::now();
+
+	// Too late (or just switched), start over from now instead of rushing frames
+	if (nextFrame < now) {
+		nextFrame = now;
+		return;
+	}
+
+	if (nextFrame - now > spinMargin)
+		std::this_thread::sleep_for(nextFrame - now - spinMargin);
+
+	while (Clock::now() < nextFrame)
+		std::this_thread::yield();
+}
+
+void FramePacer::recordFrame(float dt)
+{
+	history[historyIndex] = dt * 1000.0f;
+	historyIndex = (historyIndex + 1) % FRAME_HISTORY;
+	historyCount = std::min(historyCount + 1, FRAME_HISTORY);
+
+	float sum = 0.0f;
+	float minimum = history[0];
+	float maximum = history[0];
+	for (uint32_t i = 0; i < historyCount; i++) {
+		sum += history[i];
+		minimum = std::min(minimum, history[i]);
+		maximum = std::max(maximum, history[i]);
+	}
+
+	const float mean = sum / historyCount;
+	float variance = 0.0f;
+	for (uint32_t i = 0; i < historyCount; i++)
+		variance += (history[i] - mean) * (history[i] - mean);
+	variance /= historyCount;
+
+	stats.meanMs = mean;
+	stats.varianceMs2 = variance;
+	stats.stdDevMs = std::sqrt(variance);
+	stats.minMs = minimum;
+	stats.maxMs = maximum;
+}
+
+const char* FramePacer::getModeName(Mode mode)
+{
+	switch (mode) {
+	case Mode::VSync:			return "VSync";
+	case Mode::Uncapped:		return "Uncapped";
+	case Mode::AdaptiveVSync:	return "Adaptive VSync";
+	case Mode::Limiter:			return "Frame limiter";
+	case Mode::OnDemand:		return "Render on demand";
+	}
+	return "";
+}
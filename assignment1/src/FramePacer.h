@@ -0,0 +1,85 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+/**
+ * \brief Controls how frames are presented (vsync, frame limiter, render on demand)
+ * and keeps frame time statistics for the current mode
+ */
+class FramePacer
+{
+public:
+	enum class Mode {
+		VSync = 0,		// Swap interval 1
+		Uncapped,		// Swap interval 0, for benchmarks
+		AdaptiveVSync,	// Swap interval -1 (tears instead of waiting when a frame is late), VSync if unsupported
+		Limiter,		// Swap interval 0 and a sleep + spin wait up to the target frame time
+		OnDemand		// Redraws only when the scene or the UI changed, sleeps in between
+	};
+
+	struct Stats {
+		float meanMs = 0.0f;
+		float varianceMs2 = 0.0f;
+		float stdDevMs = 0.0f;
+		float minMs = 0.0f;
+		float maxMs = 0.0f;
+	};
+
+	FramePacer();
+	~FramePacer();
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	void setMode(Mode mode);
+	Mode getMode() const { return mode; }
+
+	void setTargetFps(float fps) { targetFps = fps > 1.0f ? fps : 1.0f; }
+	float getTargetFps() const { return targetFps; }
+
+	/**
+	 * \brief Applies the swap interval of the mode if it changed. The OpenGL context must be current
+	 */
+	void applySwapInterval();
+
+	/**
+	 * \brief Swap interval of the mode, for the thread owning the context. applySwapInterval() must have run once
+	 * so the adaptive vsync support is known
+	 */
+	int getSwapInterval() const;
+
+	/**
+	 * \brief Limiter mode: sleeps then spins until the target frame time is reached. Other modes return immediately
+	 */
+	void waitForNextFrame();
+
+	/**
+	 * \brief Adds a frame time to the statistics window
+	 */
+	void recordFrame(float dt);
+
+	/**
+	 * \return true if the mode asked for adaptive vsync but the driver does not support it
+	 */
+	bool isAdaptiveFallback() const { return mode == Mode::AdaptiveVSync && adaptiveChecked && !adaptiveSupported; }
+
+	const Stats& getStats() const { return stats; }
+
+	static const char* getModeName(Mode mode);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Mode mode = Mode::VSync;
+	float targetFps = 60.0f;
+	bool intervalDirty = true;
+	bool adaptiveChecked = false;
+	bool adaptiveSupported = false;
+
+	Clock::time_point nextFrame;
+
+	// Last frame times, in ms
+	std::vector<float> history;
+	uint32_t historyIndex = 0;
+	uint32_t historyCount = 0;
+	Stats stats;
+};
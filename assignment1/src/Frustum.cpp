@@ -0,0 +1,37 @@
+#include "Frustum.h"
+
+Frustum Frustum::fromMatrix(const glm::mat4& m)
+{
+	// glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+	Frustum frustum;
+	frustum.planes[Left]	= row(3) + row(0);
+	frustum.planes[Right]	= row(3) - row(0);
+	frustum.planes[Bottom]	= row(3) + row(1);
+	frustum.planes[Top]		= row(3) - row(1);
+	frustum.planes[Near]	= row(3) + row(2);
+	frustum.planes[Far]		= row(3) - row(2);
+
+	for (glm::vec4& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+
+	return frustum;
+}
+
+bool Frustum::intersects(const glm::vec3& min, const glm::vec3& max) const
+{
+	const glm::vec3 center = (min + max) * 0.5f;
+	const glm::vec3 extent = (max - min) * 0.5f;
+
+	for (const glm::vec4& plane : planes) {
+		const glm::vec3 normal = glm::vec3(plane);
+		const float distance = glm::dot(normal, center) + plane.w;
+		const float radius = glm::dot(glm::abs(normal), extent);
+
+		if (distance + radius < 0.0f)
+			return false;
+	}
+
+	return true;
+}
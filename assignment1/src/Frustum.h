@@ -0,0 +1,21 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/**
+ * \brief View frustum stored as 6 normalized planes (xyz = normal pointing inside, w = distance)
+ */
+struct Frustum {
+	enum Plane { Left = 0, Right, Bottom, Top, Near, Far, Count };
+
+	glm::vec4 planes[Count];
+
+	/**
+	 * \brief Extracts the planes from a view projection matrix (Gribb & Hartmann)
+	 */
+	static Frustum fromMatrix(const glm::mat4& viewProj);
+
+	/**
+	 * \return false if the box is completely outside of one of the planes
+	 */
+	bool intersects(const glm::vec3& min, const glm::vec3& max) const;
+};
@@ -0,0 +1,108 @@
+#include "GpuTimer.h"
+#include <GL/glew.h>
+#include <algorithm>
+
+namespace {
+	// Reads the query about to be reused into result, false if it was never issued or the GPU is not done with it
+	bool readIfAvailable(uint32_t query, bool issued, uint64_t& result)
+	{
+		if (!issued)
+			return false;
+
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+
+		GLuint64 value = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &value);
+		result = value;
+		return true;
+	}
+}
+
+void GpuTimer::release()
+{
+	if (queries[0])
+		glDeleteQueries(Latency, queries);
+	std::fill(std::begin(queries), std::end(queries), 0u);
+	std::fill(std::begin(issued), std::end(issued), false);
+	index = 0;
+}
+
+void GpuTimer::begin()
+{
+	if (!queries[0])
+		glGenQueries(Latency, queries);
+
+	// The oldest query is reused, read it first if the GPU is done with it
+	uint64_t nanoseconds = 0;
+	if (readIfAvailable(queries[index], issued[index], nanoseconds))
+		ms = (float)nanoseconds * 1e-6f;
+
+	glBeginQuery(GL_TIME_ELAPSED, queries[index]);
+}
+
+void GpuTimer::end()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	issued[index] = true;
+	index = (index + 1) % Latency;
+}
+
+void GpuReadback::release()
+{
+	for (GLsync& fence : fences) {
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+	if (buffers[0])
+		glDeleteBuffers(Latency, buffers);
+	std::fill(std::begin(buffers), std::end(buffers), 0u);
+	index = 0;
+}
+
+void GpuReadback::copy(uint32_t buffer, uint32_t count)
+{
+	const GLsizeiptr size = std::min(count, MaxCounters) * sizeof(uint32_t);
+	if (!buffers[0]) {
+		glCreateBuffers(Latency, buffers);
+		for (GLuint ring : buffers)
+			glNamedBufferData(ring, sizeof(counters), nullptr, GL_STREAM_READ);
+	}
+
+	// The oldest copy is overwritten, read it first if the GPU is done with it
+	if (fences[index]) {
+		const GLenum status = glClientWaitSync(fences[index], 0, 0);
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+			glGetNamedBufferSubData(buffers[index], 0, size, counters);
+		glDeleteSync(fences[index]);
+	}
+
+	glCopyNamedBufferSubData(buffer, buffers[index], 0, 0, size);
+	fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	index = (index + 1) % Latency;
+}
+
+bool GpuVertexCounter::isSupported()
+{
+	return GLEW_ARB_pipeline_statistics_query;
+}
+
+uint64_t GpuVertexCounter::measure(const std::function<void()>& draws)
+{
+	if (!isSupported())
+		return 0;
+
+	GLuint query;
+	glGenQueries(1, &query);
+	glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, query);
+	draws();
+	glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+
+	GLuint64 invocations = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &invocations);
+	glDeleteQueries(1, &query);
+	return invocations;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+/**
+ * \brief Measures the GPU time of the commands between begin and end with GL_TIME_ELAPSED queries.
+ * The result is read a few frames later so the CPU never waits for the GPU. Timers must not overlap
+ */
+class GpuTimer
+{
+public:
+	~GpuTimer() { release(); }
+
+	/**
+	 * \brief Deletes the queries, must be called while the GL context is current. The timer can be used again afterwards
+	 */
+	void release();
+
+	void begin();
+	void end();
+
+	/**
+	 * \return GPU time of the latest measure whose result is available, in milliseconds
+	 */
+	float getMs() const { return ms; }
+
+private:
+	static constexpr uint32_t Latency = 3;	// Queries in flight
+
+	uint32_t queries[Latency] = {};
+	bool issued[Latency] = {};
+	uint32_t index = 0;
+	float ms = 0.0f;
+};
+
+/**
+ * \brief Reads counters written by the GPU without waiting for it: every copy goes to the next buffer of a ring with
+ * a fence, and the oldest one is read once its fence signaled, a few frames later
+ */
+class GpuReadback
+{
+public:
+	static constexpr uint32_t MaxCounters = 4;
+
+	~GpuReadback() { release(); }
+
+	/**
+	 * \brief Deletes the buffers and the fences, must be called while the GL context is current
+	 */
+	void release();
+
+	/**
+	 * \brief Queues a copy of the first count uint32_t of buffer. Writes of shaders must be made visible to buffer updates first
+	 */
+	void copy(uint32_t buffer, uint32_t count);
+
+	/**
+	 * \return Counter of the latest copy read, 0 until one is
+	 */
+	uint32_t getCounter(uint32_t i) const { return counters[i]; }
+
+private:
+	static constexpr uint32_t Latency = 3;	// Copies in flight
+
+	uint32_t buffers[Latency] = {};
+	struct __GLsync* fences[Latency] = {};
+	uint32_t index = 0;
+	uint32_t counters[MaxCounters] = {};
+};
+
+/**
+ * \brief Counts the vertex shader invocations of draws. Needs ARB_pipeline_statistics_query
+ */
+class GpuVertexCounter
+{
+public:
+	static bool isSupported();
+
+	/**
+	 * \brief Runs the draws and waits for the count, for measures outside of the frames (the CPU waits for the GPU)
+	 * \return 0 when not supported
+	 */
+	static uint64_t measure(const std::function<void()>& draws);
+};
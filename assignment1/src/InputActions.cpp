@@ -0,0 +1,26 @@
+#include "InputActions.h"
+#include "SceneManager.h"
+
+void InputActions::bind(Action action, KeyCode key, Modifier modifier)
+{
+	bindings.push_back({ action, key, modifier });
+}
+
+void InputActions::sample(const SceneManager& manager, bool enabled)
+{
+	previous = state;
+	state.reset();
+	if (!enabled)
+		return;
+
+	const bool shift = manager.isKeyDown(KeyCode::LEFT_SHIFT) || manager.isKeyDown(KeyCode::RIGHT_SHIFT);
+	for (const Binding& binding : bindings) {
+		if (binding.modifier == Modifier::Shift && !shift)
+			continue;
+		if (binding.modifier == Modifier::NoShift && shift)
+			continue;
+
+		if (manager.isKeyDown(binding.key))
+			state.set(binding.action);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <bitset>
+#include <vector>
+#include "KeyCodes.h"
+
+class SceneManager;
+
+/**
+ * \brief Maps keys to actions and samples them once per simulation tick into a bitset,
+ * so movement is driven by the key state instead of the OS key repeat events
+ */
+class InputActions
+{
+public:
+	enum Action : uint32_t {
+		MoveLeft = 0,
+		MoveRight,
+		MoveForward,
+		MoveBack,
+		TurnLeft,
+		TurnRight,
+		CameraPitchUp,
+		CameraPitchDown,
+		CameraYawLeft,
+		CameraYawRight,
+		Count
+	};
+
+	// Shift state required by a binding, the same key can do different things with and without shift
+	enum class Modifier : uint8_t { Any = 0, Shift, NoShift };
+
+	void bind(Action action, KeyCode key, Modifier modifier = Modifier::Any);
+
+	/**
+	 * \brief Reads the state of every bound key
+	 * \param enabled false clears every action (the UI has the keyboard focus)
+	 */
+	void sample(const SceneManager& manager, bool enabled = true);
+
+	bool isDown(Action action) const { return state[action]; }
+	bool wasPressed(Action action) const { return state[action] && !previous[action]; }
+
+	/**
+	 * \return -1, 0 or 1 depending on which of the two actions is down
+	 */
+	float axis(Action negative, Action positive) const { return (float)state[positive] - (float)state[negative]; }
+
+	const std::bitset<Count>& getState() const { return state; }
+
+private:
+	struct Binding {
+		Action action;
+		KeyCode key;
+		Modifier modifier;
+	};
+
+	std::vector<Binding> bindings;
+	std::bitset<Count> state;
+	std::bitset<Count> previous;	// State of the previous tick
+};
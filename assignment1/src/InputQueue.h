@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \brief Lock free single producer single consumer ring buffer. One thread pushes, one thread pops,
+ * no lock and no allocation after construction
+ */
+template<typename T, size_t Capacity>
+class SPSCQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	/**
+	 * \brief Producer thread only
+	 * \return false if the queue is full, the item is dropped
+	 */
+	bool push(const T& item) {
+		const size_t tail = this->tail.load(std::memory_order_relaxed);
+		if (tail - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		items[tail & (Capacity - 1)] = item;
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * \brief Consumer thread only
+	 */
+	bool pop(T& item) {
+		const size_t head = this->head.load(std::memory_order_relaxed);
+		if (head == tail.load(std::memory_order_acquire))
+			return false;
+
+		item = items[head & (Capacity - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+private:
+	alignas(64) std::atomic<size_t> head{ 0 };		// Next item to pop, written by the consumer
+	alignas(64) std::atomic<size_t> tail{ 0 };		// Next free slot, written by the producer
+	T items[Capacity];
+};
+
+// Compact copy of a GLFW callback, queued by the callbacks and dispatched once per frame
+struct InputEvent {
+	enum Type : uint8_t { Key = 0, MouseButton, CursorPos, Scroll, Resize, Refresh };
+
+	Type type;
+	uint8_t action;		// KeyAction for keys and mouse buttons
+	uint16_t mods;
+	int32_t code;		// Key or mouse button
+	float x;			// Cursor position, scroll offset or window size
+	float y;
+};
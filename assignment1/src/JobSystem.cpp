@@ -0,0 +1,194 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+bool WorkStealingQueue::push(Job* job)
+{
+	const int64_t b = bottom.load(std::memory_order_relaxed);
+	const int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= Capacity)
+		return false;
+
+	jobs[b & (Capacity - 1)].store(job, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);	// Publishes the job to the thieves
+	return true;
+}
+
+Job* WorkStealingQueue::pop()
+{
+	const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		// Empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = jobs[b & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		// Last job, race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+Job* WorkStealingQueue::steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+		return nullptr;
+
+	Job* job = jobs[t & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;	// Lost against the owner or another thief
+
+	return job;
+}
+
+void JobSystem::init(uint32_t workerCount)
+{
+	if (running)
+		return;
+
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+	for (uint32_t i = 0; i <= workerCount; i++) {
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->pool.resize(WorkStealingQueue::Capacity * 2);
+		workers.back()->queued = std::make_unique<std::atomic<bool>[]>(workers.back()->pool.size());
+		workers.back()->random = 0x9E3779B9u * (i + 1);
+	}
+
+	threadIndex = 0;
+	running = true;
+	for (uint32_t i = 1; i <= workerCount; i++)
+		threads.emplace_back(workerLoop, i);
+}
+
+void JobSystem::shutdown()
+{
+	if (!running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	threads.clear();
+	workers.clear();
+	threadIndex = -1;
+}
+
+void JobSystem::spawn(const Job& job)
+{
+	Worker& worker = *workers[threadIndex];
+
+	// A slot is reused once its job was taken. When it is not (the ring wrapped onto jobs still queued, nested
+	// parallelFors), or when the queue is full, the job runs here
+	const uint32_t index = worker.next % (uint32_t)worker.pool.size();
+	if (worker.queued[index].load(std::memory_order_acquire)) {
+		execute(job);
+		return;
+	}
+
+	worker.pool[index] = job;
+	worker.queued[index].store(true, std::memory_order_relaxed);
+	pendingJobs.fetch_add(1, std::memory_order_release);
+	if (worker.queue.push(&worker.pool[index])) {
+		worker.next++;
+	} else {
+		worker.queued[index].store(false, std::memory_order_relaxed);
+		pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+		execute(job);
+	}
+}
+
+void JobSystem::wait(const std::atomic<uint32_t>& counter)
+{
+	Job job;
+	while (counter.load(std::memory_order_acquire) > 0) {
+		if (findJob(job))
+			execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::notifyWorkers()
+{
+	// Taking the lock makes sure no worker is between its check and its wait
+	{ std::lock_guard<std::mutex> lock(sleepMutex); }
+	sleepCondition.notify_all();
+}
+
+bool JobSystem::take(Worker& owner, Job* slot, Job& job)
+{
+	// Copied out, then the slot is handed back to its owner
+	job = *slot;
+	owner.queued[slot - owner.pool.data()].store(false, std::memory_order_release);
+	pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool JobSystem::findJob(Job& job)
+{
+	Worker& worker = *workers[threadIndex];
+	if (Job* slot = worker.queue.pop())
+		return take(worker, slot, job);
+
+	// Steal, starting from a random queue so the thieves spread out
+	worker.random ^= worker.random << 13;
+	worker.random ^= worker.random >> 17;
+	worker.random ^= worker.random << 5;
+
+	const uint32_t count = (uint32_t)workers.size();
+	const uint32_t start = worker.random % count;
+	for (uint32_t i = 0; i < count; i++) {
+		const uint32_t victim = (start + i) % count;
+		if (victim == (uint32_t)threadIndex)
+			continue;
+
+		if (Job* slot = workers[victim]->queue.steal()) {
+			steals.fetch_add(1, std::memory_order_relaxed);
+			return take(*workers[victim], slot, job);
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(const Job& job)
+{
+	job.function(job);
+	job.counter->fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+	threadIndex = (int)index;
+
+	Job job;
+	while (running) {
+		if (findJob(job)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [] { return !running || pendingJobs.load(std::memory_order_acquire) > 0; });
+	}
+}
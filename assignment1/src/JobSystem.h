@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+using JobFunction = void(*)(const Job& job);
+
+struct Job {
+	JobFunction function;
+	const void* data;					// Passed untouched to the function
+	uint32_t begin;						// Range of a parallelFor chunk
+	uint32_t end;
+	std::atomic<uint32_t>* counter;		// Decremented once the job ran
+};
+
+/**
+ * \brief Chase-Lev deque. The owner thread pushes and pops at the bottom (LIFO, cache friendly),
+ * the other threads steal from the top (FIFO, the oldest and usually largest jobs)
+ */
+class WorkStealingQueue
+{
+public:
+	static constexpr int64_t Capacity = 4096;	// Power of two
+
+	/**
+	 * \brief Owner thread only
+	 * \return false if the queue is full, the caller runs the job itself
+	 */
+	bool push(Job* job);
+
+	/**
+	 * \brief Owner thread only
+	 */
+	Job* pop();
+
+	/**
+	 * \brief Any thread
+	 */
+	Job* steal();
+
+	bool isEmpty() const { return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed); }
+
+private:
+	alignas(64) std::atomic<int64_t> top{ 0 };
+	alignas(64) std::atomic<int64_t> bottom{ 0 };
+	std::atomic<Job*> jobs[Capacity];
+};
+
+/**
+ * \brief Fixed pool of worker threads sharing work through per thread work stealing queues.
+ * The thread calling init() is thread 0, it helps with the jobs while it waits for them.
+ * No fibers: a job waiting on other jobs runs them (or steals) until they are done
+ */
+class JobSystem
+{
+public:
+	/**
+	 * \param workerCount Threads created next to the calling thread, 0 uses every core
+	 */
+	static void init(uint32_t workerCount = 0);
+	static void shutdown();
+
+	/**
+	 * \brief Queues a job on the calling thread's queue. counter must be incremented by the caller beforehand
+	 */
+	static void spawn(const Job& job);
+
+	/**
+	 * \brief Runs jobs until the counter reaches 0
+	 */
+	static void wait(const std::atomic<uint32_t>& counter);
+
+	/**
+	 * \brief Calls body(begin, end) over [0, count) split in chunks of grainSize, spread over every thread.
+	 * The grain is raised so there are no more chunks than WorkStealingQueue::Capacity.
+	 * Returns once every chunk ran. Runs serially when disabled, or when called from a thread unknown to the system
+	 */
+	template<typename F>
+	static void parallelFor(uint32_t count, uint32_t grainSize, const F& body);
+
+	inline static void setEnabled(bool cond) { enabled = cond; }
+	inline static bool isEnabled() { return enabled; }
+
+	/**
+	 * \return Number of threads running jobs, the main thread included
+	 */
+	inline static uint32_t getThreadCount() { return (uint32_t)workers.size(); }
+
+	/**
+	 * \return Jobs taken from another thread's queue since the last reset, to check the load balancing
+	 */
+	inline static uint32_t getStealCount() { return steals.load(std::memory_order_relaxed); }
+	inline static void resetStealCount() { steals.store(0, std::memory_order_relaxed); }
+
+private:
+	struct Worker {
+		WorkStealingQueue queue;
+		std::vector<Job> pool;		// Ring of jobs queued by this thread
+		std::unique_ptr<std::atomic<bool>[]> queued;	// Per slot, cleared once its job was taken
+		uint32_t next = 0;
+		uint32_t random = 0;		// xorshift state to pick the queue to steal from
+	};
+
+	static void notifyWorkers();
+	static bool take(Worker& owner, Job* slot, Job& job);
+	static bool findJob(Job& job);
+	static void execute(const Job& job);
+	static void workerLoop(uint32_t index);
+
+	inline static std::vector<std::unique_ptr<Worker>> workers;
+	inline static std::vector<std::thread> threads;
+	inline static std::atomic<bool> running{ false };
+	inline static std::atomic<uint32_t> pendingJobs{ 0 };	// Queued but not started, the workers sleep at 0
+	inline static std::atomic<uint32_t> steals{ 0 };
+	inline static std::mutex sleepMutex;
+	inline static std::condition_variable sleepCondition;
+	inline static bool enabled = true;
+
+	inline static thread_local int threadIndex = -1;
+};
+
+template<typename F>
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, const F& body)
+{
+	if (count == 0)
+		return;
+
+	// At most a queue of chunks, so one parallelFor does not overflow its queue and run the rest serially
+	const uint32_t minGrainSize = (uint32_t)((count + WorkStealingQueue::Capacity - 1) / WorkStealingQueue::Capacity);
+	grainSize = grainSize > minGrainSize ? grainSize : minGrainSize;
+	grainSize = grainSize > 0 ? grainSize : 1;
+	if (!enabled || workers.size() < 2 || threadIndex < 0 || count <= grainSize) {
+		body(0u, count);
+		return;
+	}
+
+	const uint32_t chunks = (count + grainSize - 1) / grainSize;
+	std::atomic<uint32_t> counter(chunks);
+
+	const JobFunction function = [](const Job& job) { (*(const F*)job.data)(job.begin, job.end); };
+	for (uint32_t chunk = 1; chunk < chunks; chunk++) {
+		const uint32_t begin = chunk * grainSize;
+		const uint32_t end = begin + grainSize < count ? begin + grainSize : count;
+		spawn({ function, &body, begin, end, &counter });
+	}
+	notifyWorkers();
+
+	// The first chunk runs here while the others get stolen
+	body(0u, grainSize);
+	counter.fetch_sub(1, std::memory_order_acq_rel);
+
+	wait(counter);
+}
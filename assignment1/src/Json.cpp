@@ -0,0 +1,262 @@
+#include "Json.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+namespace {
+	// Recursive descent over the text, stops at the first error
+	struct Parser {
+		const std::string& text;
+		size_t position = 0;
+		std::string error;
+
+		void skipSpaces() {
+			while (position < text.size()) {
+				const char c = text[position];
+				if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+					break;
+				position++;
+			}
+		}
+
+		bool fail(const char* reason) {
+			if (error.empty()) {
+				size_t line = 1;
+				for (size_t i = 0; i < position && i < text.size(); i++)
+					line += text[i] == '\n';
+				error = "line " + std::to_string(line) + ": " + reason;
+			}
+			return false;
+		}
+
+		bool expect(char c) {
+			skipSpaces();
+			if (position >= text.size() || text[position] != c)
+				return fail((std::string("expected '") + c + "'").c_str());
+			position++;
+			return true;
+		}
+
+		bool literal(const char* word) {
+			const size_t length = std::strlen(word);
+			if (text.compare(position, length, word) != 0)
+				return fail("unknown literal");
+			position += length;
+			return true;
+		}
+
+		// Four hex digits of a \u escape
+		bool parseHex(uint32_t& code) {
+			if (position + 4 > text.size())
+				return fail("truncated \\u escape");
+			code = 0;
+			for (int i = 0; i < 4; i++) {
+				const char c = text[position++];
+				const int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+				if (digit < 0)
+					return fail("expected a hex digit in a \\u escape");
+				code = code * 16 + (uint32_t)digit;
+			}
+			return true;
+		}
+
+		// \u escapes are written as UTF-8, a code point past U+FFFF is a surrogate pair
+		bool parseCodePoint(std::string& out) {
+			uint32_t code;
+			if (!parseHex(code))
+				return false;
+			if (code >= 0xDC00 && code <= 0xDFFF)
+				return fail("unpaired surrogate");
+			if (code >= 0xD800 && code <= 0xDBFF) {
+				uint32_t low;
+				if (text.compare(position, 2, "\\u") != 0)
+					return fail("unpaired surrogate");
+				position += 2;
+				if (!parseHex(low))
+					return false;
+				if (low < 0xDC00 || low > 0xDFFF)
+					return fail("unpaired surrogate");
+				code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			}
+
+			if (code < 0x80) {
+				out += (char)code;
+			} else if (code < 0x800) {
+				out += (char)(0xC0 | (code >> 6));
+				out += (char)(0x80 | (code & 0x3F));
+			} else if (code < 0x10000) {
+				out += (char)(0xE0 | (code >> 12));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			} else {
+				out += (char)(0xF0 | (code >> 18));
+				out += (char)(0x80 | ((code >> 12) & 0x3F));
+				out += (char)(0x80 | ((code >> 6) & 0x3F));
+				out += (char)(0x80 | (code & 0x3F));
+			}
+			return true;
+		}
+
+		bool parseString(std::string& out) {
+			if (!expect('"'))
+				return false;
+
+			out.clear();
+			while (position < text.size() && text[position] != '"') {
+				char c = text[position++];
+				if ((unsigned char)c < 0x20)
+					return fail("control character in a string");
+				if (c == '\\') {
+					if (position >= text.size())
+						break;
+					const char escaped = text[position++];
+					switch (escaped) {
+					case '"': case '\\': case '/': c = escaped; break;
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case 'r': c = '\r'; break;
+					case 'b': c = '\b'; break;
+					case 'f': c = '\f'; break;
+					case 'u':
+						if (!parseCodePoint(out))
+							return false;
+						continue;
+					default:
+						position--;
+						return fail("invalid escape");
+					}
+				}
+				out += c;
+			}
+			if (position >= text.size())
+				return fail("unterminated string");
+			position++;
+			return true;
+		}
+
+		bool parseValue(JsonValue& out, int depth) {
+			if (depth > 256)
+				return fail("nested too deep");
+
+			skipSpaces();
+			if (position >= text.size())
+				return fail("unexpected end");
+
+			const char c = text[position];
+			if (c == '{') {
+				out.type = JsonValue::Type::Object;
+				position++;
+				skipSpaces();
+				if (position < text.size() && text[position] == '}') {
+					position++;
+					return true;
+				}
+				do {
+					std::pair<std::string, JsonValue> member;
+					if (!parseString(member.first) || !expect(':') || !parseValue(member.second, depth + 1))
+						return false;
+					out.members.push_back(std::move(member));
+					skipSpaces();
+				} while (position < text.size() && text[position] == ',' && ++position);
+				return expect('}');
+			}
+			if (c == '[') {
+				out.type = JsonValue::Type::Array;
+				position++;
+				skipSpaces();
+				if (position < text.size() && text[position] == ']') {
+					position++;
+					return true;
+				}
+				do {
+					out.array.emplace_back();
+					if (!parseValue(out.array.back(), depth + 1))
+						return false;
+					skipSpaces();
+				} while (position < text.size() && text[position] == ',' && ++position);
+				return expect(']');
+			}
+			if (c == '"') {
+				out.type = JsonValue::Type::String;
+				return parseString(out.string);
+			}
+			if (c == 't' || c == 'f') {
+				out.type = JsonValue::Type::Bool;
+				out.boolean = c == 't';
+				return literal(out.boolean ? "true" : "false");
+			}
+			if (c == 'n') {
+				out.type = JsonValue::Type::Null;
+				return literal("null");
+			}
+
+			return parseNumber(out);
+		}
+
+		// -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?, checked before strtod which also takes NaN, Infinity, +1 or 0x10
+		bool parseNumber(JsonValue& out) {
+			const size_t start = position;
+			auto digits = [this] {
+				const size_t first = position;
+				while (position < text.size() && text[position] >= '0' && text[position] <= '9')
+					position++;
+				return position - first;
+			};
+
+			if (position < text.size() && text[position] == '-')
+				position++;
+			if (position >= text.size() || text[position] < '0' || text[position] > '9')
+				return fail("unexpected character");
+			if (text[position] == '0')
+				position++;
+			else
+				digits();
+			if (position < text.size() && text[position] == '.') {
+				position++;
+				if (digits() == 0)
+					return fail("expected a digit after '.'");
+			}
+			if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+				position++;
+				if (position < text.size() && (text[position] == '+' || text[position] == '-'))
+					position++;
+				if (digits() == 0)
+					return fail("expected a digit in the exponent");
+			}
+
+			out.number = std::strtod(text.substr(start, position - start).c_str(), nullptr);
+			if (!std::isfinite(out.number))
+				return fail("number out of range");
+			out.type = JsonValue::Type::Number;
+			return true;
+		}
+	};
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+	for (const auto& member : members) {
+		if (member.first == key)
+			return &member.second;
+	}
+	return nullptr;
+}
+
+bool Json::parse(const std::string& text, JsonValue& out, std::string& error)
+{
+	Parser parser{ text };
+	out = JsonValue();
+	if (!parser.parseValue(out, 0)) {
+		error = parser.error;
+		return false;
+	}
+
+	parser.skipSpaces();
+	if (parser.position != text.size()) {
+		parser.fail("text after the document");
+		error = parser.error;
+		return false;
+	}
+	return true;
+}
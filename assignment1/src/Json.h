@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * \brief Parsed JSON document, only used offline by the scene compiler and the glTF import. Numbers are doubles, members keep their order
+ */
+struct JsonValue {
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> members;
+
+	/**
+	 * \return The member named key, nullptr if there is none or this is not an object
+	 */
+	const JsonValue* find(const std::string& key) const;
+
+	bool isNumber() const { return type == Type::Number; }
+	bool isString() const { return type == Type::String; }
+	bool isArray() const { return type == Type::Array; }
+	bool isObject() const { return type == Type::Object; }
+};
+
+class Json
+{
+public:
+	/**
+	 * \brief Parses a whole document (RFC 8259), strings are UTF-8 with the \\u escapes decoded
+	 * \param error Set to "line N: reason" when false is returned
+	 */
+	static bool parse(const std::string& text, JsonValue& out, std::string& error);
+};
@@ -7,3 +7,16 @@ struct Light {
 	glm::vec4 color = { 1, 1, 1, 1 };
 	float ambientStrength = 0.5;
 };
+
+// Point light component, placed by the Transform of its entity. Drawn by the clustered forward pass
+struct PointLight {
+	glm::vec3 color = { 1, 1, 1 };
+	float intensity = 1.0f;
+	float radius = 4.0f;	// Nothing is lit past this distance
+};
+
+// std430 layout of a point light in the light buffer (binding 5, see shaders/cluster.glsl)
+struct PointLightData {
+	glm::vec4 positionRadius;
+	glm::vec4 colorIntensity;
+};
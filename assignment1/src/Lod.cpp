@@ -0,0 +1,17 @@
+#include "Lod.h"
+
+float Lod::projectedSize(float length, float distance, const glm::mat4& projection, uint32_t viewportHeight)
+{
+	// projection[1][1] is 1 / tan(fov / 2): a length at distance 1 covers projection[1][1] half viewports
+	const float focal = projection[1][1] * (float)viewportHeight * 0.5f;
+	return length * focal / glm::max(distance, 1e-4f);
+}
+
+bool Lod::isCoarse(float pixels, const LodSettings& settings, bool wasCoarse)
+{
+	if (!settings.enabled)
+		return false;
+
+	const float margin = settings.threshold * settings.hysteresis;
+	return wasCoarse ? pixels < settings.threshold + margin : pixels < settings.threshold - margin;
+}
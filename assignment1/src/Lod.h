@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Level of detail selection of a kind of object
+struct LodSettings {
+	bool enabled = true;
+	float threshold = 8.0f;		// Projected size in pixels under which the coarser level is drawn
+	float hysteresis = 0.25f;	// Fraction of the threshold the size must cross to change level
+};
+
+// What was drawn at every level, the finest first
+struct LodStats {
+	static constexpr int MaxLevels = 3;
+
+	uint32_t objects[MaxLevels] = {};	// Objects drawn at the level
+	uint32_t instances[MaxLevels] = {};	// Instances submitted for them
+};
+
+/**
+ * \brief Levels of detail chosen from the size of an object on screen. The level only changes once the size
+ * moved past the threshold by the hysteresis margin, an object sitting on the threshold does not pop every frame
+ */
+class Lod
+{
+public:
+	/**
+	 * \return Size in pixels of a length seen at the given distance
+	 * \param projection Perspective projection of the camera
+	 */
+	static float projectedSize(float length, float distance, const glm::mat4& projection, uint32_t viewportHeight);
+
+	/**
+	 * \return true if the coarser level should be drawn
+	 * \param wasCoarse Choice of the previous frame, kept while the size is inside the hysteresis band
+	 */
+	static bool isCoarse(float pixels, const LodSettings& settings, bool wasCoarse);
+};
@@ -0,0 +1,72 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path, bool copyOnWrite)
+	: copyOnWrite(copyOnWrite)
+{
+	const DWORD share = copyOnWrite ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ;
+	file = CreateFileA(path.c_str(), GENERIC_READ, share, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		return;
+
+	mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+		return;
+
+	data = MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	if (data)
+		size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+}
+#else
+MappedFile::MappedFile(const std::string& path, bool copyOnWrite)
+	: copyOnWrite(copyOnWrite)
+{
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	// The mapping keeps its own reference to the file
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		const int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+		void* mapped = mmap(nullptr, (size_t)status.st_size, protection, MAP_PRIVATE, file, 0);
+		if (mapped != MAP_FAILED) {
+			data = mapped;
+			size = (size_t)status.st_size;
+		}
+	}
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data)
+		munmap(data, size);
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+
+/**
+ * \brief Read only view of a whole file, mapped in memory by the OS instead of read into a buffer.
+ * Pages are loaded when first touched and shared with the file cache
+ */
+class MappedFile
+{
+public:
+	/**
+	 * \param copyOnWrite The view can be written, a page written to becomes a private copy and the file is untouched.
+	 * Other processes may write the file meanwhile, the pages not written to may see their writes
+	 */
+	MappedFile(const std::string& path, bool copyOnWrite = false);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * \brief False if the file could not be opened or is empty
+	 */
+	bool isOpen() const { return data != nullptr; }
+
+	const void* getData() const { return data; }
+	void* getWritableData() { return copyOnWrite ? data : nullptr; }
+	size_t getSize() const { return size; }
+
+private:
+	void* data = nullptr;
+	bool copyOnWrite;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;		// HANDLE of the file and of its mapping
+	void* mapping = nullptr;
+#endif
+};
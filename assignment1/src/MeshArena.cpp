@@ -0,0 +1,125 @@
+#include "MeshArena.h"
+#include <GL/glew.h>
+#include <cfloat>
+
+namespace {
+	// Replaces buffer by a new one of newSize bytes starting with the oldSize bytes of the old one
+	void resizeBuffer(uint32_t& buffer, size_t oldSize, size_t newSize)
+	{
+		uint32_t resized;
+		glCreateBuffers(1, &resized);
+		glNamedBufferData(resized, newSize, nullptr, GL_STATIC_DRAW);
+		if (buffer) {
+			glCopyNamedBufferSubData(buffer, resized, 0, 0, oldSize);
+			glDeleteBuffers(1, &buffer);
+		}
+		buffer = resized;
+	}
+}
+
+MeshArena::~MeshArena()
+{
+	if (vao) {
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &vbo);
+		glDeleteBuffers(1, &ibo);
+	}
+}
+
+MeshID MeshArena::addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+	for (const Vertex& vertex : vertices) {
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+
+	const MeshID id = allocate((uint32_t)vertices.size(), (uint32_t)indices.size(), boundsMin, boundsMax);
+	pendingMeshes.push_back(id);
+	pendingVertices.insert(pendingVertices.end(), vertices.begin(), vertices.end());
+	pendingIndices.insert(pendingIndices.end(), indices.begin(), indices.end());
+	return id;
+}
+
+MeshID MeshArena::reserveMesh(uint32_t vertexCount, uint32_t indexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	return allocate(vertexCount, indexCount, boundsMin, boundsMax);
+}
+
+MeshID MeshArena::allocate(uint32_t vertexCount, uint32_t indexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	MeshInfo info;
+	info.baseVertex = this->vertexCount;
+	info.vertexCount = vertexCount;
+	info.firstIndex = this->indexCount;
+	info.indexCount = indexCount;
+	info.boundsMin = boundsMin;
+	info.boundsMax = boundsMax;
+
+	this->vertexCount += vertexCount;
+	this->indexCount += indexCount;
+	meshes.push_back(info);
+
+	return (MeshID)meshes.size() - 1;
+}
+
+void MeshArena::upload()
+{
+	if (!vao)
+		glGenVertexArrays(1, &vao);
+
+	// Doubling keeps the copies rare when many meshes are loaded one by one
+	bool resized = false;
+	if (vertexCount > vertexCapacity) {
+		const uint32_t capacity = glm::max(vertexCount, vertexCapacity * 2);
+		resizeBuffer(vbo, vertexCapacity * sizeof(Vertex), capacity * sizeof(Vertex));
+		vertexCapacity = capacity;
+		resized = true;
+	}
+	if (indexCount > indexCapacity) {
+		const uint32_t capacity = glm::max(indexCount, indexCapacity * 2);
+		resizeBuffer(ibo, indexCapacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+		indexCapacity = capacity;
+		resized = true;
+	}
+
+	size_t vertexOffset = 0, indexOffset = 0;
+	for (MeshID id : pendingMeshes) {
+		const MeshInfo& info = meshes[id];
+		glNamedBufferSubData(vbo, info.baseVertex * sizeof(Vertex), info.vertexCount * sizeof(Vertex), &pendingVertices[vertexOffset]);
+		glNamedBufferSubData(ibo, info.firstIndex * sizeof(uint32_t), info.indexCount * sizeof(uint32_t), &pendingIndices[indexOffset]);
+		vertexOffset += info.vertexCount;
+		indexOffset += info.indexCount;
+	}
+	pendingMeshes.clear();
+	pendingVertices.clear();
+	pendingIndices.clear();
+
+	glBindVertexArray(vao);
+	if (resized)
+		setVertexAttributes();
+}
+
+void MeshArena::setVertexAttributes()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+
+	// position attribute
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+	glEnableVertexAttribArray(0);
+
+	// normal attribute
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+	glEnableVertexAttribArray(1);
+
+	// colour attribute, after the instance attributes (2 to 9, see Renderer::init)
+	glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+	glEnableVertexAttribArray(10);
+}
+
+void MeshArena::bind() const
+{
+	glBindVertexArray(vao);
+}
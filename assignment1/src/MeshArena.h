@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+using MeshID = uint32_t;
+constexpr MeshID InvalidMesh = ~0u;
+
+struct Vertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec4 color = glm::vec4(1.0f);	// Multiplied by the instance colour, lets a merged mesh keep the colours of its parts
+};
+
+// Where a mesh lives inside the arena buffers
+struct MeshInfo {
+	uint32_t baseVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+
+	// Local space bounding box, used for culling
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+/**
+ * \brief Packs every static mesh into one shared vertex buffer and one shared index buffer
+ * so that any mix of meshes can be drawn from a single VAO (and a single glMultiDrawElementsIndirect)
+ */
+class MeshArena
+{
+public:
+	MeshArena() = default;
+	~MeshArena();
+
+	/**
+	 * \brief Appends a mesh to the arena, it is on the GPU after the next upload(). Indices are relative to the mesh's first vertex
+	 * \return The ID used to reference the mesh in draw calls
+	 */
+	MeshID addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	/**
+	 * \brief Appends a mesh without its data, the range exists after the next upload() and is written on the GPU
+	 * (see Renderer::loadMesh)
+	 */
+	MeshID reserveMesh(uint32_t vertexCount, uint32_t indexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	/**
+	 * \brief Grows the GPU buffers to fit every mesh and uploads the meshes added since the last call.
+	 * Must be called once OpenGL is ready, on the thread owning the context
+	 */
+	void upload();
+
+	void bind() const;
+
+	const MeshInfo& getMesh(MeshID id) const { return meshes[id]; }
+	uint32_t getMeshCount() const { return (uint32_t)meshes.size(); }
+	uint32_t getRendererID() const { return vao; }
+	uint32_t getVertexBuffer() const { return vbo; }
+	uint32_t getIndexBuffer() const { return ibo; }
+
+private:
+	MeshID allocate(uint32_t vertexCount, uint32_t indexCount, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	/**
+	 * \brief Points the vertex attributes and the element buffer of the VAO at the current buffers
+	 */
+	void setVertexAttributes();
+
+	std::vector<MeshInfo> meshes;
+	uint32_t vertexCount = 0;		// Allocated in the buffers
+	uint32_t indexCount = 0;
+	uint32_t vertexCapacity = 0;
+	uint32_t indexCapacity = 0;
+
+	// Added by addMesh since the last upload, one after the other
+	std::vector<MeshID> pendingMeshes;
+	std::vector<Vertex> pendingVertices;
+	std::vector<uint32_t> pendingIndices;
+
+	uint32_t vao = 0;
+	uint32_t vbo = 0;
+	uint32_t ibo = 0;
+};
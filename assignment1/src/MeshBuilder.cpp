@@ -0,0 +1,50 @@
+#include "MeshBuilder.h"
+#include <glm/gtc/matrix_inverse.hpp>
+
+void MeshBuilder::addBox(const glm::mat4& transform, const glm::vec4& color)
+{
+	// Each face is two triangles (v0, v1, v2) (v2, v3, v0) with its own normal
+	static const Vertex cube[24] = {
+		{ {-0.5f, -0.5f, -0.5f}, { 0.0f,  0.0f, -1.0f} },
+		{ { 0.5f, -0.5f, -0.5f}, { 0.0f,  0.0f, -1.0f} },
+		{ { 0.5f,  0.5f, -0.5f}, { 0.0f,  0.0f, -1.0f} },
+		{ {-0.5f,  0.5f, -0.5f}, { 0.0f,  0.0f, -1.0f} },
+
+		{ {-0.5f, -0.5f,  0.5f}, { 0.0f,  0.0f,  1.0f} },
+		{ { 0.5f, -0.5f,  0.5f}, { 0.0f,  0.0f,  1.0f} },
+		{ { 0.5f,  0.5f,  0.5f}, { 0.0f,  0.0f,  1.0f} },
+		{ {-0.5f,  0.5f,  0.5f}, { 0.0f,  0.0f,  1.0f} },
+
+		{ {-0.5f,  0.5f,  0.5f}, {-1.0f,  0.0f,  0.0f} },
+		{ {-0.5f,  0.5f, -0.5f}, {-1.0f,  0.0f,  0.0f} },
+		{ {-0.5f, -0.5f, -0.5f}, {-1.0f,  0.0f,  0.0f} },
+		{ {-0.5f, -0.5f,  0.5f}, {-1.0f,  0.0f,  0.0f} },
+
+		{ { 0.5f,  0.5f,  0.5f}, { 1.0f,  0.0f,  0.0f} },
+		{ { 0.5f,  0.5f, -0.5f}, { 1.0f,  0.0f,  0.0f} },
+		{ { 0.5f, -0.5f, -0.5f}, { 1.0f,  0.0f,  0.0f} },
+		{ { 0.5f, -0.5f,  0.5f}, { 1.0f,  0.0f,  0.0f} },
+
+		{ {-0.5f, -0.5f, -0.5f}, { 0.0f, -1.0f,  0.0f} },
+		{ { 0.5f, -0.5f, -0.5f}, { 0.0f, -1.0f,  0.0f} },
+		{ { 0.5f, -0.5f,  0.5f}, { 0.0f, -1.0f,  0.0f} },
+		{ {-0.5f, -0.5f,  0.5f}, { 0.0f, -1.0f,  0.0f} },
+
+		{ {-0.5f,  0.5f, -0.5f}, { 0.0f,  1.0f,  0.0f} },
+		{ { 0.5f,  0.5f, -0.5f}, { 0.0f,  1.0f,  0.0f} },
+		{ { 0.5f,  0.5f,  0.5f}, { 0.0f,  1.0f,  0.0f} },
+		{ {-0.5f,  0.5f,  0.5f}, { 0.0f,  1.0f,  0.0f} },
+	};
+
+	// Normals go through the inverse transpose, right for the non uniform and negative scales of the parts
+	const glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(transform));
+
+	const uint32_t first = (uint32_t)vertices.size();
+	for (const Vertex& vertex : cube)
+		vertices.push_back({ glm::vec3(transform * glm::vec4(vertex.position, 1.0f)), glm::normalize(normalMatrix * vertex.normal), color });
+
+	for (uint32_t face = 0; face < 6; face++) {
+		const uint32_t v = first + face * 4;
+		indices.insert(indices.end(), { v, v + 1, v + 2, v + 2, v + 3, v });
+	}
+}
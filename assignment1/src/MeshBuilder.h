@@ -0,0 +1,26 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshArena.h"
+
+/**
+ * \brief Merges transformed shapes into one vertex and index list, ready for MeshArena::addMesh.
+ * A model made of many parts can then be drawn as a single mesh with a single transform
+ */
+class MeshBuilder
+{
+public:
+	/**
+	 * \brief Appends a unit cube (centered at the origin, size 1) moved by transform, every vertex gets the colour
+	 */
+	void addBox(const glm::mat4& transform = glm::mat4(1.0f), const glm::vec4& color = glm::vec4(1.0f));
+
+	void clear() { vertices.clear(); indices.clear(); }
+
+	const std::vector<Vertex>& getVertices() const { return vertices; }
+	const std::vector<uint32_t>& getIndices() const { return indices; }
+
+private:
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+};
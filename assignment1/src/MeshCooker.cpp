@@ -0,0 +1,767 @@
+#include "MeshCooker.h"
+#include "MeshOptimizer.h"
+#include "BinaryFile.h"
+#include "Json.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace {
+	// Same mapping as octEncode in gbuffer.glsl
+	glm::vec2 octEncode(glm::vec3 n)
+	{
+		n /= glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+		if (n.z >= 0.0f)
+			return glm::vec2(n.x, n.y);
+		return glm::vec2((1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	int16_t toSnorm(float x) { return (int16_t)std::lround(glm::clamp(x, -1.0f, 1.0f) * 32767.0f); }
+
+	// OBJ indices start at 1, negative ones count back from the last element read. 0 (missing) becomes -1
+	int resolveIndex(int index, size_t count) { return index < 0 ? (int)count + index : index - 1; }
+
+	// Area weighted average of the faces around the vertices without a normal, then every normal is normalised
+	void smoothNormals(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint8_t>& missingNormal)
+	{
+		std::vector<glm::vec3> smoothed(vertices.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			const glm::vec3& a = vertices[indices[i]].position;
+			const glm::vec3 faceNormal = glm::cross(vertices[indices[i + 1]].position - a, vertices[indices[i + 2]].position - a);
+			for (size_t k = 0; k < 3; k++)
+				smoothed[indices[i + k]] += faceNormal;
+		}
+
+		for (size_t i = 0; i < vertices.size(); i++) {
+			glm::vec3& normal = vertices[i].normal;
+			if (missingNormal[i])
+				normal = smoothed[i];
+			normal = glm::dot(normal, normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0, 1, 0);
+		}
+	}
+
+	bool readFile(const std::string& path, std::string& out)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		out = stream.str();
+		return true;
+	}
+
+	// Buffers, accessors and the node hierarchy of a glTF 2.0 document, the triangles of every mesh instance are
+	// appended in world space
+	struct GltfImport {
+		const JsonValue& document;
+		std::vector<std::string> buffers;
+		std::vector<Vertex>& vertices;
+		std::vector<uint32_t>& indices;
+		std::vector<uint8_t>& missingNormal;
+		std::string error;
+
+		bool fail(const std::string& reason) {
+			if (error.empty())
+				error = reason;
+			return false;
+		}
+
+		// Whole non-negative number, fallback when the member is missing
+		bool readIndex(const JsonValue& object, const char* key, size_t& out, size_t fallback) {
+			const JsonValue* value = object.find(key);
+			if (!value) {
+				out = fallback;
+				return true;
+			}
+			if (!value->isNumber() || value->number < 0.0 || value->number != std::floor(value->number) || value->number > 4294967295.0)
+				return fail(std::string("\"") + key + "\" must be a whole number");
+			out = (size_t)value->number;
+			return true;
+		}
+
+		const JsonValue* element(const char* array, size_t index) {
+			const JsonValue* values = document.find(array);
+			if (!values || !values->isArray() || index >= values->array.size() || !values->array[index].isObject()) {
+				fail(std::string("missing ") + array + " " + std::to_string(index));
+				return nullptr;
+			}
+			return &values->array[index];
+		}
+
+		bool loadBuffers(const std::string& directory, const std::string* glbChunk) {
+			const JsonValue* list = document.find("buffers");
+			if (!list)
+				return true;
+			if (!list->isArray())
+				return fail("\"buffers\" must be an array");
+
+			for (size_t i = 0; i < list->array.size(); i++) {
+				const JsonValue& buffer = list->array[i];
+				size_t byteLength;
+				if (!buffer.isObject() || !readIndex(buffer, "byteLength", byteLength, 0))
+					return fail("buffers must be JSON objects");
+
+				const JsonValue* uri = buffer.find("uri");
+				std::string bytes;
+				if (!uri) {
+					// The BIN chunk of a .glb
+					if (i != 0 || !glbChunk)
+						return fail("buffer " + std::to_string(i) + " has no uri");
+					bytes = *glbChunk;
+				} else if (!uri->isString()) {
+					return fail("buffer uris must be strings");
+				} else if (uri->string.compare(0, 5, "data:") == 0) {
+					const size_t comma = uri->string.find(";base64,");
+					if (comma == std::string::npos || !decodeBase64(uri->string.substr(comma + 8), bytes))
+						return fail("buffer " + std::to_string(i) + " is not a base64 data uri");
+				} else if (!readFile(directory + uri->string, bytes)) {
+					return fail("failed to open " + directory + uri->string);
+				}
+
+				if (bytes.size() < byteLength)
+					return fail("buffer " + std::to_string(i) + " is shorter than its byteLength");
+				buffers.push_back(std::move(bytes));
+			}
+			return true;
+		}
+
+		static bool decodeBase64(const std::string& text, std::string& out) {
+			uint32_t bits = 0;
+			int count = 0;
+			for (char c : text) {
+				int value;
+				if (c >= 'A' && c <= 'Z') value = c - 'A';
+				else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+				else if (c >= '0' && c <= '9') value = c - '0' + 52;
+				else if (c == '+') value = 62;
+				else if (c == '/') value = 63;
+				else if (c == '=') break;
+				else return false;
+
+				bits = bits << 6 | (uint32_t)value;
+				count += 6;
+				if (count >= 8) {
+					count -= 8;
+					out += (char)((bits >> count) & 0xFF);
+				}
+			}
+			return true;
+		}
+
+		// Elements of an accessor, element i is at data + i * stride. Checks the component type, the element type and that
+		// every element lies inside its buffer view and buffer
+		bool readAccessor(size_t index, const char* type, const std::vector<int>& componentTypes, const char*& data, size_t& count,
+			size_t& stride, int& componentType) {
+			const JsonValue* accessor = element("accessors", index);
+			if (!accessor)
+				return false;
+			if (accessor->find("sparse"))
+				return fail("sparse accessors are not supported");
+
+			const JsonValue* typeName = accessor->find("type");
+			size_t component, viewIndex, accessorOffset;
+			if (!typeName || !typeName->isString() || typeName->string != type)
+				return fail("accessor " + std::to_string(index) + " must be a " + type);
+			if (!readIndex(*accessor, "componentType", component, 0) || !readIndex(*accessor, "count", count, 0)
+				|| !readIndex(*accessor, "bufferView", viewIndex, SIZE_MAX) || !readIndex(*accessor, "byteOffset", accessorOffset, 0))
+				return false;
+
+			componentType = (int)component;
+			size_t componentSize = 0;
+			for (int allowed : componentTypes) {
+				if (componentType == allowed)
+					componentSize = allowed == 5121 ? 1 : allowed == 5123 ? 2 : 4;
+			}
+			if (componentSize == 0)
+				return fail("accessor " + std::to_string(index) + " has an unsupported component type");
+			if (viewIndex == SIZE_MAX)
+				return fail("accessor " + std::to_string(index) + " has no buffer view");
+
+			const JsonValue* view = element("bufferViews", viewIndex);
+			size_t bufferIndex, viewOffset, viewLength, viewStride;
+			if (!view || !readIndex(*view, "buffer", bufferIndex, SIZE_MAX) || !readIndex(*view, "byteOffset", viewOffset, 0)
+				|| !readIndex(*view, "byteLength", viewLength, 0) || !readIndex(*view, "byteStride", viewStride, 0))
+				return false;
+			if (bufferIndex >= buffers.size() || viewOffset > buffers[bufferIndex].size() || viewLength > buffers[bufferIndex].size() - viewOffset)
+				return fail("buffer view " + std::to_string(viewIndex) + " is outside of its buffer");
+
+			const size_t elementSize = componentSize * (std::strcmp(type, "VEC3") == 0 ? 3 : 1);
+			stride = viewStride > 0 ? viewStride : elementSize;
+			if (stride < elementSize)
+				return fail("buffer view " + std::to_string(viewIndex) + " has a stride below the element size");
+			if (count > 0 && (accessorOffset > viewLength || elementSize > viewLength - accessorOffset
+				|| (count - 1) > (viewLength - accessorOffset - elementSize) / stride))
+				return fail("accessor " + std::to_string(index) + " is outside of its buffer view");
+
+			data = buffers[bufferIndex].data() + viewOffset + accessorOffset;
+			return true;
+		}
+
+		bool addPrimitive(const JsonValue& primitive, const glm::mat4& world) {
+			size_t mode;
+			if (!primitive.isObject() || !readIndex(primitive, "mode", mode, 4))
+				return fail("primitives must be JSON objects");
+			if (mode != 4)
+				return true;		// Points and lines have no triangle to cook
+
+			const JsonValue* attributes = primitive.find("attributes");
+			size_t positionIndex, normalIndex, indexIndex;
+			if (!attributes || !readIndex(*attributes, "POSITION", positionIndex, SIZE_MAX) || !readIndex(*attributes, "NORMAL", normalIndex, SIZE_MAX)
+				|| !readIndex(primitive, "indices", indexIndex, SIZE_MAX))
+				return false;
+			if (positionIndex == SIZE_MAX)
+				return fail("a primitive has no POSITION");
+
+			const char* positions;
+			size_t vertexCount, positionStride;
+			int componentType;
+			if (!readAccessor(positionIndex, "VEC3", { 5126 }, positions, vertexCount, positionStride, componentType))
+				return false;
+
+			const char* normals = nullptr;
+			size_t normalCount = 0, normalStride = 0;
+			if (normalIndex != SIZE_MAX && !readAccessor(normalIndex, "VEC3", { 5126 }, normals, normalCount, normalStride, componentType))
+				return false;
+			if (normals && normalCount != vertexCount)
+				return fail("NORMAL and POSITION counts differ");
+			if (vertices.size() + vertexCount > UINT32_MAX)
+				return fail("too many vertices");
+
+			const uint32_t first = (uint32_t)vertices.size();
+			const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+			for (size_t i = 0; i < vertexCount; i++) {
+				Vertex vertex;
+				glm::vec3 position;
+				std::memcpy(&position, positions + i * positionStride, sizeof(position));
+				vertex.position = glm::vec3(world * glm::vec4(position, 1.0f));
+				vertex.normal = glm::vec3(0.0f);
+				if (normals) {
+					glm::vec3 normal;
+					std::memcpy(&normal, normals + i * normalStride, sizeof(normal));
+					vertex.normal = normalMatrix * normal;
+				}
+				vertices.push_back(vertex);
+				missingNormal.push_back(normals == nullptr);
+			}
+
+			// Triangles keep their winding when the transform mirrors
+			const bool mirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+			auto addTriangle = [this, first, mirrored](uint32_t a, uint32_t b, uint32_t c) {
+				indices.push_back(first + a);
+				indices.push_back(first + (mirrored ? c : b));
+				indices.push_back(first + (mirrored ? b : c));
+			};
+
+			if (indexIndex == SIZE_MAX) {
+				for (uint32_t i = 0; i + 2 < vertexCount; i += 3)
+					addTriangle(i, i + 1, i + 2);
+				return true;
+			}
+
+			const char* data;
+			size_t indexCount, indexStride;
+			if (!readAccessor(indexIndex, "SCALAR", { 5121, 5123, 5125 }, data, indexCount, indexStride, componentType))
+				return false;
+
+			uint32_t triangle[3];
+			for (size_t i = 0; i + 2 < indexCount; i += 3) {
+				for (size_t k = 0; k < 3; k++) {
+					const char* at = data + (i + k) * indexStride;
+					uint32_t index = 0;
+					if (componentType == 5121) {
+						index = *(const uint8_t*)at;
+					} else if (componentType == 5123) {
+						uint16_t value;
+						std::memcpy(&value, at, sizeof(value));
+						index = value;
+					} else {
+						std::memcpy(&index, at, sizeof(index));
+					}
+					if (index >= vertexCount)
+						return fail("index out of range");
+					triangle[k] = index;
+				}
+				addTriangle(triangle[0], triangle[1], triangle[2]);
+			}
+			return true;
+		}
+
+		bool readFloats(const JsonValue& object, const char* key, float* out, size_t count) {
+			const JsonValue* value = object.find(key);
+			if (!value)
+				return true;
+			if (!value->isArray() || value->array.size() != count)
+				return fail(std::string("\"") + key + "\" must be an array of " + std::to_string(count) + " numbers");
+			for (size_t i = 0; i < count; i++) {
+				if (!value->array[i].isNumber())
+					return fail(std::string("\"") + key + "\" must be an array of " + std::to_string(count) + " numbers");
+				out[i] = (float)value->array[i].number;
+			}
+			return true;
+		}
+
+		bool addNode(size_t index, const glm::mat4& parent, size_t depth) {
+			// A valid hierarchy is a forest, deeper than the node count means a cycle
+			const JsonValue* node = element("nodes", index);
+			if (!node)
+				return false;
+			if (depth > document.find("nodes")->array.size())
+				return fail("the node hierarchy has a cycle");
+
+			float matrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+			float translation[3] = { 0, 0, 0 }, rotation[4] = { 0, 0, 0, 1 }, scale[3] = { 1, 1, 1 };
+			if (!readFloats(*node, "matrix", matrix, 16) || !readFloats(*node, "translation", translation, 3)
+				|| !readFloats(*node, "rotation", rotation, 4) || !readFloats(*node, "scale", scale, 3))
+				return false;
+
+			// Column major, then translation * rotation * scale
+			glm::mat4 local;
+			for (int column = 0; column < 4; column++)
+				for (int row = 0; row < 4; row++)
+					local[column][row] = matrix[column * 4 + row];
+			local = local * glm::translate(glm::mat4(1.0f), glm::vec3(translation[0], translation[1], translation[2]))
+				* glm::mat4_cast(glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]))
+				* glm::scale(glm::mat4(1.0f), glm::vec3(scale[0], scale[1], scale[2]));
+			const glm::mat4 world = parent * local;
+
+			size_t meshIndex;
+			if (!readIndex(*node, "mesh", meshIndex, SIZE_MAX))
+				return false;
+			if (meshIndex != SIZE_MAX) {
+				const JsonValue* mesh = element("meshes", meshIndex);
+				if (!mesh)
+					return false;
+				const JsonValue* primitives = mesh->find("primitives");
+				if (!primitives || !primitives->isArray())
+					return fail("meshes must have a \"primitives\" array");
+				for (const JsonValue& primitive : primitives->array) {
+					if (!addPrimitive(primitive, world))
+						return false;
+				}
+			}
+
+			if (const JsonValue* children = node->find("children")) {
+				if (!children->isArray())
+					return fail("\"children\" must be an array");
+				for (const JsonValue& child : children->array) {
+					if (!child.isNumber() || child.number < 0.0 || child.number != std::floor(child.number))
+						return fail("\"children\" must hold node indices");
+					if (!addNode((size_t)child.number, world, depth + 1))
+						return false;
+				}
+			}
+			return true;
+		}
+
+		bool addScene() {
+			// The default scene, else the first one, else every mesh once without a transform
+			size_t sceneIndex;
+			if (!readIndex(document, "scene", sceneIndex, 0))
+				return false;
+
+			const JsonValue* scenes = document.find("scenes");
+			if (!scenes || !scenes->isArray() || scenes->array.empty()) {
+				const JsonValue* meshes = document.find("meshes");
+				const size_t count = meshes && meshes->isArray() ? meshes->array.size() : 0;
+				for (size_t i = 0; i < count; i++) {
+					const JsonValue* primitives = meshes->array[i].find("primitives");
+					if (!primitives || !primitives->isArray())
+						return fail("meshes must have a \"primitives\" array");
+					for (const JsonValue& primitive : primitives->array) {
+						if (!addPrimitive(primitive, glm::mat4(1.0f)))
+							return false;
+					}
+				}
+				return true;
+			}
+
+			const JsonValue* scene = element("scenes", sceneIndex);
+			if (!scene)
+				return false;
+			if (const JsonValue* nodes = scene->find("nodes")) {
+				if (!nodes->isArray())
+					return fail("\"nodes\" of a scene must be an array");
+				for (const JsonValue& node : nodes->array) {
+					if (!node.isNumber() || node.number < 0.0 || node.number != std::floor(node.number))
+						return fail("\"nodes\" of a scene must hold node indices");
+					if (!addNode((size_t)node.number, glm::mat4(1.0f), 0))
+						return false;
+				}
+			}
+			return true;
+		}
+	};
+}
+
+bool MeshCooker::cook(const std::string& input, const std::string& output, bool optimize)
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	auto hasExtension = [&input](const char* extension) {
+		const size_t length = std::strlen(extension);
+		return input.size() >= length && input.compare(input.size() - length, length, extension) == 0;
+	};
+	const bool gltf = hasExtension(".gltf") || hasExtension(".glb");
+	if (!(gltf ? importGltf(input, vertices, indices) : importObj(input, vertices, indices)))
+		return false;
+
+	// Index orders compared at the end: as imported, then in meshlets or optimised and cut in meshlets
+	constexpr uint32_t cacheSizes[] = { 8, MeshOptimizer::CacheSize, 32 };
+	std::vector<uint32_t> steps[3];
+	steps[0] = indices;
+	const uint32_t vertexCount = (uint32_t)vertices.size();	// Above every index of the steps, unused vertices are dropped later
+
+	if (optimize)
+		MeshOptimizer::optimize(vertices, indices);
+	const std::vector<Meshlet> meshlets = buildMeshlets(vertices, indices, optimize);
+	steps[optimize ? 2 : 1] = indices;
+
+	if (!write(output, vertices, indices, meshlets))
+		return false;
+
+	std::cout << input << ": " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles, "
+		<< meshlets.size() << " meshlets, " << (vertices.size() <= 65536 ? 16 : 32) << "-bit indices" << std::endl;
+
+	std::cout << "  vertex shader invocations (ACMR, ATVR) with a FIFO cache of" << std::endl;
+	for (uint32_t cacheSize : cacheSizes) {
+		std::cout << "  " << cacheSize << " entries:";
+		const char* names[3] = { "imported", "meshlets", "optimised" };
+		for (int step = 0; step < 3; step++) {
+			if (steps[step].empty())
+				continue;
+
+			const VertexCacheStats stats = MeshOptimizer::analyzeVertexCache(steps[step], vertexCount, cacheSize);
+			std::cout << " " << names[step] << " " << stats.invocations << " (" << stats.acmr << ", " << stats.atvr << ")";
+		}
+		std::cout << std::endl;
+	}
+	return true;
+}
+
+bool MeshCooker::importObj(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	std::vector<glm::vec3> positions, normals;
+	std::unordered_map<uint64_t, uint32_t> corners;		// Position and normal indices to vertex
+	std::vector<uint8_t> missingNormal;					// Per vertex
+	std::vector<uint32_t> face;
+
+	std::string line, type, corner;
+	for (size_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+		std::istringstream stream(line);
+		if (!(stream >> type))
+			continue;
+
+		if (type == "v") {
+			glm::vec3 position;
+			stream >> position.x >> position.y >> position.z;
+			positions.push_back(position);
+		} else if (type == "vn") {
+			glm::vec3 normal;
+			stream >> normal.x >> normal.y >> normal.z;
+			normals.push_back(normal);
+		} else if (type == "f") {
+			// Corners are v, v/vt, v//vn or v/vt/vn, texture coordinates are not used
+			face.clear();
+			while (stream >> corner) {
+				const int position = resolveIndex(std::atoi(corner.c_str()), positions.size());
+				int normal = -1;
+				const size_t firstSlash = corner.find('/');
+				const size_t secondSlash = firstSlash == std::string::npos ? std::string::npos : corner.find('/', firstSlash + 1);
+				if (secondSlash != std::string::npos)
+					normal = resolveIndex(std::atoi(corner.c_str() + secondSlash + 1), normals.size());
+
+				if (position < 0 || position >= (int)positions.size() || normal >= (int)normals.size()) {
+					std::cout << path << ":" << lineNumber << ": index out of range" << std::endl;
+					return false;
+				}
+
+				const uint64_t key = (uint64_t)position << 32 | (uint32_t)normal;
+				const auto inserted = corners.emplace(key, (uint32_t)vertices.size());
+				if (inserted.second) {
+					Vertex vertex;
+					vertex.position = positions[position];
+					vertex.normal = normal >= 0 ? normals[normal] : glm::vec3(0.0f);
+					vertices.push_back(vertex);
+					missingNormal.push_back(normal < 0);
+				}
+				face.push_back(inserted.first->second);
+			}
+
+			for (size_t i = 2; i < face.size(); i++) {
+				indices.push_back(face[0]);
+				indices.push_back(face[i - 1]);
+				indices.push_back(face[i]);
+			}
+		}
+	}
+
+	if (indices.empty()) {
+		std::cout << path << ": no faces" << std::endl;
+		return false;
+	}
+
+	smoothNormals(vertices, indices, missingNormal);
+	return true;
+}
+
+bool MeshCooker::importGltf(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::string contents;
+	if (!readFile(path, contents)) {
+		std::cout << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	// .glb: 12 byte header, then the JSON chunk and an optional BIN chunk, each with its length and type
+	std::string text = contents;
+	std::string binary;
+	const bool glb = contents.size() >= 12 && contents.compare(0, 4, "glTF") == 0;
+	if (glb) {
+		auto readWord = [&contents](size_t offset) {
+			uint32_t word;
+			std::memcpy(&word, contents.data() + offset, sizeof(word));
+			return word;
+		};
+
+		if (readWord(4) != 2) {
+			std::cout << path << ": not a glTF 2.0 binary" << std::endl;
+			return false;
+		}
+
+		size_t offset = 12;
+		bool hasJson = false;
+		while (offset + 8 <= contents.size()) {
+			const uint32_t length = readWord(offset);
+			const uint32_t type = readWord(offset + 4);
+			if (length > contents.size() - offset - 8) {
+				std::cout << path << ": truncated chunk" << std::endl;
+				return false;
+			}
+			if (type == 0x4E4F534A && !hasJson) {			// "JSON"
+				text = contents.substr(offset + 8, length);
+				hasJson = true;
+			} else if (type == 0x004E4942 && binary.empty()) {	// "BIN\0"
+				binary = contents.substr(offset + 8, length);
+			}
+			offset += 8 + (size_t)length;
+		}
+		if (!hasJson) {
+			std::cout << path << ": no JSON chunk" << std::endl;
+			return false;
+		}
+	}
+
+	JsonValue document;
+	std::string error;
+	if (!Json::parse(text, document, error)) {
+		std::cout << path << ": " << error << std::endl;
+		return false;
+	}
+	if (!document.isObject()) {
+		std::cout << path << ": the document must be a JSON object" << std::endl;
+		return false;
+	}
+
+	const size_t slash = path.find_last_of("/\\");
+	const std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	std::vector<uint8_t> missingNormal;
+	GltfImport import{ document, {}, vertices, indices, missingNormal };
+	if (!import.loadBuffers(directory, glb ? &binary : nullptr) || !import.addScene()) {
+		std::cout << path << ": " << import.error << std::endl;
+		return false;
+	}
+	if (indices.empty()) {
+		std::cout << path << ": no triangles" << std::endl;
+		return false;
+	}
+
+	smoothNormals(vertices, indices, missingNormal);
+	return true;
+}
+
+std::vector<Meshlet> MeshCooker::buildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool keepOrder)
+{
+	const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+
+	const TriangleAdjacency adjacency = MeshOptimizer::buildTriangleAdjacency(indices.data(), (uint32_t)indices.size(), (uint32_t)vertices.size());
+	const std::vector<uint32_t>& offsets = adjacency.offsets;
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> owner(vertices.size(), ~0u);		// Last meshlet using the vertex
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> ordered;
+	ordered.reserve(indices.size());
+	std::vector<Meshlet> meshlets;
+
+	uint32_t nextSeed = 0;		// Triangles before it are all emitted
+	uint32_t remaining = triangleCount;
+	while (remaining > 0) {
+		const uint32_t id = (uint32_t)meshlets.size();
+		auto addedVertices = [&](uint32_t triangle) {
+			uint32_t count = 0;
+			for (uint32_t k = 0; k < 3; k++)
+				count += owner[indices[triangle * 3 + k]] != id;
+			return count;
+		};
+
+		Meshlet meshlet = {};
+		meshlet.firstIndex = (uint32_t)ordered.size();
+		meshletVertices.clear();
+
+		while (emitted[nextSeed])
+			nextSeed++;
+		uint32_t triangle = nextSeed;
+		while (true) {
+			emitted[triangle] = 1;
+			remaining--;
+			meshlet.triangleCount++;
+			for (uint32_t k = 0; k < 3; k++) {
+				const uint32_t vertex = indices[triangle * 3 + k];
+				ordered.push_back(vertex);
+				if (owner[vertex] != id) {
+					owner[vertex] = id;
+					meshletVertices.push_back(vertex);
+				}
+			}
+			if (meshlet.triangleCount == Meshlet::MaxTriangles || remaining == 0)
+				break;
+
+			// Neighbour adding the fewest vertices, else the next triangle of the input if it still fits (disconnected parts)
+			uint32_t best = ~0u, bestCost = 4;
+			for (size_t v = 0; v < meshletVertices.size() && !keepOrder; v++) {
+				const uint32_t vertex = meshletVertices[v];
+				for (uint32_t a = offsets[vertex]; a < offsets[vertex + 1] && bestCost > 0; a++) {
+					const uint32_t candidate = adjacency.triangles[a];
+					const uint32_t cost = emitted[candidate] ? 4 : addedVertices(candidate);
+					if (cost < bestCost && meshletVertices.size() + cost <= Meshlet::MaxVertices) {
+						best = candidate;
+						bestCost = cost;
+					}
+				}
+			}
+			if (best == ~0u) {
+				while (emitted[nextSeed])
+					nextSeed++;
+				if (meshletVertices.size() + addedVertices(nextSeed) > Meshlet::MaxVertices)
+					break;
+				best = nextSeed;
+			}
+			triangle = best;
+		}
+
+		// Sphere around the box of the vertices, good enough for culling
+		glm::vec3 boundsMin = glm::vec3(FLT_MAX), boundsMax = glm::vec3(-FLT_MAX);
+		for (uint32_t vertex : meshletVertices) {
+			boundsMin = glm::min(boundsMin, vertices[vertex].position);
+			boundsMax = glm::max(boundsMax, vertices[vertex].position);
+		}
+		const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (uint32_t vertex : meshletVertices)
+			radius = glm::max(radius, glm::length(vertices[vertex].position - center));
+
+		meshlet.vertexCount = (uint32_t)meshletVertices.size();
+		meshlet.sphere = glm::vec4(center, radius);
+		meshlets.push_back(meshlet);
+	}
+
+	indices.swap(ordered);
+	return meshlets;
+}
+
+bool MeshCooker::write(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	const std::vector<Meshlet>& meshlets)
+{
+	CookedMeshHeader header = {};
+	header.magic = CookedMeshHeader::Magic;
+	header.version = CookedMeshHeader::Version;
+	header.vertexCount = (uint32_t)vertices.size();
+	header.indexCount = (uint32_t)indices.size();
+	header.meshletCount = (uint32_t)meshlets.size();
+	header.indexSize = vertices.size() <= 65536 ? 2 : 4;
+
+	header.boundsMin = glm::vec3(FLT_MAX);
+	header.boundsMax = glm::vec3(-FLT_MAX);
+	for (const Vertex& vertex : vertices) {
+		header.boundsMin = glm::min(header.boundsMin, vertex.position);
+		header.boundsMax = glm::max(header.boundsMax, vertex.position);
+	}
+
+	// Flat axes quantise to 0
+	const glm::vec3 extent = header.boundsMax - header.boundsMin;
+	glm::vec3 scale;
+	for (int axis = 0; axis < 3; axis++)
+		scale[axis] = extent[axis] > 0.0f ? 65535.0f / extent[axis] : 0.0f;
+
+	std::vector<CookedVertex> cooked(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const glm::vec3 quantised = glm::round((vertices[i].position - header.boundsMin) * scale);
+		const glm::vec2 normal = octEncode(vertices[i].normal);
+		for (int axis = 0; axis < 3; axis++)
+			cooked[i].position[axis] = (uint16_t)glm::clamp(quantised[axis], 0.0f, 65535.0f);
+		cooked[i].padding = 0;
+		cooked[i].normal[0] = toSnorm(normal.x);
+		cooked[i].normal[1] = toSnorm(normal.y);
+	}
+
+	std::vector<uint16_t> shortIndices;
+	if (header.indexSize == 2)
+		shortIndices.assign(indices.begin(), indices.end());
+	const void* indexData = header.indexSize == 2 ? (const void*)shortIndices.data() : (const void*)indices.data();
+
+	header.vertexOffset = BinaryFile::align(sizeof(header));
+	header.indexOffset = BinaryFile::align(header.vertexOffset + cooked.size() * sizeof(CookedVertex));
+	header.meshletOffset = BinaryFile::align(header.indexOffset + indices.size() * header.indexSize);
+	const size_t fileSize = header.meshletOffset + meshlets.size() * sizeof(Meshlet);
+
+	std::vector<char> bytes(fileSize, 0);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + header.vertexOffset, cooked.data(), cooked.size() * sizeof(CookedVertex));
+	std::memcpy(bytes.data() + header.indexOffset, indexData, indices.size() * header.indexSize);
+	std::memcpy(bytes.data() + header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+
+	return BinaryFile::write(path, bytes.data(), bytes.size());
+}
+
+const CookedMeshHeader* MeshCooker::getHeader(const void* data, size_t size)
+{
+	if (size < sizeof(CookedMeshHeader))
+		return nullptr;
+
+	const CookedMeshHeader* header = (const CookedMeshHeader*)data;
+	if (header->magic != CookedMeshHeader::Magic || header->version != CookedMeshHeader::Version)
+		return nullptr;
+	if (header->vertexCount == 0 || header->indexCount == 0 || header->indexCount % 3 != 0)
+		return nullptr;
+	if (header->indexSize != 4 && (header->indexSize != 2 || header->vertexCount > 65536))
+		return nullptr;
+
+	if (!BinaryFile::fits(header->vertexOffset, (uint64_t)header->vertexCount * sizeof(CookedVertex), size)
+		|| !BinaryFile::fits(header->indexOffset, getIndexSectionSize(*header), size)
+		|| !BinaryFile::fits(header->meshletOffset, (uint64_t)header->meshletCount * sizeof(Meshlet), size))
+		return nullptr;
+
+	return header;
+}
+
+size_t MeshCooker::getIndexSectionSize(const CookedMeshHeader& header)
+{
+	return ((size_t)header.indexCount * header.indexSize + 3) & ~(size_t)3;
+}
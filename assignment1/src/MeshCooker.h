@@ -0,0 +1,94 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshArena.h"
+
+/**
+ * \brief Start of a cooked mesh file. The vertex, index and meshlet sections follow at the offsets of the header,
+ * each 16 byte aligned, and go to the GPU as they are (see Renderer::loadMesh)
+ */
+struct CookedMeshHeader {
+	static constexpr uint32_t Magic = 0x4853454D;	// "MESH"
+	static constexpr uint32_t Version = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t meshletCount;
+	uint32_t indexSize;			// 2 bytes when every index fits, else 4
+	glm::vec3 boundsMin;		// Range of the quantised positions
+	glm::vec3 boundsMax;
+	uint64_t vertexOffset;		// In bytes from the start of the file
+	uint64_t indexOffset;
+	uint64_t meshletOffset;
+};
+
+// 12 bytes instead of the 40 of Vertex, cooked meshes are white
+struct CookedVertex {
+	uint16_t position[3];		// Unorm over the bounds of the header
+	uint16_t padding;
+	int16_t normal[2];			// Octahedral, snorm
+};
+
+// Triangles sharing at most MaxVertices vertices, contiguous in the index section
+struct Meshlet {
+	static constexpr uint32_t MaxVertices = 64;
+	static constexpr uint32_t MaxTriangles = 124;
+
+	uint32_t firstIndex;
+	uint32_t triangleCount;
+	uint32_t vertexCount;		// Distinct vertices of the triangles
+	uint32_t padding;
+	glm::vec4 sphere;			// Mesh space bounding sphere, radius in w
+};
+
+/**
+ * \brief Offline import of OBJ and glTF 2.0 files into the cooked format, run with --cook input.obj output.mesh
+ */
+class MeshCooker
+{
+public:
+	/**
+	 * \brief Imports, reorders in meshlets, optimises (see MeshOptimizer), quantises and writes the mesh. Prints the
+	 * vertex shader invocations of a simulated post-transform cache at every step
+	 * \param optimize false keeps the meshlet order, to compare the two on the GPU
+	 * \return false if the input can't be imported or the output written, the reason is printed
+	 */
+	static bool cook(const std::string& input, const std::string& output, bool optimize = true);
+
+	/**
+	 * \brief Reads the positions, normals and faces of an OBJ file. Polygons are split in fans, the corners sharing
+	 * a position and a normal become one vertex, missing normals are smoothed from the faces around the vertex
+	 */
+	static bool importObj(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	/**
+	 * \brief Reads the triangle primitives of the default scene of a .gltf (external or base64 buffers) or .glb file,
+	 * moved to world space by their nodes. Positions and normals must be floats, sparse accessors are not supported,
+	 * missing normals are smoothed as in importObj
+	 */
+	static bool importGltf(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	/**
+	 * \brief Reorders the triangles in meshlets, each one grown from the triangles adding the fewest vertices to it
+	 * \param keepOrder Cuts the triangles in their current order instead, for indices already optimised
+	 */
+	static std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool keepOrder = false);
+
+	static bool write(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const std::vector<Meshlet>& meshlets);
+
+	/**
+	 * \brief Checks the header and that every section lies inside the data. The indices are not read here,
+	 * unpack.glsl turns the ones past vertexCount into 0 so a corrupt file can't fetch outside of its mesh
+	 * \return The header at the start of data, nullptr if data is not a cooked mesh of this version
+	 */
+	static const CookedMeshHeader* getHeader(const void* data, size_t size);
+
+	/**
+	 * \brief Bytes read by the GPU for the indices, 16-bit indices are read in pairs
+	 */
+	static size_t getIndexSectionSize(const CookedMeshHeader& header);
+};
@@ -0,0 +1,244 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	optimizeVertexCache(indices.data(), (uint32_t)indices.size(), (uint32_t)vertices.size());
+	optimizeOverdraw(vertices, indices);
+	optimizeVertexFetch(vertices, indices);
+}
+
+TriangleAdjacency MeshOptimizer::buildTriangleAdjacency(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+{
+	TriangleAdjacency adjacency;
+	adjacency.offsets.assign(vertexCount + 1, 0);
+	adjacency.triangles.resize(indexCount);
+	for (uint32_t i = 0; i < indexCount; i++)
+		adjacency.offsets[indices[i] + 1]++;
+	for (uint32_t v = 1; v <= vertexCount; v++)
+		adjacency.offsets[v] += adjacency.offsets[v - 1];
+
+	std::vector<uint32_t> next(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+	for (uint32_t i = 0; i < indexCount; i++)
+		adjacency.triangles[next[indices[i]]++] = i / 3;
+	return adjacency;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+	const uint32_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	const TriangleAdjacency adjacency = buildTriangleAdjacency(indices, indexCount, vertexCount);
+	const std::vector<uint32_t>& offsets = adjacency.offsets;
+
+	std::vector<uint32_t> live(vertexCount);		// Triangles around the vertex not emitted yet
+	for (uint32_t v = 0; v < vertexCount; v++)
+		live[v] = offsets[v + 1] - offsets[v];
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);	// Time the vertex entered the simulated FIFO
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;					// Vertices of the latest triangles, tried when the fan has no candidate
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indexCount);
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;			// Vertices before it have no live triangle
+	int64_t fan = indices[0];
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+			const uint32_t triangle = adjacency.triangles[a];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t k = 0; k < 3; k++) {
+				const uint32_t vertex = indices[triangle * 3 + k];
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (time - cacheTime[vertex] > cacheSize)
+					cacheTime[vertex] = time++;
+			}
+			emitted[triangle] = 1;
+		}
+
+		// The oldest candidate whose fan still fits in the cache, it is about to be evicted
+		int64_t next = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t vertex : candidates) {
+			if (live[vertex] == 0)
+				continue;
+
+			int64_t priority = 0;
+			if (time - cacheTime[vertex] + 2 * live[vertex] <= cacheSize)
+				priority = time - cacheTime[vertex];
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		// Dead end: a recent vertex with triangles left, else the next one in input order
+		while (next < 0 && !deadEnds.empty()) {
+			const uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex] > 0)
+				next = vertex;
+		}
+		while (next < 0 && cursor < vertexCount) {
+			if (live[cursor] > 0)
+				next = cursor;
+			else
+				cursor++;
+		}
+		fan = next;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float threshold, uint32_t cacheSize)
+{
+	const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+
+	// Simulated FIFO, a cluster drawn after any other starts with a cold cache. Advancing the time flushes it
+	std::vector<uint32_t> cacheTime(vertices.size(), 0);
+	uint32_t time = cacheSize + 1;
+	auto countMisses = [&](uint32_t triangle) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t& entered = cacheTime[indices[triangle * 3 + k]];
+			if (time - entered > cacheSize) {
+				entered = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// Hard boundaries where every vertex missed
+	std::vector<uint32_t> hardClusters;		// First triangle of every cluster
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		if (countMisses(t) == 3)
+			hardClusters.push_back(t);
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Soft boundaries inside, once the ACMR since the last boundary is back near the one of the whole cluster
+	std::vector<uint32_t> clusters;
+	for (size_t h = 0; h + 1 < hardClusters.size(); h++) {
+		const uint32_t begin = hardClusters[h], end = hardClusters[h + 1];
+
+		time += cacheSize + 1;
+		uint32_t clusterMisses = 0;
+		for (uint32_t t = begin; t < end; t++)
+			clusterMisses += countMisses(t);
+		const float target = threshold * (float)clusterMisses / (float)(end - begin);
+
+		time += cacheSize + 1;
+		uint32_t first = begin;
+		uint32_t runningMisses = 0;
+		clusters.push_back(first);
+		for (uint32_t t = begin; t + 1 < end; t++) {
+			runningMisses += countMisses(t);
+			if ((float)runningMisses / (float)(t - first + 1) <= target) {
+				first = t + 1;
+				runningMisses = 0;
+				time += cacheSize + 1;
+				clusters.push_back(first);
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Area weighted centroid and normal of every cluster, the centroid of the mesh is the average of them
+	const uint32_t clusterCount = (uint32_t)clusters.size() - 1;
+	std::vector<glm::vec3> centroids(clusterCount);
+	std::vector<glm::vec3> normals(clusterCount);
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	float meshArea = 0.0f;
+
+	for (uint32_t cluster = 0; cluster < clusterCount; cluster++) {
+		glm::vec3 centroid = glm::vec3(0.0f), normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (uint32_t i = clusters[cluster] * 3; i < clusters[cluster + 1] * 3; i += 3) {
+			const glm::vec3& a = vertices[indices[i]].position;
+			const glm::vec3& b = vertices[indices[i + 1]].position;
+			const glm::vec3& c = vertices[indices[i + 2]].position;
+			const glm::vec3 cross = glm::cross(b - a, c - a);
+			const float triangleArea = glm::length(cross);
+
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+		centroids[cluster] = area > 0.0f ? centroid / area : vertices[indices[clusters[cluster] * 3]].position;
+		normals[cluster] = normal;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters on the outside face away from the centroid, far along their normal
+	std::vector<float> keys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+	for (uint32_t c = 0; c < clusterCount; c++) {
+		const float length = glm::length(normals[c]);
+		keys[c] = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : -FLT_MAX;
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (uint32_t c : order)
+		sorted.insert(sorted.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	indices.swap(sorted);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// Vertices no index uses are dropped
+	std::vector<uint32_t> remap(vertices.size(), ~0u);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (uint32_t& index : indices) {
+		if (remap[index] == ~0u) {
+			remap[index] = (uint32_t)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t usedCount = 0;
+	uint32_t time = cacheSize + 1;
+
+	for (uint32_t index : indices) {
+		if (time - cacheTime[index] > cacheSize) {
+			cacheTime[index] = time++;
+			stats.invocations++;
+		}
+		usedCount += !used[index];
+		used[index] = 1;
+	}
+
+	if (!indices.empty()) {
+		stats.acmr = (float)stats.invocations / (float)(indices.size() / 3);
+		stats.atvr = (float)stats.invocations / (float)usedCount;
+	}
+	return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshArena.h"
+
+// Vertices transformed for an index order, as counted by a FIFO post-transform cache
+struct VertexCacheStats {
+	uint32_t invocations = 0;	// Cache misses, each one runs the vertex shader
+	float acmr = 0.0f;			// Average cache miss ratio: invocations per triangle, 0.5 at best on a large grid
+	float atvr = 0.0f;			// Average transform to vertex ratio: invocations per vertex, 1 at best
+};
+
+// Triangles around every vertex, the ones of vertex v are triangles[offsets[v]] to triangles[offsets[v + 1]]
+struct TriangleAdjacency {
+	std::vector<uint32_t> offsets;		// vertexCount + 1 entries
+	std::vector<uint32_t> triangles;
+};
+
+/**
+ * \brief Offline index and vertex reordering of the cooked meshes, run by MeshCooker::cook before the meshlets are
+ * cut, the meshlets keep the optimised order
+ */
+class MeshOptimizer
+{
+public:
+	static constexpr uint32_t CacheSize = 16;	// FIFO entries assumed by Tipsify and the statistics
+	static constexpr float OverdrawThreshold = 1.05f;	// ACMR the overdraw pass may lose, relative to the cache order
+
+	/**
+	 * \brief Vertex cache, overdraw then vertex fetch optimisation
+	 */
+	static void optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	/**
+	 * \brief Tipsify (Sander et al. 2007): fans around the vertex most likely still in the cache, triangles are emitted
+	 * in place. Linear in the number of triangles
+	 * \param vertexCount Every index must be below it
+	 */
+	static void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = CacheSize);
+
+	/**
+	 * \brief Linear clustering of Sander et al.: the cache ordered triangles are cut in clusters where the cache was
+	 * flushed, and again where the ACMR so far is within threshold of the cluster's. Clusters facing out of the mesh
+	 * are drawn first, they hide the inner ones from most views and fewer fragments are shaded twice
+	 */
+	static void optimizeOverdraw(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+		float threshold = OverdrawThreshold, uint32_t cacheSize = CacheSize);
+
+	/**
+	 * \brief Renumbers the vertices in the order the indices first use them, the vertex fetches become mostly sequential
+	 */
+	static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	/**
+	 * \brief Counting sort of the triangles by vertex, linear
+	 * \param vertexCount Every index must be below it
+	 */
+	static TriangleAdjacency buildTriangleAdjacency(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+	static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = CacheSize);
+};
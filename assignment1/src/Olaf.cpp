@@ -2,6 +2,7 @@
 #include <glm/gtx/transform.hpp>
 #include "Renderer.h"
 #include "SceneManager.h"
+#include "Components.h"
 
 Olaf::Olaf()
 {
@@ -9,76 +10,103 @@ Olaf::Olaf()
 
 void Olaf::onCreate(SceneManager& manager)
 {
-	// Movement and rotation
-	constexpr float speed = 0.1;
-	manager.addKeyEvent(GLFW_KEY_D, [this, speed](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		if (scene.isShiftPressed()) {
-			this->position.x += speed;
-		}
-		else
-		{
-			this->rotation.y += 5;
-		}
-	});
+	// Movement (shift + W/A/S/D) and rotation (A/D), sampled every tick by onInput
+	InputActions& actions = manager.getInputActions();
+	actions.bind(InputActions::MoveRight, KeyCode::D, InputActions::Modifier::Shift);
+	actions.bind(InputActions::MoveLeft, KeyCode::A, InputActions::Modifier::Shift);
+	actions.bind(InputActions::MoveForward, KeyCode::W, InputActions::Modifier::Shift);
+	actions.bind(InputActions::MoveBack, KeyCode::S, InputActions::Modifier::Shift);
+	actions.bind(InputActions::TurnRight, KeyCode::D, InputActions::Modifier::NoShift);
+	actions.bind(InputActions::TurnLeft, KeyCode::A, InputActions::Modifier::NoShift);
 
-	manager.addKeyEvent(GLFW_KEY_A, [this, speed](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		if (scene.isShiftPressed()) {
-			this->position.x -= speed;
-		}
-		else
-		{
-			this->rotation.y += -5;
-		}
-	});
 
-	manager.addKeyEvent(GLFW_KEY_W, [this, speed](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		if (scene.isShiftPressed()) {
-			this->position.z -= speed;
-		}
-	});
-	manager.addKeyEvent(GLFW_KEY_S, [this, speed](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		if (scene.isShiftPressed()) {
-			this->position.z += speed;
-		}
-	});
-
-
-	// Scalling
+	// Scalling, the controllable Olaf is object 0 of the SceneManager
 	manager.addKeyEvent(GLFW_KEY_U,  [this](SceneManager& manager, WindowUserData& data, KeyAction action) {
-		if (action == RELEASE)
+		if (action == RELEASE) {
 			this->scale += 0.5f;
+			manager.markMoved(0);
+		}
 	});
 
 	manager.addKeyEvent(GLFW_KEY_J, [this](SceneManager& manager, WindowUserData& data, KeyAction action) {
-		if (action == RELEASE)
+		if (action == RELEASE) {
 			this->scale -= 0.5f;
+			manager.markMoved(0);
+		}
 	});
 
 	// Random position
 	manager.addKeyEvent(GLFW_KEY_SPACE, [this](SceneManager& manager, WindowUserData& data, KeyAction action) {
-		if (action == RELEASE)
+		if (action == RELEASE) {
 			randomPosition();
+			manager.markMoved(0);
+		}
 	});
 }
 
-void Olaf::onUpdate(float dt)
+void Olaf::onFixedUpdate(float dt)
 {
-	glm::vec3 rootPos = position;
+	previousPosition = position;
+	previousRotation = rotation;
+	previousScale = scale;
+}
+
+void Olaf::onInput(const InputActions& actions, float dt)
+{
+	constexpr float moveSpeed = 3.0f;		// Units per second
+	constexpr float turnSpeed = 150.0f;		// Degrees per second
+	constexpr float acceleration = 20.0f;	// How fast the velocity reaches the wanted one, per second
+
+	// The velocity eases towards the input so starting and stopping are smooth
+	const glm::vec3 wanted = glm::vec3(
+		actions.axis(InputActions::MoveLeft, InputActions::MoveRight),
+		0.0f,
+		actions.axis(InputActions::MoveForward, InputActions::MoveBack)) * moveSpeed;
+
+	velocity += (wanted - velocity) * glm::min(acceleration * dt, 1.0f);
+	if (wanted == glm::vec3(0.0f) && glm::length(velocity) < 0.01f)
+		velocity = glm::vec3(0.0f);
+
+	position += velocity * dt;
+	const float turn = actions.axis(InputActions::TurnLeft, InputActions::TurnRight) * turnSpeed * dt;
+	if (turn != 0.0f)
+		rotation = glm::normalize(glm::angleAxis(glm::radians(turn), glm::vec3(0, 1, 0)) * rotation);
+}
+
+void Olaf::onUpdate(float dt, float alpha)
+{
+	Renderer::submit(mesh, computeMeshTransform(alpha));
+}
+
+std::array<Olaf::Part, Olaf::PART_COUNT> Olaf::computeParts(float alpha) const
+{
+	const glm::vec3 position = glm::mix(previousPosition, this->position, alpha);
+	const glm::quat rotation = glm::slerp(previousRotation, this->rotation, alpha);
+	const float scale = glm::mix(previousScale, this->scale, alpha);
+
+	std::array<Part, PART_COUNT> parts;
+	int count = 0;
+	auto addPart = [&](const glm::vec3& pos, const glm::vec3& partScale, const glm::vec4& color, const glm::vec3& rootPos) {
+		parts[count++] = { Transform::toMatrix(pos, rotation, rootPos, partScale), color };
+	};
+
+	const glm::vec4 white = glm::vec4(1);
+
+	const glm::vec3 rootPos = computeRoot(position, scale);
 	glm::vec3 rootScale = glm::vec3{ 3, 3, 1 } * scale;
-	glm::vec3 feetScale = glm::vec3{ 1, 1, 1 } * scale;
-	rootPos.y += rootPos.y + rootScale.y / 2 + feetScale.y;
 
 	// Root
-	Renderer::drawCube(rootPos, rotation, rootScale);
+	addPart(rootPos, rootScale, white, rootPos);
 	
 	// Feet
 	{
 		glm::vec3 feetPos = rootPos;
+		const glm::vec3 feetScale = glm::vec3{ 1, 1, 1 } * scale;
 		feetPos.y -= rootScale.y / 2 + feetScale.y / 2;
 		feetPos.x += rootScale.x * 0.25;
-		Renderer::drawCube(feetPos, { rotation, rootPos }, feetScale);
+		addPart(feetPos, feetScale, white, rootPos);
 		feetPos.x -= rootScale.x * 0.5;
-		Renderer::drawCube(feetPos, { rotation, rootPos }, feetScale);
+		addPart(feetPos, feetScale, white, rootPos);
 	}
 
 	// Chest
@@ -86,13 +114,13 @@ void Olaf::onUpdate(float dt)
 	auto chestScale = rootScale * 0.7f;
 	chestScale.y *= 0.6;
 	chestPos.y += rootScale.y / 2 + chestScale.y / 2;
-	Renderer::drawCube(chestPos, { rotation, rootPos }, chestScale);
+	addPart(chestPos, chestScale, white, rootPos);
 
 	// Head
 	glm::vec3 headPos = chestPos;
 	auto headScale = chestScale * 0.8f;
 	headPos.y += chestScale.y / 2 + headScale.y / 2;
-	Renderer::drawCube(headPos, { rotation, rootPos }, headScale);
+	addPart(headPos, headScale, white, rootPos);
 
 	// Nose
 	{
@@ -100,9 +128,8 @@ void Olaf::onUpdate(float dt)
 		nosePos.z += headScale.z / 2;
 		auto noseScale = glm::vec3{0.1, 0.1, 0.5} * scale;
 
-		Renderer::drawCube(nosePos, { rotation, rootPos },
-				noseScale,
-				glm::vec4{ 235.0f / 255.0f, 119.0f / 255.0f, 52.0f / 255.0f, 1.0f });
+		addPart(nosePos, noseScale,
+				glm::vec4{ 235.0f / 255.0f, 119.0f / 255.0f, 52.0f / 255.0f, 1.0f }, rootPos);
 	}
 
 	// Eyes
@@ -114,16 +141,13 @@ void Olaf::onUpdate(float dt)
 
 		auto eyesScale = glm::vec3{ 0.2, 0.2, 0.2 } *scale;
 
-		Renderer::drawCube(eyesPos, { rotation, rootPos },
-			eyesScale, { 0, 0, 0, 1 });
-
+		addPart(eyesPos, eyesScale, { 0, 0, 0, 1 }, rootPos);
 
 		eyesPos = headPos;
 		eyesPos.z += headScale.z / 2;
 		eyesPos.x -= headScale.x * 0.25;
 		eyesPos.y += headScale.y * 0.25;
-		Renderer::drawCube(eyesPos, { rotation, rootPos },
-			eyesScale, { 0, 0, 0, 1 });
+		addPart(eyesPos, eyesScale, { 0, 0, 0, 1 }, rootPos);
 	}
 
 	// Arms
@@ -132,11 +156,112 @@ void Olaf::onUpdate(float dt)
 		armsPos.x += chestScale.x;
 		glm::vec3 armsScale = glm::vec3{ 3, 0.5, .6 } *scale;
 
-		Renderer::drawCube(armsPos, { rotation, rootPos }, armsScale);
+		addPart(armsPos, armsScale, white, rootPos);
 
 		armsPos.x -= chestScale.x * 2;
-		Renderer::drawCube(armsPos, { rotation, rootPos }, -armsScale);
+		addPart(armsPos, -armsScale, white, rootPos);
+	}
+
+	return parts;
+}
+
+glm::mat4 Olaf::computeMeshTransform(float alpha) const
+{
+	const glm::vec3 position = glm::mix(previousPosition, this->position, alpha);
+	const glm::quat rotation = glm::slerp(previousRotation, this->rotation, alpha);
+	const float scale = glm::mix(previousScale, this->scale, alpha);
+
+	const glm::vec3 rootPos = computeRoot(position, scale);
+	return Transform::toMatrix(rootPos, rotation, rootPos, glm::vec3(scale));
+}
+
+void Olaf::bakeMesh()
+{
+	// Parts of a unit Olaf, relative to its root (the origin of the mesh)
+	const Olaf unit;
+	const glm::mat4 toRoot = glm::translate(glm::mat4(1.0f), -computeRoot(unit.position, unit.scale));
+
+	MeshBuilder builder;
+	for (const Part& part : unit.computeParts())
+		builder.addBox(toRoot * part.transform, part.color);
+
+	mesh = Renderer::addMesh(builder);
+}
+
+Olaf::Part Olaf::computeProxy(float alpha) const
+{
+	// Box of a unit Olaf relative to its root, every part scales with the Olaf
+	static const AABB localBounds = [] {
+		const Olaf unit;
+		const glm::vec3 root = computeRoot(unit.position, unit.scale);
+		const AABB unitCube(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+		AABB bounds;
+		for (const Part& part : unit.computeParts())
+			bounds.merge(unitCube.transformed(part.transform));
+		return AABB(bounds.min - root, bounds.max - root);
+	}();
+
+	const glm::vec3 position = glm::mix(previousPosition, this->position, alpha);
+	const glm::quat rotation = glm::slerp(previousRotation, this->rotation, alpha);
+	const float scale = glm::mix(previousScale, this->scale, alpha);
+
+	const glm::vec3 rootPos = computeRoot(position, scale);
+	return { Transform::toMatrix(rootPos + localBounds.center() * scale, rotation, rootPos, localBounds.extent() * 2.0f * scale), glm::vec4(1) };
+}
+
+glm::vec3 Olaf::computeRoot(const glm::vec3& position, float scale)
+{
+	const float rootHeight = 3.0f * scale;
+	const float feetHeight = scale;
+
+	glm::vec3 rootPos = position;
+	rootPos.y += rootPos.y + rootHeight / 2 + feetHeight;
+	return rootPos;
+}
+
+AABB Olaf::getBounds() const
+{
+	const AABB unitCube(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+	AABB bounds;
+	for (const Part& part : computeParts())
+		bounds.merge(unitCube.transformed(part.transform));
+
+	// Frames in between ticks are drawn between the two states
+	if (previousPosition != position || previousRotation != rotation || previousScale != scale) {
+		for (const Part& part : computeParts(0.0f))
+			bounds.merge(unitCube.transformed(part.transform));
 	}
+	return bounds;
+}
+
+Entity Olaf::createPrefab(Registry& registry, const glm::vec3& position, const glm::quat& rotation, float scale)
+{
+	// Parts of a unit Olaf standing at the origin, relative to its body (the rotation origin)
+	static const std::array<Part, PART_COUNT> parts = Olaf().computeParts();
+	const glm::vec3 bodyCenter = glm::vec3(parts[0].transform[3]);
+
+	const Entity root = registry.create();
+	registry.add<Transform>(root, { position + bodyCenter * scale, rotation, glm::vec3(scale) });
+	registry.add<WorldTransform>(root);
+
+	Children& children = registry.add<Children>(root);
+	children.entities.reserve(PART_COUNT);
+	for (const Part& part : parts) {
+		const Entity entity = registry.create();
+		const glm::vec3 offset = glm::vec3(part.transform[3]) - bodyCenter;
+		const glm::vec3 partScale = { part.transform[0][0], part.transform[1][1], part.transform[2][2] };
+
+		registry.add<Transform>(entity, { offset, glm::quat(1, 0, 0, 0), partScale });
+		registry.add<WorldTransform>(entity);
+		registry.add<Parent>(entity, { root });
+		registry.add<MeshRenderer>(entity, { Renderer::getCubeMesh() });
+		registry.add<Color>(entity, { part.color });
+		children.entities.push_back(entity);
+	}
+
+	return root;
 }
 
 void Olaf::onDestroyed()
@@ -147,4 +272,7 @@ void Olaf::randomPosition() {
 	const int half = Renderer::GridSize / 2;
 	this->position = { rand() % Renderer::GridSize - half,
 			0, rand() % Renderer::GridSize - half };
+
+	// Teleport, no interpolation from the old position
+	previousPosition = position;
 }
@@ -1,24 +1,118 @@
 #pragma once
+#include <array>
 #include <glm/glm.hpp>
+#include "AABB.h"
+#include "InputActions.h"
+#include "ECS.h"
+#include "Transform.h"
+#include "MeshArena.h"
 
 class SceneManager;
 
 class Olaf {
 public:
+	static constexpr int PART_COUNT = 10;
+
+	// One cube of the model
+	struct Part {
+		glm::mat4 transform;
+		glm::vec4 color;
+	};
+
 	Olaf();
 
 	void onCreate(SceneManager& manager);
-	void onUpdate(float dt);
+
+	/**
+	 * \brief Simulation step, called at the fixed tick rate of the SceneManager
+	 */
+	void onFixedUpdate(float dt);
+
+	/**
+	 * \brief Moves the controllable Olaf from the sampled actions, after onFixedUpdate in the same tick
+	 */
+	void onInput(const InputActions& actions, float dt);
+
+	/**
+	 * \brief Draws the Olaf, once per frame
+	 * \param alpha How far the frame is between the previous and the current tick, used to interpolate the transform
+	 */
+	void onUpdate(float dt, float alpha = 1.0f);
 	void onDestroyed();
 
 
 	void randomPosition();
 
+	/**
+	 * \brief Creates an Olaf in the ECS: a root entity (Transform, WorldTransform) and one child entity
+	 * per part (Transform relative to the root, WorldTransform, MeshRenderer, Color)
+	 * \param position Feet of the Olaf, on the ground
+	 * \return The root, move or rotate it to move the whole Olaf
+	 */
+	static Entity createPrefab(Registry& registry, const glm::vec3& position, const glm::quat& rotation = glm::quat(1, 0, 0, 0), float scale = 1.0f);
+
+	/**
+	 * \brief Computes the world transform of every cube, from the position, rotation and scale
+	 * \param alpha Interpolation between the previous tick's state (0) and the current state (1)
+	 */
+	std::array<Part, PART_COUNT> computeParts(float alpha = 1.0f) const;
+
+	/**
+	 * \brief Transform of the baked mesh: the parts of a unit Olaf are merged in it, the position, rotation
+	 * and scale all go in this single matrix
+	 * \param alpha Interpolation between the previous tick's state (0) and the current state (1)
+	 */
+	glm::mat4 computeMeshTransform(float alpha = 1.0f) const;
+
+	/**
+	 * \brief Placement of the baked mesh at the current tick, the matrix of computeMeshTransform(1)
+	 */
+	Transform getMeshTransform() const { return { computeRoot(position, scale), rotation, glm::vec3(scale) }; }
+
+	/**
+	 * \brief Merges the parts of a unit Olaf, with their colours, into one arena mesh. Call once after Renderer::init.
+	 * Every part scales linearly with the Olaf, so the mesh never has to be rebuilt when the scale changes
+	 */
+	static void bakeMesh();
+	static MeshID getMesh() { return mesh; }
+
+	/**
+	 * \brief Single white box around every part, drawn instead of the parts when the Olaf is far (level of detail)
+	 */
+	Part computeProxy(float alpha = 1.0f) const;
+
+	/**
+	 * \return World space box around every part, covering the previous tick's state as well
+	 */
+	AABB getBounds() const;
+
+	/**
+	 * \return true while the drawn transform still interpolates between the previous and the current tick
+	 */
+	bool isMoving() const { return position != previousPosition || rotation != previousRotation || scale != previousScale; }
+
+	const glm::vec3& getPosition() const { return position; }
+	const glm::quat& getRotation() const { return rotation; }
+	float getScale() const { return scale; }
+
 private:
+	/**
+	 * \brief Center of the body, every part rotates around it
+	 */
+	static glm::vec3 computeRoot(const glm::vec3& position, float scale);
+
+	inline static MeshID mesh = 0;
+
 	float scale = 1.0;
 
 	glm::vec3 position = glm::vec3(0);
-	glm::vec3 rotation = glm::vec3(0);
+	glm::quat rotation = glm::quat(1, 0, 0, 0);
+	glm::vec3 velocity = glm::vec3(0);	// Units per second
+
+	// State at the start of the last simulation tick
+	float previousScale = 1.0;
+	glm::vec3 previousPosition = glm::vec3(0);
+	glm::quat previousRotation = glm::quat(1, 0, 0, 0);
 
 	friend class SceneManager;
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "Picking.h"
+#include <xmmintrin.h>
+#include "Camera.h"
+
+Ray Picking::screenRay(const Camera& camera, const glm::vec2& mouse)
+{
+	// Window coordinates to normalized device coordinates (y goes up)
+	const float x = 2.0f * mouse.x / camera.getWidth() - 1.0f;
+	const float y = 1.0f - 2.0f * mouse.y / camera.getHeight();
+
+	const glm::mat4 inverse = glm::inverse(camera.getViewProjection());
+	glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	return Ray(glm::vec3(nearPoint), glm::normalize(glm::vec3(farPoint - nearPoint)));
+}
+
+/**
+ * \brief 4 slab tests at once, every input holds one component for 4 rays/boxes
+ * \return Entry distance of each lane, +inf where the box is missed
+ */
+static __m128 slabTest4(const __m128 origin[3], const __m128 invDirection[3],
+						const __m128 boxMin[3], const __m128 boxMax[3], __m128 maxT)
+{
+	__m128 tNear = _mm_setzero_ps();
+	__m128 tFar = maxT;
+
+	for (int axis = 0; axis < 3; axis++) {
+		const __m128 t0 = _mm_mul_ps(_mm_sub_ps(boxMin[axis], origin[axis]), invDirection[axis]);
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(boxMax[axis], origin[axis]), invDirection[axis]);
+		tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+		tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+	}
+
+	const __m128 hit = _mm_cmple_ps(tNear, tFar);
+	const __m128 infinity = _mm_set1_ps(FLT_MAX);
+	return _mm_or_ps(_mm_and_ps(hit, tNear), _mm_andnot_ps(hit, infinity));
+}
+
+/**
+ * \brief Keeps the closest lane of a batch
+ */
+static void closestLane(__m128 distances, uint32_t batchStart, uint32_t count, int& closest, float& distance)
+{
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, distances);
+
+	for (uint32_t lane = 0; lane < 4 && batchStart + lane < count; lane++) {
+		if (lanes[lane] < distance) {
+			distance = lanes[lane];
+			closest = (int)(batchStart + lane);
+		}
+	}
+}
+
+int Picking::intersectOBBs(const Ray& ray, const glm::mat4* transforms, uint32_t count, float maxT, float& distance)
+{
+	const __m128 unitMin[3] = { _mm_set1_ps(-0.5f), _mm_set1_ps(-0.5f), _mm_set1_ps(-0.5f) };
+	const __m128 unitMax[3] = { _mm_set1_ps(0.5f), _mm_set1_ps(0.5f), _mm_set1_ps(0.5f) };
+	const __m128 limit = _mm_set1_ps(maxT);
+
+	int closest = -1;
+	distance = FLT_MAX;
+
+	for (uint32_t batch = 0; batch < count; batch += 4) {
+		// Ray in the local space of each box. The direction is not normalized, so t stays a world distance
+		alignas(16) float origin[3][4];
+		alignas(16) float invDirection[3][4];
+
+		for (uint32_t lane = 0; lane < 4; lane++) {
+			const uint32_t index = batch + lane < count ? batch + lane : batch;
+			const glm::mat4 inverse = glm::inverse(transforms[index]);
+			const glm::vec3 localOrigin = glm::vec3(inverse * glm::vec4(ray.origin, 1.0f));
+			const glm::vec3 localDirection = glm::vec3(inverse * glm::vec4(ray.direction, 0.0f));
+
+			for (int axis = 0; axis < 3; axis++) {
+				origin[axis][lane] = localOrigin[axis];
+				invDirection[axis][lane] = 1.0f / localDirection[axis];
+			}
+		}
+
+		const __m128 origins[3] = { _mm_load_ps(origin[0]), _mm_load_ps(origin[1]), _mm_load_ps(origin[2]) };
+		const __m128 invDirections[3] = { _mm_load_ps(invDirection[0]), _mm_load_ps(invDirection[1]), _mm_load_ps(invDirection[2]) };
+
+		closestLane(slabTest4(origins, invDirections, unitMin, unitMax, limit), batch, count, closest, distance);
+	}
+
+	return closest;
+}
+
+uint32_t Picking::intersectAABBs(const Ray& ray, const AABB* boxes, uint32_t count, float maxT, float* distances)
+{
+	const __m128 origins[3] = { _mm_set1_ps(ray.origin.x), _mm_set1_ps(ray.origin.y), _mm_set1_ps(ray.origin.z) };
+	const __m128 invDirections[3] = { _mm_set1_ps(ray.invDirection.x), _mm_set1_ps(ray.invDirection.y), _mm_set1_ps(ray.invDirection.z) };
+	const __m128 limit = _mm_set1_ps(maxT);
+
+	uint32_t hits = 0;
+	for (uint32_t batch = 0; batch < count; batch += 4) {
+		// AoS to SoA, the last batch repeats the first box of the batch
+		alignas(16) float minimum[3][4];
+		alignas(16) float maximum[3][4];
+
+		for (uint32_t lane = 0; lane < 4; lane++) {
+			const AABB& box = boxes[batch + lane < count ? batch + lane : batch];
+			for (int axis = 0; axis < 3; axis++) {
+				minimum[axis][lane] = box.min[axis];
+				maximum[axis][lane] = box.max[axis];
+			}
+		}
+
+		const __m128 boxMin[3] = { _mm_load_ps(minimum[0]), _mm_load_ps(minimum[1]), _mm_load_ps(minimum[2]) };
+		const __m128 boxMax[3] = { _mm_load_ps(maximum[0]), _mm_load_ps(maximum[1]), _mm_load_ps(maximum[2]) };
+
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, slabTest4(origins, invDirections, boxMin, boxMax, limit));
+
+		for (uint32_t lane = 0; lane < 4 && batch + lane < count; lane++) {
+			distances[batch + lane] = lanes[lane];
+			hits += lanes[lane] != FLT_MAX;
+		}
+	}
+
+	return hits;
+}
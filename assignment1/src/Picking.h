@@ -0,0 +1,33 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "AABB.h"
+
+class Camera;
+
+/**
+ * \brief CPU ray casting helpers used to select objects with the mouse
+ */
+class Picking
+{
+public:
+	/**
+	 * \brief Ray going from the camera through the cursor
+	 * \param mouse Cursor position in window coordinates (SceneManager::getMousePos)
+	 */
+	static Ray screenRay(const Camera& camera, const glm::vec2& mouse);
+
+	/**
+	 * \brief Tests the ray against oriented boxes given as unit cube transforms, 4 boxes at a time (SSE)
+	 * \param transforms World transforms of unit cubes (centered at the origin, size 1)
+	 * \param distance Distance along the ray of the closest hit
+	 * \return Index of the closest box hit, -1 if none
+	 */
+	static int intersectOBBs(const Ray& ray, const glm::mat4* transforms, uint32_t count, float maxT, float& distance);
+
+	/**
+	 * \brief Slab test of one ray against many axis aligned boxes, 4 boxes at a time (SSE)
+	 * \param distances Receives the entry distance of every box, FLT_MAX when missed
+	 * \return Number of boxes hit
+	 */
+	static uint32_t intersectAABBs(const Ray& ray, const AABB* boxes, uint32_t count, float maxT, float* distances);
+};
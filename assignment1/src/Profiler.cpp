@@ -0,0 +1,48 @@
+#include "Profiler.h"
+#include "imgui/imgui.h"
+#include <algorithm>
+
+void Profiler::record(const char* name, float ms)
+{
+	std::lock_guard<std::mutex> lock(mutex);	// Scopes also run on the render thread
+
+	auto it = std::find_if(entries.begin(), entries.end(), [name](const Entry& entry) { return entry.name == name; });
+	if (it == entries.end()) {
+		entries.push_back({ name, ms, ms, ms, 1 });
+		return;
+	}
+
+	it->lastMs = ms;
+	it->averageMs = it->averageMs * 0.95f + ms * 0.05f;
+	it->maxMs = std::max(it->maxMs, ms);
+	it->calls++;
+}
+
+void Profiler::onUI()
+{
+#ifndef SHADO_PROFILE
+	ImGui::Text("Profiling is disabled, build with SHADO_PROFILE (Debug configuration)");
+#endif
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (ImGui::Button("Reset"))
+		entries.clear();
+
+	if (ImGui::BeginTable("Profiler", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Scope");
+		ImGui::TableSetupColumn("Last (ms)");
+		ImGui::TableSetupColumn("Average (ms)");
+		ImGui::TableSetupColumn("Max (ms)");
+		ImGui::TableHeadersRow();
+
+		for (const Entry& entry : entries) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();	ImGui::Text("%s", entry.name.c_str());
+			ImGui::TableNextColumn();	ImGui::Text("%.3f", entry.lastMs);
+			ImGui::TableNextColumn();	ImGui::Text("%.3f", entry.averageMs);
+			ImGui::TableNextColumn();	ImGui::Text("%.3f", entry.maxMs);
+		}
+
+		ImGui::EndTable();
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * \brief Collects CPU timings of named scopes. Use the SHADO_PROFILE_* macros, they compile to nothing
+ * unless SHADO_PROFILE is defined (Debug configuration)
+ */
+class Profiler
+{
+public:
+	struct Entry {
+		std::string name;
+		float lastMs = 0.0f;
+		float averageMs = 0.0f;		// Exponential moving average
+		float maxMs = 0.0f;
+		uint32_t calls = 0;
+	};
+
+	static void record(const char* name, float ms);
+	static const std::vector<Entry>& getEntries() { return entries; }
+	static void reset() { std::lock_guard<std::mutex> lock(mutex); entries.clear(); }
+
+	/**
+	 * \brief Draws the timing table inside the current ImGui window
+	 */
+	static void onUI();
+
+private:
+	inline static std::vector<Entry> entries;
+	inline static std::mutex mutex;
+};
+
+class ScopedTimer
+{
+public:
+	ScopedTimer(const char* name) : name(name), start(std::chrono::high_resolution_clock::now()) {}
+	~ScopedTimer() { Profiler::record(name, elapsedMs()); }
+
+	float elapsedMs() const {
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+private:
+	const char* name;
+	std::chrono::high_resolution_clock::time_point start;
+};
+
+#define SHADO_PROFILE_CONCAT_INNER(a, b) a##b
+#define SHADO_PROFILE_CONCAT(a, b) SHADO_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SHADO_PROFILE
+	#define SHADO_PROFILE_SCOPE(name) ScopedTimer SHADO_PROFILE_CONCAT(timer, __LINE__)(name)
+	#define SHADO_PROFILE_FUNCTION() SHADO_PROFILE_SCOPE(__FUNCTION__)
+#else
+	#define SHADO_PROFILE_SCOPE(name)
+	#define SHADO_PROFILE_FUNCTION()
+#endif
@@ -0,0 +1,140 @@
+#include "RenderThread.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+
+#include "Renderer.h"
+#include "imgui/imgui_impl_opengl3.h"
+
+RenderThread::~RenderThread()
+{
+	stop();
+}
+
+void RenderThread::start(GLFWwindow* window)
+{
+	if (isRunning())
+		return;
+
+	this->window = window;
+	running = true;
+	pending = -1;
+	drawing = false;
+	thread = std::thread(&RenderThread::threadLoop, this);
+}
+
+void RenderThread::stop()
+{
+	if (!isRunning())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	condition.notify_all();
+	thread.join();
+
+	glfwMakeContextCurrent(window);
+}
+
+void RenderThread::submit(const ImDrawData* ui, int swapInterval)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	const uint32_t index = Renderer::getRecordIndex();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return pending < 0 && !drawing; });
+
+		// The render thread is idle: its stats are complete and the frame it drew can be recorded again
+		Renderer::publishStats();
+		this->ui[index].copy(ui);
+		swapIntervals[index] = swapInterval;
+		pending = (int)index;
+	}
+	condition.notify_all();
+	Renderer::swapRecordFrame();
+
+	if (latency == 0)
+		sync();
+
+	waitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void RenderThread::sync()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this] { return pending < 0 && !drawing; });
+}
+
+void RenderThread::threadLoop()
+{
+	glfwMakeContextCurrent(window);
+	int currentInterval = -2;
+
+	while (true) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return pending >= 0 || !running; });
+			if (pending < 0)
+				break;	// Stopped and nothing left to draw
+
+			index = pending;
+			pending = -1;
+			drawing = true;
+		}
+
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		if (swapIntervals[index] != currentInterval) {
+			currentInterval = swapIntervals[index];
+			glfwSwapInterval(currentInterval);
+		}
+
+		Renderer::renderFrame((uint32_t)index);
+		if (ui[index].data.Valid)
+			ImGui_ImplOpenGL3_RenderDrawData(&ui[index].data);
+		glfwSwapBuffers(window);
+
+		drawMs.store(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count(), std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			drawing = false;
+		}
+		condition.notify_all();
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void RenderThread::UIFrame::copy(const ImDrawData* source)
+{
+	data.Clear();
+	if (!source || !source->Valid)
+		return;
+
+	while (lists.size() < (size_t)source->CmdListsCount)
+		lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+
+	for (int i = 0; i < source->CmdListsCount; i++) {
+		const ImDrawList* from = source->CmdLists[i];
+		ImDrawList* to = lists[i];
+		to->CmdBuffer = from->CmdBuffer;
+		to->IdxBuffer = from->IdxBuffer;
+		to->VtxBuffer = from->VtxBuffer;
+		to->Flags = from->Flags;
+	}
+
+	data = *source;
+	data.CmdLists = lists.data();
+	data.OwnerViewport = nullptr;
+}
+
+RenderThread::UIFrame::~UIFrame()
+{
+	for (ImDrawList* list : lists)
+		IM_DELETE(list);
+}
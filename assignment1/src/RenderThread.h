@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "imgui/imgui.h"
+
+struct GLFWwindow;
+
+/**
+ * \brief Thread owning the GL context. The main thread records frame N + 1 (Renderer frames are double buffered)
+ * while this thread draws frame N, then the two swap at submit()
+ */
+class RenderThread
+{
+public:
+	~RenderThread();
+
+	/**
+	 * \brief Takes the window's context, it must not be current on the calling thread anymore
+	 */
+	void start(GLFWwindow* window);
+
+	/**
+	 * \brief Draws the pending frames, then gives the context back to the calling thread
+	 */
+	void stop();
+
+	bool isRunning() const { return thread.joinable(); }
+
+	/**
+	 * \brief Hands the frame the Renderer just recorded and the UI to the render thread and switches
+	 * the Renderer to the other frame. Blocks while the previous frame is still being drawn
+	 * \param ui Copied, the ImGui draw lists are rebuilt by the next ImGui::NewFrame
+	 */
+	void submit(const ImDrawData* ui, int swapInterval);
+
+	/**
+	 * \brief Sync point: waits until every submitted frame was presented
+	 */
+	void sync();
+
+	/**
+	 * \brief How many frames the main thread may run ahead of the presented one. 0 waits for every frame to be
+	 * presented before recording the next (lowest input lag, no overlap), 1 overlaps recording and drawing
+	 */
+	void setFrameLatency(uint32_t frames) { latency = frames > 1 ? 1 : frames; }
+	uint32_t getFrameLatency() const { return latency; }
+
+	float getWaitMs() const { return waitMs; }		// Time the main thread blocked in the last submit
+	float getDrawMs() const { return drawMs.load(std::memory_order_relaxed); }	// Time the render thread spent on the last frame
+
+private:
+	// ImDrawData only points to the lists ImGui owns, they are copied for the render thread
+	struct UIFrame {
+		ImDrawData data;
+		std::vector<ImDrawList*> lists;
+
+		void copy(const ImDrawData* source);
+		~UIFrame();
+	};
+
+	void threadLoop();
+
+	GLFWwindow* window = nullptr;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	UIFrame ui[2];				// Indexed like the Renderer frames
+	int swapIntervals[2] = { 1, 1 };
+	int pending = -1;			// Frame submitted and not started yet
+	bool drawing = false;
+	bool running = false;
+	uint32_t latency = 1;
+
+	float waitMs = 0.0f;
+	std::atomic<float> drawMs{ 0.0f };
+};
@@ -2,8 +2,13 @@
 #include <GL/glew.h>
 #include <glm/gtx/transform.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 #include "Light.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
 #include "stb_image/stb_image.h"
 
 void Renderer::setCamera(Camera* camera)
@@ -27,56 +32,1089 @@ void Renderer::setLight(Light* light) {
 
 void Renderer::drawCube(const glm::vec3& pos, const glm::vec3& rot, const glm::vec3& scale, const glm::vec4& color, Shader& shader, int mode)
 {
-	glm::mat4 transform = glm::mat4(1.0) * glm::translate(glm::mat4(1.0), pos) *
-		glm::rotate(glm::mat4(1.0f), glm::radians(rot.x), { 1, 0, 0 }) *
-		glm::rotate(glm::mat4(1.0f), glm::radians(rot.y), { 0, 1, 0 }) *
-		glm::rotate(glm::mat4(1.0f), glm::radians(rot.z), { 0, 0, 1 })	*
-		glm::scale(glm::mat4(1.0), scale);
+	drawCube(Transform{ pos, Transform::fromEuler(rot), scale }, color, shader, mode);
+}
 
-	drawCube(transform, color, shader, mode);
+void Renderer::drawCube(const Transform& transform, const glm::vec4& color, Shader& shader, int mode)
+{
+	drawCube(transform.toMatrix(), color, shader, mode);
 }
 
 void Renderer::drawCube(const glm::vec3& pos, const RotationInfo& rotationData, const glm::vec3& scale,
 	const glm::vec4& color, Shader& shader, int mode) {
 
-	auto rotation = rotationData.rotation;
-	glm::mat4 transform = glm::translate(glm::mat4(1.0f), rotationData.origin)
-		* glm::rotate(glm::mat4(1.0), glm::radians(rotation.x), { 1, 0, 0 })
-		* glm::rotate(glm::mat4(1.0), glm::radians(rotation.y), { 0, 1, 0 })
-		* glm::rotate(glm::mat4(1.0), glm::radians(rotation.z), { 0, 0, 1 })
-		* glm::translate(glm::mat4(1.0f), -rotationData.origin)
-		* glm::translate(glm::mat4(1.0), pos)
-		* glm::scale(scale);
+	drawCube(computeTransform(pos, rotationData, scale), color, shader, mode);
+}
 
-	drawCube(transform, color, shader, mode);
+glm::mat4 Renderer::computeTransform(const glm::vec3& pos, const RotationInfo& rotationData, const glm::vec3& scale) {
+	return Transform::toMatrix(pos, Transform::fromEuler(rotationData.rotation), rotationData.origin, scale);
 }
 
 void Renderer::drawCube(const glm::mat4& transform, const glm::vec4& color, Shader& shader, int mode) {
-	shader.bind();
-	shader.setFloat4("u_Color", color);
-	shader.setMat4("u_ViewProjection", camera->getViewProjection());
-	shader.setMat4("u_Transform", transform);
+	submit(info.cube_mesh, transform, color, shader, mode);
+}
+
+void Renderer::submit(MeshID mesh, const glm::mat4& transform, const glm::vec4& color, Shader& shader, int mode) {
+	RenderFrame& frame = frames[recordIndex];
+	frame.packets.push_back({ &shader, mode, mesh, (uint32_t)frame.instances.size() });
+	frame.instances.push_back({ transform, color });
+	frame.instances.back().computeNormalMatrix();
+	frame.bounds.push_back(computeBounds(mesh, transform, mode));
+}
+
+void Renderer::submit(MeshID mesh, const InstanceData* data, uint32_t count, Shader& shader, int mode) {
+	RenderFrame& frame = frames[recordIndex];
+	const uint32_t first = (uint32_t)frame.instances.size();
+	frame.packets.resize(first + count);
+	frame.instances.resize(first + count);
+	frame.bounds.resize(first + count);
+
+	JobSystem::parallelFor(count, 1024, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			frame.packets[first + i] = { &shader, mode, mesh, first + i };
+			frame.instances[first + i] = data[i];
+			frame.instances[first + i].computeNormalMatrix();
+			frame.bounds[first + i] = computeBounds(mesh, data[i].transform, mode);
+		}
+	});
+}
+
+void Renderer::submit(MeshID mesh, const TransformSoA& transforms, const glm::vec4& color, Shader& shader, int mode) {
+	submitTransforms(mesh, transforms.getColumns(), nullptr, color, shader, mode);
+}
+
+void Renderer::submit(MeshID mesh, const TransformColumns& transforms, const glm::vec4* colors, Shader& shader, int mode) {
+	submitTransforms(mesh, transforms, colors, WHITE, shader, mode);
+}
+
+void Renderer::submitTransforms(MeshID mesh, const TransformColumns& transforms, const glm::vec4* colors, const glm::vec4& color,
+	Shader& shader, int mode) {
+	RenderFrame& frame = frames[recordIndex];
+	const uint32_t first = (uint32_t)frame.instances.size();
+	const uint32_t count = transforms.count;
+	frame.packets.resize(first + count);
+	frame.instances.resize(first + count);
+	frame.bounds.resize(first + count);
+
+	JobSystem::parallelFor(count, 1024, [&](uint32_t begin, uint32_t end) {
+		TransformSoA::compose(transforms, begin, end, &frame.instances[first + begin]);
+		for (uint32_t i = begin; i < end; i++) {
+			frame.packets[first + i] = { &shader, mode, mesh, first + i };
+			frame.instances[first + i].color = colors ? colors[i] : color;
+			frame.bounds[first + i] = computeBounds(mesh, frame.instances[first + i].transform, mode);
+		}
+	});
+}
+
+MeshID Renderer::addMesh(const MeshBuilder& mesh) {
+	const MeshID id = arena->addMesh(mesh.getVertices(), mesh.getIndices());
+	arena->upload();
+	return id;
+}
+
+MeshID Renderer::loadMesh(const std::string& path, CookedMeshHeader* header) {
+	SHADO_PROFILE_FUNCTION();
+	const MappedFile file(path);
+	const CookedMeshHeader* cooked = file.isOpen() ? MeshCooker::getHeader(file.getData(), file.getSize()) : nullptr;
+	if (!cooked) {
+		std::cout << "Failed to load mesh " << path << ", not a cooked mesh (see --cook)" << std::endl;
+		return InvalidMesh;
+	}
+	if (header)
+		*header = *cooked;
+
+	const MeshID id = arena->reserveMesh(cooked->vertexCount, cooked->indexCount, cooked->boundsMin, cooked->boundsMax);
+	arena->upload();
+	const MeshInfo& mesh = arena->getMesh(id);
+
+	// The sections are copied from the mapping as they are, the compute shader decodes them into the arena
+	const uint8_t* data = (const uint8_t*)file.getData();
+	uint32_t sections[2];
+	glCreateBuffers(2, sections);
+	glNamedBufferStorage(sections[0], cooked->vertexCount * sizeof(CookedVertex), data + cooked->vertexOffset, 0);
+	glNamedBufferStorage(sections[1], MeshCooker::getIndexSectionSize(*cooked), data + cooked->indexOffset, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, sections[0]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, arena->getVertexBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, sections[1]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, arena->getIndexBuffer());
+
+	unpackShader->bind();
+	unpackShader->setInt("u_VertexCount", (int)mesh.vertexCount);
+	unpackShader->setInt("u_IndexCount", (int)mesh.indexCount);
+	unpackShader->setInt("u_BaseVertex", (int)mesh.baseVertex);
+	unpackShader->setInt("u_FirstIndex", (int)mesh.firstIndex);
+	unpackShader->setInt("u_ShortIndices", cooked->indexSize == 2);
+	unpackShader->setFloat3("u_BoundsMin", cooked->boundsMin);
+	unpackShader->setFloat3("u_BoundsExtent", cooked->boundsMax - cooked->boundsMin);
+
+	// The shader loops over what does not fit in the largest dispatch
+	const uint32_t groups = (glm::max(mesh.vertexCount, mesh.indexCount) + 63) / 64;
+	glDispatchCompute(glm::min(groups, 65535u), 1, 1);
+	// The next mesh that grows the arena copies these buffers with glCopyNamedBufferSubData
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glDeleteBuffers(2, sections);
+	return id;
+}
+
+uint64_t Renderer::measureVertexInvocations(MeshID mesh) {
+	const MeshInfo& meshInfo = arena->getMesh(mesh);
+
+	// The depth only shader reads one instance, the next frame uploads its own
+	InstanceData instance;
+	instance.transform = glm::mat4(1.0f);
+	instance.color = glm::vec4(1.0f);
+	instance.computeNormalMatrix();
+	glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData), &instance, GL_STREAM_DRAW);
+
+	arena->bind();
+	shadowShader->bind();
+	shadowShader->setMat4("u_LightViewProjection", glm::mat4(1.0f));
+	glEnable(GL_RASTERIZER_DISCARD);
+	const uint64_t invocations = GpuVertexCounter::measure([&meshInfo] {
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, meshInfo.indexCount, GL_UNSIGNED_INT,
+			(void*)(meshInfo.firstIndex * sizeof(uint32_t)), 1, meshInfo.baseVertex, 0);
+	});
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(0);
+	return invocations;
+}
+
+void Renderer::submitLight(const glm::vec3& position, const PointLight& light) {
+	frames[recordIndex].pointLights.push_back({ glm::vec4(position, light.radius), glm::vec4(light.color, light.intensity) });
+}
+
+void Renderer::submitLights(const PointLightData* lights, uint32_t count) {
+	std::vector<PointLightData>& pointLights = frames[recordIndex].pointLights;
+	pointLights.insert(pointLights.end(), lights, lights + count);
+}
+
+void InstanceData::computeNormalMatrix() {
+	const glm::vec3 x = glm::vec3(transform[0]);
+	const glm::vec3 y = glm::vec3(transform[1]);
+	const glm::vec3 z = glm::vec3(transform[2]);
 
-	shader.setFloat3("u_LightPosition", light->position);
-	shader.setFloat4("u_LightColor", light->color);
-	shader.setFloat("u_AmbientStrength", light->ambientStrength);
+	// The columns of the inverse transpose are the cross products of the other two columns over the determinant
+	const glm::vec3 yz = glm::cross(y, z);
+	const float sign = glm::dot(x, yz) < 0.0f ? -1.0f : 1.0f;
+	normalMatrix[0] = glm::vec4(yz * sign, 0.0f);
+	normalMatrix[1] = glm::vec4(glm::cross(z, x) * sign, 0.0f);
+	normalMatrix[2] = glm::vec4(glm::cross(x, y) * sign, 0.0f);
+}
+
+InstanceBounds Renderer::computeBounds(MeshID mesh, const glm::mat4& transform, int mode) {
+	// World space box of the transformed local box
+	const MeshInfo& info = arena->getMesh(mesh);
+	const glm::vec3 localCenter = (info.boundsMin + info.boundsMax) * 0.5f;
+	const glm::vec3 localExtent = (info.boundsMax - info.boundsMin) * 0.5f;
+
+	const glm::vec3 center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+	const glm::vec3 extent = glm::abs(glm::vec3(transform[0])) * localExtent.x
+		+ glm::abs(glm::vec3(transform[1])) * localExtent.y
+		+ glm::abs(glm::vec3(transform[2])) * localExtent.z;
+
+	// Large solid meshes hide what is behind them, those are drawn in the Hi-Z pre-pass
+	const float smallestSide = 2.0f * glm::min(extent.x, glm::min(extent.y, extent.z));
+	const uint32_t flags = mode == GL_TRIANGLES && smallestSide >= occluderMinSize ? InstanceBounds::OCCLUDER : 0;
+
+	return { center - extent, 0, center + extent, flags };
+}
+
+void Renderer::beginFrame(bool drawScene, bool useSceneFramebuffer) {
+	RenderFrame& frame = frames[recordIndex];
+	frame.drawScene = drawScene;
+	frame.drawSkyBox = false;
+	frame.useSceneFramebuffer = useSceneFramebuffer;
 
+	// Everything the GL side reads is copied, the render thread never touches the live objects
+	frame.camera.viewProjection = camera->getViewProjection();
+	frame.camera.view = camera->getView();
+	frame.camera.projection = camera->getProjection();
+	frame.camera.frustum = camera->getFrustum();
+	frame.camera.position = camera->getPosition();
+	frame.camera.width = camera->getWidth();
+	frame.camera.height = camera->getHeight();
+	frame.light = *light;
+	frame.cullingMode = cullingMode;
+	frame.occlusionCulling = occlusionCulling;
+	frame.validateCulling = validateCulling;
+	frame.clusteredLighting = clusteredLighting;
+	frame.lightingPath = lightingPath;
+	frame.shadows = shadowSettings;
 
-	/* Push each element in buffer_vertices to the vertex shader */
-	glBindVertexArray(Renderer::info.cube_rendererID);
-	glDrawArrays(mode, 0, Renderer::info.cube_count);
+	frame.pointLights.clear();
+	frame.packets.clear();
+	frame.instances.clear();
+	frame.bounds.clear();
+	frame.sortedInstances.clear();
+	frame.sortedBounds.clear();
+	frame.commands.clear();
+}
+
+void Renderer::beginScene() {
+	RenderFrame& frame = frames[recordIndex];
+	frame.pointLights.clear();
+	frame.packets.clear();
+	frame.instances.clear();
+	frame.bounds.clear();
+}
+
+void Renderer::endScene() {
+	SHADO_PROFILE_FUNCTION();
+
+	RenderFrame& frame = frames[recordIndex];
+	std::vector<DrawPacket>& packets = frame.packets;
+	if (packets.empty())
+		return;
+
+	// Group identical state together. The instance index keeps the submission order stable inside a group
+	std::sort(packets.begin(), packets.end(), [](const DrawPacket& a, const DrawPacket& b) {
+		if (a.shader != b.shader)	return a.shader < b.shader;
+		if (a.mode != b.mode)		return a.mode < b.mode;
+		if (a.mesh != b.mesh)		return a.mesh < b.mesh;
+		return a.instance < b.instance;
+	});
+
+	// One indirect command per (shader, mode, mesh) run, instances laid out in the same order.
+	// A command owns the instance range [baseInstance, baseInstance + instanceCount) even after culling
+	frame.sortedInstances.resize(frame.instances.size());
+	frame.sortedBounds.resize(frame.bounds.size());
+	JobSystem::parallelFor((uint32_t)packets.size(), 4096, [&frame](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			frame.sortedInstances[i] = frame.instances[frame.packets[i].instance];
+			frame.sortedBounds[i] = frame.bounds[frame.packets[i].instance];
+		}
+	});
+
+	std::vector<DrawElementsIndirectCommand>& commands = frame.commands;
+	commands.clear();
+	for (uint32_t i = 0; i < packets.size(); i++) {
+		const DrawPacket& packet = packets[i];
+
+		const bool sameRun = i > 0 && packets[i - 1].shader == packet.shader
+			&& packets[i - 1].mode == packet.mode && packets[i - 1].mesh == packet.mesh;
+
+		if (sameRun) {
+			commands.back().instanceCount++;
+		} else {
+			const MeshInfo& mesh = arena->getMesh(packet.mesh);
+			commands.push_back({ mesh.indexCount, 1, mesh.firstIndex, (int32_t)mesh.baseVertex, i });
+		}
+
+		frame.sortedBounds[i].command = (uint32_t)commands.size() - 1;
+	}
+}
+
+void Renderer::renderFrame(uint32_t index) {
+	SHADO_PROFILE_FUNCTION();
+
+	const RenderFrame& frame = frames[index];
+	current = &frame;
+
+	if (frame.useSceneFramebuffer)
+		bindSceneFramebuffer();
+	else
+		glViewport(0, 0, frame.camera.width, frame.camera.height);
+
+	if (frame.drawScene) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		drawScene();
+
+		if (frame.drawSkyBox)
+			drawSkyBoxNow();
+	}
+
+	if (frame.useSceneFramebuffer)
+		presentSceneFramebuffer();
+
+	current = nullptr;
+}
+
+void Renderer::publishStats() {
+	publishedStats = stats;
+}
+
+void Renderer::drawScene() {
+	const RenderFrame& frame = *current;
+
+	stats = RendererStats();
+	if (frame.commands.empty())
+		return;
+
+	// Camera data shared by every shader
+	CameraUniform cameraData;
+	cameraData.viewProjection = frame.camera.viewProjection;
+	cameraData.view = frame.camera.view;
+	cameraData.projection = frame.camera.projection;
+	for (int i = 0; i < Frustum::Count; i++)
+		cameraData.frustumPlanes[i] = frame.camera.frustum.planes[i];
+	cameraData.position = glm::vec4(frame.camera.position, 1.0f);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, info.camera_UniformBufferID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraUniform), &cameraData, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, info.camera_UniformBufferID);
+
+	stats.commandCount = (uint32_t)frame.commands.size();
+	stats.instanceCount = (uint32_t)frame.sortedInstances.size();
+	stats.pointLightCount = (uint32_t)frame.pointLights.size();
+
+	const bool clustered = frame.clusteredLighting && !frame.pointLights.empty();
+	if (clustered)
+		buildClusters();
+	stats.clusterMs = clustered ? clusterTimer.getMs() : 0.0f;
+
+	// Exponential depth slices: slice = log(depth) * scale + bias
+	const float logDepthRange = std::log(Camera::FarPlane / Camera::NearPlane);
+	const glm::vec4 clusterParams = {
+		(float)ClusterZ / logDepthRange,
+		-(float)ClusterZ * std::log(Camera::NearPlane) / logDepthRange,
+		(float)frame.camera.width,
+		(float)frame.camera.height
+	};
+
+	if (frame.shadows.enabled)
+		buildShadowMaps();
+
+	if (frame.occlusionCulling && frame.cullingMode != CullingMode::None)
+		buildHiZ();
+
+	switch (frame.cullingMode) {
+	case CullingMode::None:
+		glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+		glBufferData(GL_ARRAY_BUFFER, frame.sortedInstances.size() * sizeof(InstanceData), frame.sortedInstances.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, frame.commands.size() * sizeof(DrawElementsIndirectCommand), frame.commands.data(), GL_STREAM_DRAW);
+
+		stats.visibleCount = stats.instanceCount;
+		break;
+
+	case CullingMode::CPU:
+		cullCPU(frame.camera.frustum);
+
+		glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+		glBufferData(GL_ARRAY_BUFFER, culledInstances.size() * sizeof(InstanceData), culledInstances.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, culledCommands.size() * sizeof(DrawElementsIndirectCommand), culledCommands.data(), GL_STREAM_DRAW);
+		break;
+
+	case CullingMode::GPU:
+		cullGPU();
+
+		if (frame.validateCulling) {
+			cullCPU(frame.camera.frustum);
+			stats.validationErrors = validateGPUCulling();
+		}
+		break;
+	}
+
+	// After the Hi-Z pass, which restores the target framebuffer
+	const bool deferred = frame.lightingPath == LightingPath::Deferred;
+	if (deferred)
+		bindGBuffer();
+
+	arena->bind();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+	glBindTextureUnit(3, info.shadow_TextureID);
+	drawTimer.begin();
+
+	// Issue one multi draw per (shader, mode) pair
+	uint32_t first = 0;
+	while (first < frame.commands.size()) {
+		const DrawPacket& head = frame.packets[frame.commands[first].baseInstance];
+
+		uint32_t last = first + 1;
+		while (last < frame.commands.size()) {
+			const DrawPacket& next = frame.packets[frame.commands[last].baseInstance];
+			if (next.shader != head.shader || next.mode != head.mode)
+				break;
+			last++;
+		}
+
+		Shader& shader = deferred && head.shader == Renderer::shader ? *gBufferShader : *head.shader;
+		shader.bind();
+		shader.setFloat3("u_LightPosition", frame.light.position);
+		shader.setFloat4("u_LightColor", frame.light.color);
+		shader.setFloat("u_AmbientStrength", frame.light.ambientStrength);
+		shader.setInt("u_ClusteredLights", clustered);
+		shader.setFloat4("u_ClusterParams", clusterParams);
+		setShadowUniforms(shader);
+
+		glMultiDrawElementsIndirect(head.mode, GL_UNSIGNED_INT,
+			(void*)(first * sizeof(DrawElementsIndirectCommand)), last - first, 0);
+
+		stats.apiDrawCalls++;
+		first = last;
+	}
+
+	drawTimer.end();
+	stats.drawMs = drawTimer.getMs();
+	glBindVertexArray(0);
+
+	if (deferred)
+		drawDeferredLighting(clusterParams, clustered);
+}
+
+void Renderer::buildShadowMaps() {
+	SHADO_PROFILE_FUNCTION();
+	const RenderFrame& frame = *current;
+	const ShadowSettings& settings = frame.shadows;
+
+	const uint32_t cascades = glm::clamp(settings.cascadeCount, 1u, ShadowSettings::MaxCascades);
+	if (info.shadow_Resolution != settings.resolution || info.shadow_Cascades != cascades)
+		resizeShadowMaps(settings.resolution, cascades);
+
+	// Corners of the camera frustum, the rays from the near to the far corners are linear in view depth
+	const glm::mat4 inverseViewProj = glm::inverse(frame.camera.viewProjection);
+	glm::vec3 nearCorners[4], farCorners[4];
+	for (int i = 0; i < 4; i++) {
+		const glm::vec2 ndc = { i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f };
+		const glm::vec4 nearCorner = inverseViewProj * glm::vec4(ndc, -1.0f, 1.0f);
+		const glm::vec4 farCorner = inverseViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+		nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+		farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+	}
+
+	// The scene light is treated as a directional light shining from its position towards the origin
+	const glm::vec3 toLight = glm::length(frame.light.position) > 0.0f ? glm::normalize(frame.light.position) : glm::vec3(0, 1, 0);
+	const glm::vec3 up = glm::abs(toLight.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+
+	const float nearPlane = Camera::NearPlane;
+	const float farPlane = glm::clamp(settings.distance, nearPlane + 1.0f, Camera::FarPlane);
+	float splitNear = nearPlane;
+	for (uint32_t c = 0; c < cascades; c++) {
+		const float ratio = (float)(c + 1) / (float)cascades;
+		const float uniformSplit = nearPlane + (farPlane - nearPlane) * ratio;
+		const float logSplit = nearPlane * std::pow(farPlane / nearPlane, ratio);
+		const float splitFar = glm::mix(uniformSplit, logSplit, settings.splitLambda);
+
+		const float t0 = (splitNear - nearPlane) / (Camera::FarPlane - nearPlane);
+		const float t1 = (splitFar - nearPlane) / (Camera::FarPlane - nearPlane);
+		glm::vec3 corners[8];
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int i = 0; i < 4; i++) {
+			corners[i] = glm::mix(nearCorners[i], farCorners[i], t0);
+			corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], t1);
+			center += corners[i] + corners[i + 4];
+		}
+		center /= 8.0f;
+
+		// Bounding sphere of the slice: its size does not change when the camera turns
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+			radius = glm::max(radius, glm::length(corner - center));
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		const glm::mat4 lightView = glm::lookAt(center + toLight * radius, center, up);
+		glm::mat4 lightProj = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+
+		// Snaps the cascade to whole texels so the shadow edges do not crawl when the camera moves
+		const float halfResolution = (float)info.shadow_Resolution * 0.5f;
+		const glm::vec4 origin = lightProj * lightView * glm::vec4(0, 0, 0, 1);
+		lightProj[3][0] += (std::round(origin.x * halfResolution) - origin.x * halfResolution) / halfResolution;
+		lightProj[3][1] += (std::round(origin.y * halfResolution) - origin.y * halfResolution) / halfResolution;
+
+		shadowMatrices[c] = lightProj * lightView;
+		cascadeSplits[c] = splitFar;
+		splitNear = splitFar;
+	}
+
+	// Casters between the light and a cascade are kept: their depth is clamped instead of clipped
+	Frustum frustums[ShadowSettings::MaxCascades];
+	for (uint32_t c = 0; c < cascades; c++) {
+		frustums[c] = Frustum::fromMatrix(shadowMatrices[c]);
+		frustums[c].planes[Frustum::Near] = glm::vec4(0, 0, 0, 1);
+	}
+
+	// Only triangle meshes cast shadows
+	shadowMasks.resize(frame.sortedInstances.size());
+	JobSystem::parallelFor((uint32_t)frame.sortedInstances.size(), 2048, [&frame, &frustums, cascades](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const InstanceBounds& box = frame.sortedBounds[i];
+			uint8_t mask = 0;
+			if (frame.packets[frame.commands[box.command].baseInstance].mode == GL_TRIANGLES) {
+				for (uint32_t c = 0; c < cascades; c++)
+					mask |= frustums[c].intersects(box.min, box.max) ? 1 << c : 0;
+			}
+			shadowMasks[i] = mask;
+		}
+	});
+
+	glBindFramebuffer(GL_FRAMEBUFFER, info.shadow_FramebufferID);
+	glViewport(0, 0, info.shadow_Resolution, info.shadow_Resolution);
+	glEnable(GL_DEPTH_CLAMP);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.0f, 4.0f);
+
+	arena->bind();
+	shadowShader->bind();
+	shadowTimer.begin();
+
+	for (uint32_t c = 0; c < cascades; c++) {
+		// Casters of the cascade packed together: count them per command, prefix sum over the commands that have some,
+		// then scatter. Only the casters and their commands are uploaded (the grid lines never cast)
+		const uint8_t bit = (uint8_t)(1 << c);
+		casterOffsets.assign(frame.commands.size(), 0);
+		for (uint32_t i = 0; i < frame.sortedInstances.size(); i++) {
+			if (shadowMasks[i] & bit)
+				casterOffsets[frame.sortedBounds[i].command]++;
+		}
+
+		uint32_t casters = 0;
+		culledCommands.clear();
+		for (uint32_t i = 0; i < frame.commands.size(); i++) {
+			const uint32_t count = casterOffsets[i];
+			casterOffsets[i] = casters;
+			if (count == 0)
+				continue;
+
+			DrawElementsIndirectCommand command = frame.commands[i];
+			command.instanceCount = count;
+			command.baseInstance = casters;
+			culledCommands.push_back(command);
+			casters += count;
+		}
+
+		culledInstances.resize(casters);
+		for (uint32_t i = 0; i < frame.sortedInstances.size(); i++) {
+			if (shadowMasks[i] & bit)
+				culledInstances[casterOffsets[frame.sortedBounds[i].command]++] = frame.sortedInstances[i];
+		}
+		stats.shadowCasters[c] = casters;
+
+		glNamedFramebufferTextureLayer(info.shadow_FramebufferID, GL_DEPTH_ATTACHMENT, info.shadow_TextureID, 0, c);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		if (casters == 0)
+			continue;
+
+		glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+		glBufferData(GL_ARRAY_BUFFER, casters * sizeof(InstanceData), culledInstances.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, culledCommands.size() * sizeof(DrawElementsIndirectCommand), culledCommands.data(), GL_STREAM_DRAW);
+
+		shadowShader->setMat4("u_LightViewProjection", shadowMatrices[c]);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)culledCommands.size(), 0);
+	}
+
+	shadowTimer.end();
+	stats.shadowMs = shadowTimer.getMs();
+
+	glBindVertexArray(0);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glDisable(GL_DEPTH_CLAMP);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(0, 0, frame.camera.width, frame.camera.height);
+}
+
+void Renderer::setShadowUniforms(Shader& shader) {
+	const RenderFrame& frame = *current;
+	shader.setInt("u_Shadows", frame.shadows.enabled);
+	if (!frame.shadows.enabled)
+		return;
+
+	shader.setInt("u_CascadeCount", (int)info.shadow_Cascades);
+	shader.setFloat4("u_CascadeSplits", cascadeSplits);
+	for (uint32_t c = 0; c < info.shadow_Cascades; c++)
+		shader.setMat4("u_ShadowMatrices[" + std::to_string(c) + "]", shadowMatrices[c]);
+}
+
+void Renderer::bindGBuffer() {
+	const RenderFrame& frame = *current;
+	if (frame.camera.width != info.gBuffer_Width || frame.camera.height != info.gBuffer_Height)
+		resizeGBuffer(frame.camera.width, frame.camera.height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, info.gBuffer_FramebufferID);
+	glViewport(0, 0, frame.camera.width, frame.camera.height);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void Renderer::drawDeferredLighting(const glm::vec4& clusterParams, bool clustered) {
+	SHADO_PROFILE_FUNCTION();
+	const RenderFrame& frame = *current;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	lightingTimer.begin();
+
+	// The background is discarded, every other pixel writes the depth of the G-buffer
+	glDepthFunc(GL_ALWAYS);
+	deferredShader->bind();
+	deferredShader->setMat4("u_InverseViewProjection", glm::inverse(frame.camera.viewProjection));
+	deferredShader->setFloat3("u_LightPosition", frame.light.position);
+	deferredShader->setFloat4("u_LightColor", frame.light.color);
+	deferredShader->setFloat("u_AmbientStrength", frame.light.ambientStrength);
+	deferredShader->setInt("u_ClusteredLights", clustered);
+	deferredShader->setFloat4("u_ClusterParams", clusterParams);
+	setShadowUniforms(*deferredShader);
+
+	glBindTextureUnit(0, info.gBuffer_AlbedoTextureID);
+	glBindTextureUnit(1, info.gBuffer_NormalTextureID);
+	glBindTextureUnit(2, info.gBuffer_DepthTextureID);
+	glBindTextureUnit(3, info.shadow_TextureID);
+	glBindVertexArray(info.fullscreen_VertexArrayID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDepthFunc(GL_LESS);
+
+	lightingTimer.end();
+	stats.lightingMs = lightingTimer.getMs();
+}
+
+void Renderer::buildClusters() {
+	SHADO_PROFILE_FUNCTION();
+	const RenderFrame& frame = *current;
+
+	clusterTimer.begin();
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, info.light_BufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, frame.pointLights.size() * sizeof(PointLightData), frame.pointLights.data(), GL_STREAM_DRAW);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, info.light_BufferID);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, info.cluster_LightsBufferID);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, info.cluster_CountsBufferID);
+
+	// Overflow of a build the GPU finished, reading it does not wait for the GPU
+	stats.overflowClusters = clusterReadback.getCounter(0);
+	stats.droppedClusterLights = clusterReadback.getCounter(1);
+	const uint32_t zero = 0;
+	glClearNamedBufferData(info.cluster_OverflowBufferID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, info.cluster_OverflowBufferID);
+
+	clusterShader->bind();
+	clusterShader->setMat4("u_InverseProjection", glm::inverse(frame.camera.projection));
+	clusterShader->setInt("u_LightCount", (int)frame.pointLights.size());
+	clusterShader->setFloat("u_Near", Camera::NearPlane);
+	clusterShader->setFloat("u_Far", Camera::FarPlane);
+
+	constexpr uint32_t clusterCount = ClusterX * ClusterY * ClusterZ;
+	glDispatchCompute((clusterCount + 63) / 64, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	clusterReadback.copy(info.cluster_OverflowBufferID, 2);
+
+	clusterTimer.end();
+}
+
+void Renderer::cullCPU(const Frustum& frustum) {
+	SHADO_PROFILE_FUNCTION();
+	const RenderFrame& frame = *current;
+
+	culledInstances.resize(frame.sortedInstances.size());
+	culledCommands = frame.commands;
+	for (DrawElementsIndirectCommand& command : culledCommands)
+		command.instanceCount = 0;
+
+	// The tests run in parallel, the compaction keeps the instance order so it stays serial
+	enum CullResult : uint8_t { CULLED = 0, VISIBLE, OCCLUDED };
+	cullResults.resize(frame.sortedInstances.size());
+	JobSystem::parallelFor((uint32_t)frame.sortedInstances.size(), 2048, [&frame, &frustum](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const InstanceBounds& box = frame.sortedBounds[i];
+			if (!frustum.intersects(box.min, box.max))
+				cullResults[i] = CULLED;
+			else if (frame.occlusionCulling && !(box.flags & InstanceBounds::OCCLUDER) && isOccludedCPU(box))
+				cullResults[i] = OCCLUDED;
+			else
+				cullResults[i] = VISIBLE;
+		}
+	});
+
+	uint32_t visible = 0;
+	uint32_t occluded = 0;
+	for (uint32_t i = 0; i < frame.sortedInstances.size(); i++) {
+		if (cullResults[i] != VISIBLE) {
+			occluded += cullResults[i] == OCCLUDED;
+			continue;
+		}
+
+		const InstanceBounds& box = frame.sortedBounds[i];
+		DrawElementsIndirectCommand& command = culledCommands[box.command];
+		culledInstances[command.baseInstance + command.instanceCount++] = frame.sortedInstances[i];
+		visible++;
+	}
+
+	stats.visibleCount = visible;
+	stats.occludedCount = occluded;
+}
+
+void Renderer::cullGPU() {
+	SHADO_PROFILE_FUNCTION();
+	const RenderFrame& frame = *current;
+
+	const uint32_t count = (uint32_t)frame.sortedInstances.size();
+
+	// Visible and occluded counts of a dispatch the GPU finished, then reset the counters
+	stats.visibleCount = cullReadback.getCounter(0);
+	stats.occludedCount = cullReadback.getCounter(1);
+	const uint32_t zero = 0;
+	glClearNamedBufferData(info.cull_CounterBufferID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, info.cull_InstanceBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(InstanceData), frame.sortedInstances.data(), GL_STREAM_DRAW);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, info.cull_BoundsBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(InstanceBounds), frame.sortedBounds.data(), GL_STREAM_DRAW);
+
+	// The shader uses instanceCount as the insertion counter
+	culledCommands = frame.commands;
+	for (DrawElementsIndirectCommand& command : culledCommands)
+		command.instanceCount = 0;
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, culledCommands.size() * sizeof(DrawElementsIndirectCommand), culledCommands.data(), GL_STREAM_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), nullptr, GL_STREAM_DRAW);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, info.cull_InstanceBufferID);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, info.cull_BoundsBufferID);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, info.indirect_BufferID);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, info.instance_BufferID);
+	glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, info.cull_CounterBufferID);
+
+	const bool occlusion = frame.occlusionCulling && info.hiZ_TextureID;
+	if (occlusion)
+		glBindTextureUnit(0, info.hiZ_TextureID);
+
+	cullShader->bind();
+	cullShader->setInt("u_InstanceCount", (int)count);
+	cullShader->setInt("u_OcclusionCulling", occlusion);
+	glDispatchCompute((count + 63) / 64, 1, 1);
+
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	cullReadback.copy(info.cull_CounterBufferID, 2);
+}
+
+uint32_t Renderer::validateGPUCulling() {
+	const RenderFrame& frame = *current;
+	std::vector<DrawElementsIndirectCommand> gpuCommands(frame.commands.size());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+	glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, gpuCommands.size() * sizeof(DrawElementsIndirectCommand), gpuCommands.data());
+
+	uint32_t errors = 0;
+	for (uint32_t i = 0; i < gpuCommands.size(); i++) {
+		if (gpuCommands[i].instanceCount != culledCommands[i].instanceCount)
+			errors++;
+	}
+
+	if (errors > 0)
+		std::cout << "GPU culling disagrees with the CPU reference on " << errors << " commands" << std::endl;
+
+	return errors;
+}
+
+void Renderer::buildHiZ() {
+	SHADO_PROFILE_FUNCTION();
+	const RenderFrame& frame = *current;
+
+	if (info.hiZ_Width != frame.camera.width || info.hiZ_Height != frame.camera.height)
+		resizeHiZ(frame.camera.width, frame.camera.height);
+
+	// Occluders inside the frustum, laid out per command like the culling output
+	culledInstances.resize(frame.sortedInstances.size());
+	culledCommands = frame.commands;
+	for (DrawElementsIndirectCommand& command : culledCommands)
+		command.instanceCount = 0;
+
+	uint32_t occluders = 0;
+	for (uint32_t i = 0; i < frame.sortedInstances.size(); i++) {
+		const InstanceBounds& box = frame.sortedBounds[i];
+		if (!(box.flags & InstanceBounds::OCCLUDER) || !frame.camera.frustum.intersects(box.min, box.max))
+			continue;
+
+		DrawElementsIndirectCommand& command = culledCommands[box.command];
+		culledInstances[command.baseInstance + command.instanceCount++] = frame.sortedInstances[i];
+		occluders++;
+	}
+	stats.occluderCount = occluders;
+
+	glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+	glBufferData(GL_ARRAY_BUFFER, culledInstances.size() * sizeof(InstanceData), culledInstances.data(), GL_STREAM_DRAW);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, info.indirect_BufferID);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, culledCommands.size() * sizeof(DrawElementsIndirectCommand), culledCommands.data(), GL_STREAM_DRAW);
+
+	// Depth pre-pass. Only triangle commands can hold occluders, the others have no instances
+	glBindFramebuffer(GL_FRAMEBUFFER, info.hiZ_FramebufferID);
+	glViewport(0, 0, info.hiZ_Width, info.hiZ_Height);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	arena->bind();
+	depthShader->bind();
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)culledCommands.size(), 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(0, 0, frame.camera.width, frame.camera.height);
+
+	// Level 0 copies the depth buffer, every other level reduces the previous one
+	hiZShader->bind();
+	for (uint32_t level = 0; level < info.hiZ_Levels; level++) {
+		const uint32_t width = glm::max(info.hiZ_Width >> level, 1u);
+		const uint32_t height = glm::max(info.hiZ_Height >> level, 1u);
+
+		glBindTextureUnit(0, level == 0 ? info.hiZ_DepthTextureID : info.hiZ_TextureID);
+		hiZShader->setInt("u_SourceLevel", (int)level - 1);
+		glBindImageTexture(0, info.hiZ_TextureID, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	}
+
+	// The CPU reference tests against the exact same pyramid
+	if (frame.cullingMode == CullingMode::CPU || frame.validateCulling) {
+		hiZLevels.resize(info.hiZ_Levels);
+		for (uint32_t level = 0; level < info.hiZ_Levels; level++) {
+			const uint32_t width = glm::max(info.hiZ_Width >> level, 1u);
+			const uint32_t height = glm::max(info.hiZ_Height >> level, 1u);
+
+			hiZLevels[level].resize(width * height);
+			glGetTextureImage(info.hiZ_TextureID, level, GL_RED, GL_FLOAT,
+				(GLsizei)(hiZLevels[level].size() * sizeof(float)), hiZLevels[level].data());
+		}
+	}
+}
+
+void Renderer::resizeHiZ(uint32_t width, uint32_t height) {
+	if (info.hiZ_FramebufferID) {
+		glDeleteFramebuffers(1, &info.hiZ_FramebufferID);
+		glDeleteTextures(1, &info.hiZ_DepthTextureID);
+		glDeleteTextures(1, &info.hiZ_TextureID);
+	}
+
+	info.hiZ_Width = width;
+	info.hiZ_Height = height;
+	info.hiZ_Levels = (uint32_t)std::floor(std::log2((float)glm::max(width, height))) + 1;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.hiZ_DepthTextureID);
+	glTextureStorage2D(info.hiZ_DepthTextureID, 1, GL_DEPTH_COMPONENT32F, width, height);
+	glTextureParameteri(info.hiZ_DepthTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(info.hiZ_DepthTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.hiZ_TextureID);
+	glTextureStorage2D(info.hiZ_TextureID, info.hiZ_Levels, GL_R32F, width, height);
+	glTextureParameteri(info.hiZ_TextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(info.hiZ_TextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(info.hiZ_TextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(info.hiZ_TextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glCreateFramebuffers(1, &info.hiZ_FramebufferID);
+	glNamedFramebufferTexture(info.hiZ_FramebufferID, GL_DEPTH_ATTACHMENT, info.hiZ_DepthTextureID, 0);
+	glNamedFramebufferDrawBuffer(info.hiZ_FramebufferID, GL_NONE);
+	glNamedFramebufferReadBuffer(info.hiZ_FramebufferID, GL_NONE);
+
+	if (glCheckNamedFramebufferStatus(info.hiZ_FramebufferID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Hi-Z framebuffer is incomplete" << std::endl;
+
+	hiZLevels.clear();
+}
+
+void Renderer::bindSceneFramebuffer() {
+	const RenderFrame& frame = *current;
+	if (frame.camera.width != info.scene_Width || frame.camera.height != info.scene_Height)
+		resizeSceneFramebuffer(frame.camera.width, frame.camera.height);
+
+	targetFramebuffer = info.scene_FramebufferID;
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	glViewport(0, 0, frame.camera.width, frame.camera.height);
+}
+
+void Renderer::presentSceneFramebuffer() {
+	const RenderFrame& frame = *current;
+	targetFramebuffer = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, frame.camera.width, frame.camera.height);
+
+	if (!info.scene_FramebufferID)
+		return;
+
+	glBlitNamedFramebuffer(info.scene_FramebufferID, 0,
+		0, 0, info.scene_Width, info.scene_Height,
+		0, 0, info.scene_Width, info.scene_Height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void Renderer::resizeSceneFramebuffer(uint32_t width, uint32_t height) {
+	if (info.scene_FramebufferID) {
+		glDeleteFramebuffers(1, &info.scene_FramebufferID);
+		glDeleteTextures(1, &info.scene_ColorTextureID);
+		glDeleteTextures(1, &info.scene_DepthTextureID);
+	}
+
+	info.scene_Width = width;
+	info.scene_Height = height;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.scene_ColorTextureID);
+	glTextureStorage2D(info.scene_ColorTextureID, 1, GL_RGBA8, width, height);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.scene_DepthTextureID);
+	glTextureStorage2D(info.scene_DepthTextureID, 1, GL_DEPTH24_STENCIL8, width, height);
+
+	glCreateFramebuffers(1, &info.scene_FramebufferID);
+	glNamedFramebufferTexture(info.scene_FramebufferID, GL_COLOR_ATTACHMENT0, info.scene_ColorTextureID, 0);
+	glNamedFramebufferTexture(info.scene_FramebufferID, GL_DEPTH_STENCIL_ATTACHMENT, info.scene_DepthTextureID, 0);
+
+	if (glCheckNamedFramebufferStatus(info.scene_FramebufferID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Scene framebuffer is incomplete" << std::endl;
+}
+
+void Renderer::resizeGBuffer(uint32_t width, uint32_t height) {
+	if (info.gBuffer_FramebufferID) {
+		glDeleteFramebuffers(1, &info.gBuffer_FramebufferID);
+		glDeleteTextures(1, &info.gBuffer_AlbedoTextureID);
+		glDeleteTextures(1, &info.gBuffer_NormalTextureID);
+		glDeleteTextures(1, &info.gBuffer_DepthTextureID);
+	}
+
+	info.gBuffer_Width = width;
+	info.gBuffer_Height = height;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.gBuffer_AlbedoTextureID);
+	glTextureStorage2D(info.gBuffer_AlbedoTextureID, 1, GL_RGBA8, width, height);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.gBuffer_NormalTextureID);
+	glTextureStorage2D(info.gBuffer_NormalTextureID, 1, GL_RG16_SNORM, width, height);
+
+	// Read back by the lighting pass to rebuild the positions
+	glCreateTextures(GL_TEXTURE_2D, 1, &info.gBuffer_DepthTextureID);
+	glTextureStorage2D(info.gBuffer_DepthTextureID, 1, GL_DEPTH_COMPONENT32F, width, height);
+
+	for (uint32_t texture : { info.gBuffer_AlbedoTextureID, info.gBuffer_NormalTextureID, info.gBuffer_DepthTextureID }) {
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	glCreateFramebuffers(1, &info.gBuffer_FramebufferID);
+	glNamedFramebufferTexture(info.gBuffer_FramebufferID, GL_COLOR_ATTACHMENT0, info.gBuffer_AlbedoTextureID, 0);
+	glNamedFramebufferTexture(info.gBuffer_FramebufferID, GL_COLOR_ATTACHMENT1, info.gBuffer_NormalTextureID, 0);
+	glNamedFramebufferTexture(info.gBuffer_FramebufferID, GL_DEPTH_ATTACHMENT, info.gBuffer_DepthTextureID, 0);
+
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glNamedFramebufferDrawBuffers(info.gBuffer_FramebufferID, 2, drawBuffers);
+
+	if (glCheckNamedFramebufferStatus(info.gBuffer_FramebufferID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "G-buffer is incomplete" << std::endl;
+}
+
+void Renderer::resizeShadowMaps(uint32_t resolution, uint32_t cascades) {
+	if (info.shadow_FramebufferID) {
+		glDeleteFramebuffers(1, &info.shadow_FramebufferID);
+		glDeleteTextures(1, &info.shadow_TextureID);
+	}
+
+	info.shadow_Resolution = resolution;
+	info.shadow_Cascades = cascades;
+
+	// Sampled with hardware comparison, every PCF tap filters 4 texels
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &info.shadow_TextureID);
+	glTextureStorage3D(info.shadow_TextureID, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, cascades);
+	glTextureParameteri(info.shadow_TextureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(info.shadow_TextureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(info.shadow_TextureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(info.shadow_TextureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(info.shadow_TextureID, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(info.shadow_TextureID, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	const float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };	// Outside of a cascade is lit
+	glTextureParameterfv(info.shadow_TextureID, GL_TEXTURE_BORDER_COLOR, border);
+
+	glCreateFramebuffers(1, &info.shadow_FramebufferID);
+	glNamedFramebufferTextureLayer(info.shadow_FramebufferID, GL_DEPTH_ATTACHMENT, info.shadow_TextureID, 0, 0);
+	glNamedFramebufferDrawBuffer(info.shadow_FramebufferID, GL_NONE);
+	glNamedFramebufferReadBuffer(info.shadow_FramebufferID, GL_NONE);
+
+	if (glCheckNamedFramebufferStatus(info.shadow_FramebufferID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Shadow framebuffer is incomplete" << std::endl;
+}
+
+bool Renderer::isOccludedCPU(const InstanceBounds& box) {
+	const RenderFrame& frame = *current;
+	if (hiZLevels.empty())
+		return false;
+
+	const glm::mat4& viewProj = frame.camera.viewProjection;
+
+	glm::vec3 screenMin(1.0f), screenMax(0.0f);
+	for (int i = 0; i < 8; i++) {
+		const glm::vec3 corner((i & 1) ? box.max.x : box.min.x,
+							   (i & 2) ? box.max.y : box.min.y,
+							   (i & 4) ? box.max.z : box.min.z);
+		const glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+		if (clip.w <= 0.0f)
+			return false;
+
+		const glm::vec3 screen = glm::vec3(clip) / clip.w * 0.5f + 0.5f;
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+	}
+	screenMin = glm::clamp(screenMin, 0.0f, 1.0f);
+	screenMax = glm::clamp(screenMax, 0.0f, 1.0f);
+
+	const float width = (screenMax.x - screenMin.x) * info.hiZ_Width;
+	const float height = (screenMax.y - screenMin.y) * info.hiZ_Height;
+	const int level = glm::min((int)std::ceil(std::log2(glm::max(glm::max(width, height), 1.0f))), (int)info.hiZ_Levels - 1);
+
+	const int levelWidth = glm::max((int)info.hiZ_Width >> level, 1);
+	const int levelHeight = glm::max((int)info.hiZ_Height >> level, 1);
+	const std::vector<float>& depth = hiZLevels[level];
+
+	const int lowX = glm::clamp((int)(screenMin.x * levelWidth), 0, levelWidth - 1);
+	const int lowY = glm::clamp((int)(screenMin.y * levelHeight), 0, levelHeight - 1);
+	const int highX = glm::clamp((int)(screenMax.x * levelWidth), 0, levelWidth - 1);
+	const int highY = glm::clamp((int)(screenMax.y * levelHeight), 0, levelHeight - 1);
+
+	const float farthest = std::max({ depth[lowY * levelWidth + lowX], depth[lowY * levelWidth + highX],
+									  depth[highY * levelWidth + lowX], depth[highY * levelWidth + highX] });
+
+	return screenMin.z > farthest;
 }
 
 void Renderer::drawGrid()
 {
 	// Draw x y yellow grid
 	constexpr float gridDim = 1;
-	const int countPerAxis = GridSize;
-	for (int i = -countPerAxis/2; i < countPerAxis/2; i++) {
-		for(int j = -countPerAxis / 2; j < countPerAxis / 2; j++)
-			Renderer::drawCube({ i, 0, j}, { 0, 0, 0 }, { gridDim, 0.01, gridDim }, {1, 1, 0, 1}, *Renderer::shader, GL_LINES);
+	const int countPerAxis = std::max(GridSize, 0);
+	const int half = countPerAxis / 2;
+	const uint32_t rows = (uint32_t)(half * 2);
+
+	if (gridRows != rows) {
+		gridRows = rows;
+		gridDirty = true;
+		for (std::vector<uint8_t>& collapsed : gridCollapsed)
+			collapsed.clear();
 	}
 
+	// Coarsest level whose tiles still split the grid, every tile of it is walked down to the cells
+	uint32_t top = 0;
+	uint32_t tileSize = 1;
+	while (top + 1 < LodStats::MaxLevels && tileSize * GridLodFactor < rows) {
+		tileSize *= GridLodFactor;
+		top++;
+	}
+
+	// The tiles are chosen every frame, the boxes are only rebuilt when a choice changed
+	const uint32_t tiles = (rows + tileSize - 1) / tileSize;
+	for (uint32_t tileX = 0; tileX < tiles && top > 0; tileX++) {
+		for (uint32_t tileZ = 0; tileZ < tiles; tileZ++)
+			gridDirty |= updateGridTile(top, tileX, tileZ);
+	}
+
+	if (gridDirty) {
+		gridTransforms.clear();
+		gridLodStats = LodStats();
+		for (uint32_t tileX = 0; tileX < tiles; tileX++) {
+			for (uint32_t tileZ = 0; tileZ < tiles; tileZ++)
+				addGridTile(top, tileX, tileZ);
+		}
+		gridDirty = false;
+	}
+
+	// The boxes are composed by the SIMD submit
+	submit(info.cube_mesh, gridTransforms, { 1, 1, 0, 1 }, *Renderer::shader, GL_LINES);
+
 
 	// Draw axis lines
 	constexpr float lineLength = 5 * gridDim;
@@ -86,19 +1124,98 @@ void Renderer::drawGrid()
 
 }
 
+bool Renderer::updateGridTile(uint32_t level, uint32_t tileX, uint32_t tileZ) {
+	const GridTile tile = getGridTile(level, tileX, tileZ);
+
+	// Spacing on screen of the lines of the sub tiles, at the closest point of the tile
+	uint32_t subSize = 1;
+	for (uint32_t i = 1; i < level; i++)
+		subSize *= GridLodFactor;
+	const glm::vec3 eye = camera->getPosition();
+	const float distance = glm::length(glm::clamp(eye, tile.min, tile.max) - eye);
+	const float spacing = Lod::projectedSize((float)subSize, distance, camera->getProjection(), camera->getHeight());
+
+	uint8_t& state = getGridTileState(level, tileX, tileZ);
+	const uint8_t coarse = Lod::isCoarse(spacing, gridLod, state != 0);
+	bool changed = coarse != state;
+	state = coarse;
+	if (coarse || level == 1)
+		return changed;
+
+	for (uint32_t x = tileX * GridLodFactor; x * subSize < tile.x1; x++) {
+		for (uint32_t z = tileZ * GridLodFactor; z * subSize < tile.z1; z++)
+			changed |= updateGridTile(level - 1, x, z);
+	}
+	return changed;
+}
+
+void Renderer::addGridTile(uint32_t level, uint32_t tileX, uint32_t tileZ) {
+	const GridTile tile = getGridTile(level, tileX, tileZ);
+	if (level == 0 || getGridTileState(level, tileX, tileZ)) {
+		gridTransforms.add((tile.min + tile.max) * 0.5f, glm::quat(1, 0, 0, 0), { (float)(tile.x1 - tile.x0), 0.01f, (float)(tile.z1 - tile.z0) });
+		gridLodStats.objects[level]++;
+		gridLodStats.instances[level]++;
+		return;
+	}
+
+	uint32_t subSize = 1;
+	for (uint32_t i = 1; i < level; i++)
+		subSize *= GridLodFactor;
+	for (uint32_t x = tileX * GridLodFactor; x * subSize < tile.x1; x++) {
+		for (uint32_t z = tileZ * GridLodFactor; z * subSize < tile.z1; z++)
+			addGridTile(level - 1, x, z);
+	}
+}
+
+uint8_t& Renderer::getGridTileState(uint32_t level, uint32_t tileX, uint32_t tileZ) {
+	uint32_t size = 1;
+	for (uint32_t i = 0; i < level; i++)
+		size *= GridLodFactor;
+
+	const uint32_t tilesPerAxis = (gridRows + size - 1) / size;
+	std::vector<uint8_t>& collapsed = gridCollapsed[level];
+	collapsed.resize(tilesPerAxis * tilesPerAxis, 0);
+	return collapsed[tileZ * tilesPerAxis + tileX];
+}
+
+Renderer::GridTile Renderer::getGridTile(uint32_t level, uint32_t tileX, uint32_t tileZ) {
+	uint32_t size = 1;
+	for (uint32_t i = 0; i < level; i++)
+		size *= GridLodFactor;
+
+	GridTile tile;
+	tile.x0 = tileX * size;
+	tile.x1 = glm::min(tile.x0 + size, gridRows);
+	tile.z0 = tileZ * size;
+	tile.z1 = glm::min(tile.z0 + size, gridRows);
+	const float half = (float)(gridRows / 2);
+	tile.min = { tile.x0 - half - 0.5f, 0.0f, tile.z0 - half - 0.5f };
+	tile.max = { tile.x1 - half - 0.5f, 0.0f, tile.z1 - half - 0.5f };
+	return tile;
+}
+
 void Renderer::drawSkyBox() {
+	frames[recordIndex].drawSkyBox = true;
+}
+
+void Renderer::drawSkyBoxNow() {
+	const RenderFrame& frame = *current;
+
 	glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
 	skyboxShader->bind();
 
-	const auto&  view = glm::mat4(glm::mat3(camera->getView())); // remove translation from the view matrix
+	const auto&  view = glm::mat4(glm::mat3(frame.camera.view)); // remove translation from the view matrix
 	skyboxShader->setMat4("view", view);
-	skyboxShader->setMat4("proj", camera->getProjection());
+	skyboxShader->setMat4("proj", frame.camera.projection);
 	skyboxShader->setInt("skybox", 0);
 
-	glBindVertexArray(info.skybox_VAO_RendererID);
+	// The cube directions are all the cube map needs, so the arena cube is reused
+	const MeshInfo& cube = arena->getMesh(info.cube_mesh);
+	arena->bind();
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, info.skybox_Text_RendererID);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glDrawElementsBaseVertex(GL_TRIANGLES, cube.indexCount, GL_UNSIGNED_INT,
+		(void*)(cube.firstIndex * sizeof(uint32_t)), cube.baseVertex);
 	glBindVertexArray(0);
 	glDepthFunc(GL_LESS); // set depth function back to default
 }
@@ -111,80 +1228,95 @@ void Renderer::drawSkyBox() {
 void Renderer::init()
 {
 	//******************** CUBE Stuff ********************
-	float vertices[] = {
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-	};
+	MeshBuilder cube;
+	cube.addBox();
 
-	// first, configure the cube's VAO (and VBO)
-	unsigned int VBO, cubeVAO;
-	glGenVertexArrays(1, &cubeVAO);
-	glGenBuffers(1, &VBO);
+	arena = new MeshArena;
+	info.cube_mesh = arena->addMesh(cube.getVertices(), cube.getIndices());
+	arena->upload();
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	// Instance attributes live in their own buffer but are part of the arena VAO
+	glGenBuffers(1, &info.instance_BufferID);
+	glGenBuffers(1, &info.indirect_BufferID);
+	glGenBuffers(1, &info.camera_UniformBufferID);
 
-	glBindVertexArray(cubeVAO);
+	// Culling pass buffers
+	glGenBuffers(1, &info.cull_InstanceBufferID);
+	glGenBuffers(1, &info.cull_BoundsBufferID);
+	glGenBuffers(1, &info.cull_CounterBufferID);
 
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	const uint32_t zeros[2] = { 0, 0 };	// Visible and occluded counters
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, info.cull_CounterBufferID);
+	glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_COPY);
 
-	// normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	cullShader = new Shader("shaders/cull.glsl");
+	depthShader = new Shader("shaders/depth.glsl");
+	hiZShader = new Shader("shaders/hiz.glsl");
+	clusterShader = new Shader("shaders/cluster.glsl");
+	gBufferShader = new Shader("shaders/gbuffer.glsl");
+	deferredShader = new Shader("shaders/deferred.glsl");
+	shadowShader = new Shader("shaders/shadow.glsl");
+	unpackShader = new Shader("shaders/unpack.glsl");
 
-	RendererInfo info;
-	info.cube_size = sizeof(vertices);
-	info.cube_rendererID = cubeVAO;
-	info.cube_count = sizeof(vertices) / sizeof(GLfloat) / 6;
-	info.cube_indexCount = -1;//sizeof(cube_indices) / sizeof(GLuint);
+	// The cluster grid has a fixed size, only the light buffer grows with the lights
+	constexpr uint32_t clusterCount = ClusterX * ClusterY * ClusterZ;
+	glGenBuffers(1, &info.light_BufferID);
+	glGenBuffers(1, &info.cluster_LightsBufferID);
+	glGenBuffers(1, &info.cluster_CountsBufferID);
 
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, info.cluster_LightsBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, clusterCount * MaxLightsPerCluster * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, info.cluster_CountsBufferID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, clusterCount * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+	glCreateBuffers(1, &info.cluster_OverflowBufferID);
+	glNamedBufferData(info.cluster_OverflowBufferID, 2 * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
 
-	Renderer::info = info;
+	info.hiZ_FramebufferID = info.hiZ_DepthTextureID = info.hiZ_TextureID = 0;
+	info.hiZ_Width = info.hiZ_Height = info.hiZ_Levels = 0;
+	info.scene_FramebufferID = info.scene_ColorTextureID = info.scene_DepthTextureID = 0;
+	info.scene_Width = info.scene_Height = 0;
+	info.gBuffer_FramebufferID = info.gBuffer_AlbedoTextureID = info.gBuffer_NormalTextureID = info.gBuffer_DepthTextureID = 0;
+	info.gBuffer_Width = info.gBuffer_Height = 0;
+	glCreateVertexArrays(1, &info.fullscreen_VertexArrayID);
+	info.shadow_FramebufferID = info.shadow_TextureID = info.shadow_Resolution = info.shadow_Cascades = 0;
+
+	arena->bind();
+	glBindBuffer(GL_ARRAY_BUFFER, info.instance_BufferID);
+
+	// transform attribute (a mat4 takes 4 locations)
+	for (uint32_t i = 0; i < 4; i++) {
+		glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(offsetof(InstanceData, transform) + i * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(2 + i);
+		glVertexAttribDivisor(2 + i, 1);
+	}
+
+	// colour attribute
+	glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+	glEnableVertexAttribArray(6);
+	glVertexAttribDivisor(6, 1);
+
+	// normal matrix attribute (a mat3 takes 3 locations)
+	for (uint32_t i = 0; i < 3; i++) {
+		glVertexAttribPointer(7 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(7 + i);
+		glVertexAttribDivisor(7 + i, 1);
+	}
+
+	glBindVertexArray(0);
 
 	Renderer::initCubeMap();
 }
 
+void Renderer::shutdown()
+{
+	for (GpuTimer* timer : { &clusterTimer, &drawTimer, &lightingTimer, &shadowTimer })
+		timer->release();
+	cullReadback.release();
+	clusterReadback.release();
+}
+
 void Renderer::initCubeMap() {
 	std::vector<std::string> faces{
 			"shaders/skybox/right.jpg",
@@ -222,62 +1354,5 @@ void Renderer::initCubeMap() {
 
 	skyboxShader = new Shader("shaders/skyboxShader.glsl");
 
-	// Init VAO skybox
-	float skyboxVertices[] = {
-		// positions          
-		-1.0f,  1.0f, -1.0f,
-		-1.0f, -1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-		 1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-
-		-1.0f, -1.0f,  1.0f,
-		-1.0f, -1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f, -1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f,
-
-		 1.0f, -1.0f, -1.0f,
-		 1.0f, -1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-
-		-1.0f, -1.0f,  1.0f,
-		-1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f, -1.0f,  1.0f,
-		-1.0f, -1.0f,  1.0f,
-
-		-1.0f,  1.0f, -1.0f,
-		 1.0f,  1.0f, -1.0f,
-		 1.0f,  1.0f,  1.0f,
-		 1.0f,  1.0f,  1.0f,
-		-1.0f,  1.0f,  1.0f,
-		-1.0f,  1.0f, -1.0f,
-
-		-1.0f, -1.0f, -1.0f,
-		-1.0f, -1.0f,  1.0f,
-		 1.0f, -1.0f, -1.0f,
-		 1.0f, -1.0f, -1.0f,
-		-1.0f, -1.0f,  1.0f,
-		 1.0f, -1.0f,  1.0f
-	};
-
-	// skybox VAO
-	unsigned int skyboxVAO, skyboxVBO;
-	glGenVertexArrays(1, &skyboxVAO);
-	glGenBuffers(1, &skyboxVBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
 	Renderer::info.skybox_Text_RendererID = textureID;
-	Renderer::info.skybox_VAO_RendererID = skyboxVAO;
 }
@@ -1,23 +1,190 @@
 #pragma once
+#include <vector>
 #include <Camera.h>
 #include <Shader.h>
-
-struct Light;
+#include "MeshArena.h"
+#include "Light.h"
+#include "TransformSoA.h"
+#include "GpuTimer.h"
+#include "Lod.h"
+#include "MeshBuilder.h"
+#include "MeshCooker.h"
 
 // Unsed to store RendererIDs in Renderer class
 struct RendererInfo {
-	uint32_t cube_rendererID;
-	uint32_t cube_size;
-	uint32_t cube_count;
-	uint32_t cube_indexCount;
+	MeshID cube_mesh;
+
+	uint32_t instance_BufferID;		// Instances read by the draws (after culling)
+	uint32_t indirect_BufferID;
+	uint32_t camera_UniformBufferID;
+
+	uint32_t cull_InstanceBufferID;	// Every queued instance, input of the culling pass
+	uint32_t cull_BoundsBufferID;
+	uint32_t cull_CounterBufferID;
+
+	// Hierarchical depth (occlusion culling)
+	uint32_t hiZ_FramebufferID;
+	uint32_t hiZ_DepthTextureID;
+	uint32_t hiZ_TextureID;
+	uint32_t hiZ_Width;
+	uint32_t hiZ_Height;
+	uint32_t hiZ_Levels;
+
+	// Offscreen copy of the last scene (render on demand)
+	uint32_t scene_FramebufferID;
+	uint32_t scene_ColorTextureID;
+	uint32_t scene_DepthTextureID;
+	uint32_t scene_Width;
+	uint32_t scene_Height;
+
+	// Clustered forward lighting
+	uint32_t light_BufferID;
+	uint32_t cluster_LightsBufferID;	// Light indices, MaxLightsPerCluster per cluster
+	uint32_t cluster_CountsBufferID;
+	uint32_t cluster_OverflowBufferID;		// Clusters past MaxLightsPerCluster and lights they dropped, read back a few builds later
 
-	uint32_t quad_rendererID;
-	uint32_t quad_size;
-	uint32_t quad_count;
-	uint32_t quad_indexCount;
+	// G-buffer of the deferred lighting path
+	uint32_t gBuffer_FramebufferID;
+	uint32_t gBuffer_AlbedoTextureID;
+	uint32_t gBuffer_NormalTextureID;	// Octahedral encoded, two signed 16 bit components
+	uint32_t gBuffer_DepthTextureID;
+	uint32_t gBuffer_Width;
+	uint32_t gBuffer_Height;
+	uint32_t fullscreen_VertexArrayID;	// Empty, the full screen triangle is built from gl_VertexID
+
+	// Cascaded shadow maps, one layer per cascade
+	uint32_t shadow_FramebufferID;
+	uint32_t shadow_TextureID;
+	uint32_t shadow_Resolution;
+	uint32_t shadow_Cascades;
 
 	uint32_t skybox_Text_RendererID;
-	uint32_t skybox_VAO_RendererID;
+};
+
+// Per instance attributes streamed next to the arena vertices (std430 layout, see shaders/cull.glsl)
+struct InstanceData {
+	glm::mat4 transform;
+	glm::vec4 color;
+	glm::vec4 normalMatrix[3];	// Columns of the normal matrix, w unused. Filled by the Renderer when submitted
+
+	/**
+	 * \brief Inverse transpose of the upper 3x3 of transform, up to a positive scale (the cofactor matrix, negated
+	 * when the determinant is negative). Right for non uniform and negative scales, defined for zero scales
+	 */
+	void computeNormalMatrix();
+};
+
+// World space box of an instance, plus the indirect command it belongs to (std430 layout)
+struct InstanceBounds {
+	enum Flags : uint32_t { OCCLUDER = 1 };
+
+	glm::vec3 min;
+	uint32_t command;
+	glm::vec3 max;
+	uint32_t flags;
+};
+
+// std140 layout of the CameraData uniform block (binding 0)
+struct CameraUniform {
+	glm::mat4 viewProjection;
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 frustumPlanes[6];
+	glm::vec4 position;
+};
+
+// Camera state captured when a frame is recorded, the GL side never reads the live Camera
+struct CameraSnapshot {
+	glm::mat4 viewProjection;
+	glm::mat4 view;
+	glm::mat4 projection;
+	Frustum frustum;
+	glm::vec3 position;
+	uint32_t width;
+	uint32_t height;
+};
+
+enum class CullingMode {
+	None = 0,
+	CPU,	// Reference implementation, same algorithm as shaders/cull.glsl
+	GPU
+};
+
+// Cascaded shadow maps of the scene light, captured with every frame
+struct ShadowSettings {
+	static constexpr uint32_t MaxCascades = 4;
+
+	bool enabled = true;
+	uint32_t resolution = 2048;		// Side of every cascade, in texels
+	uint32_t cascadeCount = 3;
+	float distance = 150.0f;		// View depth where the last cascade ends
+	float splitLambda = 0.75f;		// Blend between uniform (0) and logarithmic (1) cascade splits
+};
+
+enum class LightingPath {
+	Forward = 0,	// Lit while drawing, shaders/shader.glsl
+	Deferred		// G-buffer pass (shaders/gbuffer.glsl) then one full screen lighting pass (shaders/deferred.glsl)
+};
+
+// Layout expected by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t  baseVertex;
+	uint32_t baseInstance;
+};
+
+struct RendererStats {
+	uint32_t apiDrawCalls = 0;		// Number of glMultiDrawElementsIndirect calls
+	uint32_t commandCount = 0;		// Number of indirect commands (one per mesh/state)
+	uint32_t instanceCount = 0;
+	uint32_t visibleCount = 0;		// GPU culling reports the value of a frame a few frames old
+	uint32_t validationErrors = 0;	// Commands where the GPU and CPU culling disagree
+	uint32_t occluderCount = 0;		// Instances drawn in the depth pre-pass
+	uint32_t occludedCount = 0;		// Instances in the frustum rejected by the Hi-Z test
+	uint32_t pointLightCount = 0;
+	float clusterMs = 0.0f;			// GPU time of the light binning pass
+	uint32_t overflowClusters = 0;	// Clusters that touched more than MaxLightsPerCluster lights, from a build a few frames old
+	uint32_t droppedClusterLights = 0;	// Lights those clusters left out, summed over the clusters
+	float drawMs = 0.0f;			// GPU time of the scene draws (the G-buffer pass when deferred)
+	float lightingMs = 0.0f;		// GPU time of the deferred lighting pass
+	float shadowMs = 0.0f;			// GPU time of every shadow cascade
+	uint32_t shadowCasters[ShadowSettings::MaxCascades] = {};	// Instances drawn in each cascade
+};
+
+// Queued draw, sorted at the end of the scene to build the indirect commands
+struct DrawPacket {
+	Shader* shader;
+	int mode;
+	MeshID mesh;
+	uint32_t instance;
+};
+
+// Everything recorded for one frame. Renderer keeps two: the main thread records one while the other is drawn
+struct RenderFrame {
+	std::vector<DrawPacket> packets;
+	std::vector<InstanceData> instances;
+	std::vector<InstanceBounds> bounds;
+
+	// Built by endScene, in command order
+	std::vector<InstanceData> sortedInstances;
+	std::vector<InstanceBounds> sortedBounds;
+	std::vector<DrawElementsIndirectCommand> commands;
+
+	CameraSnapshot camera;
+	Light light;
+	std::vector<PointLightData> pointLights;
+	bool clusteredLighting = true;
+	LightingPath lightingPath = LightingPath::Forward;
+	ShadowSettings shadows;
+	CullingMode cullingMode = CullingMode::GPU;
+	bool occlusionCulling = false;
+	bool validateCulling = false;
+
+	bool drawScene = true;
+	bool drawSkyBox = false;
+	bool useSceneFramebuffer = false;
 };
 
 class Renderer
@@ -62,6 +229,19 @@ public:
 						 Shader& shader = *Renderer::shader,
 						 int mode = renderingMode);
 
+	/**
+	 * \brief Draws a cube with a quaternion rotation, no Euler angle conversion
+	 */
+	static void drawCube(const Transform& transform,
+						 const glm::vec4& color = WHITE,
+						 Shader& shader = *Renderer::shader,
+						 int mode = renderingMode);
+
+	/**
+	 * \brief Builds the transform used by the RotationInfo overload of drawCube
+	 */
+	static glm::mat4 computeTransform(const glm::vec3& pos, const RotationInfo& rotationData, const glm::vec3& scale);
+
 	/**
 	 * \brief Draw cube using transform matrix
 	 * \param transform 
@@ -72,12 +252,119 @@ public:
 						 int mode = renderingMode);
 
 	/**
-	 * \brief Draws a grid depending on the Renderer::GridSize
+	 * \brief Queues an instance of an arena mesh. Nothing is drawn until Renderer::endScene
+	 * \param mesh Mesh returned by MeshArena::addMesh
+	 */
+	static void submit(MeshID mesh,
+					   const glm::mat4& transform,
+					   const glm::vec4& color = WHITE,
+					   Shader& shader = *Renderer::shader,
+					   int mode = renderingMode);
+
+	/**
+	 * \brief Queues many instances of the same mesh at once, their boxes are computed in parallel by the JobSystem
+	 */
+	static void submit(MeshID mesh,
+					   const InstanceData* data,
+					   uint32_t count,
+					   Shader& shader = *Renderer::shader,
+					   int mode = renderingMode);
+
+	/**
+	 * \brief Queues every transform of a TransformSoA, the matrices are composed with SIMD straight into the
+	 * instance buffer of the frame, in parallel by the JobSystem
+	 */
+	static void submit(MeshID mesh,
+					   const TransformSoA& transforms,
+					   const glm::vec4& color = WHITE,
+					   Shader& shader = *Renderer::shader,
+					   int mode = renderingMode);
+
+	/**
+	 * \brief Same as the TransformSoA overload, for columns stored elsewhere (e.g. a mapped SceneFile)
+	 * \param colors One per transform
+	 */
+	static void submit(MeshID mesh,
+					   const TransformColumns& transforms,
+					   const glm::vec4* colors,
+					   Shader& shader = *Renderer::shader,
+					   int mode = renderingMode);
+
+	/**
+	 * \brief Queues point lights already in the layout of the light buffer
+	 */
+	static void submitLights(const PointLightData* lights, uint32_t count);
+
+	/**
+	 * \brief Adds a mesh to the arena and uploads the arena again. Call from the thread owning the GL context,
+	 * before the render thread starts
+	 */
+	static MeshID addMesh(const MeshBuilder& mesh);
+
+	/**
+	 * \brief Maps a cooked mesh file (see MeshCooker) and decodes it into the arena on the GPU, the file is not parsed.
+	 * Same threading rules as addMesh
+	 * \param header Receives the header of the file when not null
+	 * \return InvalidMesh if the file is missing or not a cooked mesh
+	 */
+	static MeshID loadMesh(const std::string& path, CookedMeshHeader* header = nullptr);
+
+	/**
+	 * \brief Vertex shader invocations of one draw of the mesh with nothing rasterised: they only depend on the order
+	 * of its indices, not on the view. Waits for the GPU, same threading rules as addMesh
+	 * \return 0 without ARB_pipeline_statistics_query
+	 */
+	static uint64_t measureVertexInvocations(MeshID mesh);
+
+	/**
+	 * \brief Queues a point light for the clustered forward pass, until the end of the frame
+	 */
+	static void submitLight(const glm::vec3& position, const PointLight& light);
+
+	/**
+	 * \brief Starts recording a frame, captures the camera, the light and the culling settings
+	 * \param drawScene false to only present the last scene framebuffer again (render on demand)
+	 * \param useSceneFramebuffer Draws the scene in an offscreen framebuffer that can be presented again later
+	 */
+	static void beginFrame(bool drawScene = true, bool useSceneFramebuffer = false);
+
+	/**
+	 * \brief Clears the queued draws. Call once per frame before any drawCube/submit
+	 */
+	static void beginScene();
+
+	/**
+	 * \brief Sorts the queued draws by shader, mode and mesh and builds the indirect commands.
+	 * No GL call, nothing is drawn until Renderer::renderFrame
+	 */
+	static void endScene();
+
+	/**
+	 * \brief Draws a recorded frame with one glMultiDrawElementsIndirect per shader/mode pair, then the skybox.
+	 * Must be called from the thread owning the GL context
+	 * \param index Frame returned by getRecordIndex() when it was recorded
+	 */
+	static void renderFrame(uint32_t index);
+
+	/**
+	 * \brief Frames are double buffered: the main thread records one while the render thread draws the other
+	 */
+	inline static uint32_t getRecordIndex() { return recordIndex; }
+	inline static void swapRecordFrame() { recordIndex ^= 1; }
+
+	/**
+	 * \brief Makes the stats of the last drawn frame visible to getStats(). Call while no frame is being drawn
+	 */
+	static void publishStats();
+
+	/**
+	 * \brief Draws a grid depending on the Renderer::GridSize. Far tiles of 10x10 and 100x100 cells are drawn as
+	 * one box, only every 10th or 100th line is left (see setGridLod)
 	 */
 	static void drawGrid();
 
 	/**
-	 * \brief Draws the Cube map skybox
+	 * \brief Queues the Cube map skybox, drawn after the scene
 	 */
 	static void drawSkyBox();
 
@@ -86,29 +373,245 @@ public:
 	 */
 	static void init();
 
+	/**
+	 * \brief Releases the GPU timers and readbacks while the OpenGL context is still current, their destructors run after it is gone
+	 */
+	static void shutdown();
+
 	/**
 	 * \return current rendering mode (Triangles, Lines, etc.)
 	 */
 	inline static int getRenderingMode() { return renderingMode; }
 
+	inline static void setCullingMode(CullingMode mode) { cullingMode = mode; }
+	inline static CullingMode getCullingMode() { return cullingMode; }
+
+	/**
+	 * \brief When enabled with GPU culling, the CPU reference also runs and the indirect buffer is read back
+	 * to compare the visible counts. Stalls the pipeline, debugging only
+	 */
+	inline static void setCullingValidation(bool cond) { validateCulling = cond; }
+	inline static bool isCullingValidated() { return validateCulling; }
+
+	inline static void setClusteredLighting(bool cond) { clusteredLighting = cond; }
+	inline static bool isClusteredLighting() { return clusteredLighting; }
+
+	/**
+	 * \brief Deferred moves the lighting out of the scene draws, its cost no longer grows with the geometry.
+	 * Only the default shader is replaced by the G-buffer shader, the other shaders write their colour as albedo
+	 */
+	inline static void setLightingPath(LightingPath path) { lightingPath = path; }
+	inline static LightingPath getLightingPath() { return lightingPath; }
+
+	/**
+	 * \brief The threshold is the spacing in pixels between the lines of a tile under which the tile collapses
+	 */
+	inline static void setGridLod(const LodSettings& settings) { gridLod = settings; gridDirty = true; }
+	inline static const LodSettings& getGridLod() { return gridLod; }
+	inline static const LodStats& getGridLodStats() { return gridLodStats; }
+
+	inline static void setShadowSettings(const ShadowSettings& settings) { shadowSettings = settings; }
+	inline static const ShadowSettings& getShadowSettings() { return shadowSettings; }
+
+	/**
+	 * \brief Renders the large triangle meshes in a depth pre-pass, builds a Hi-Z pyramid from it and
+	 * rejects the instances hidden behind them. Only used when a culling mode is selected
+	 */
+	inline static void setOcclusionCulling(bool cond) { occlusionCulling = cond; }
+	inline static bool isOcclusionCulling() { return occlusionCulling; }
+
+	inline static MeshArena& getMeshArena() { return *arena; }
+	inline static MeshID getCubeMesh() { return info.cube_mesh; }
+	inline static Shader& getDefaultShader() { return *shader; }
+	inline static const RendererStats& getStats() { return publishedStats; }
+
 private:
 	/**
 	 * \brief Initialize everything used for the skybox
 	 */
 	static void initCubeMap();
 
+	/**
+	 * \brief Culls and draws the commands of the current frame
+	 */
+	static void drawScene();
+
+	static void drawSkyBoxNow();
+
+	/**
+	 * \brief Chooses if the tile is drawn as one box, then does the same for its sub tiles if it is not.
+	 * Stops above the cells
+	 * \param level 0 is a single cell, every level groups GridLodFactor x GridLodFactor tiles of the level below
+	 * \return true if a tile changed, the grid boxes must be rebuilt
+	 */
+	static bool updateGridTile(uint32_t level, uint32_t tileX, uint32_t tileZ);
+
+	/**
+	 * \brief Adds the boxes of a tile to gridTransforms: one box if updateGridTile collapsed it, its sub tiles otherwise
+	 */
+	static void addGridTile(uint32_t level, uint32_t tileX, uint32_t tileZ);
+
+	/**
+	 * \brief Last choice of updateGridTile for the tile, created expanded
+	 */
+	static uint8_t& getGridTileState(uint32_t level, uint32_t tileX, uint32_t tileZ);
+
+	// Cells covered by a tile and its corners on the xz plane, the last tiles are cut by the grid border
+	struct GridTile {
+		uint32_t x0, x1, z0, z1;
+		glm::vec3 min, max;
+	};
+	static GridTile getGridTile(uint32_t level, uint32_t tileX, uint32_t tileZ);
+
+	/**
+	 * \brief Redirects the next draws to an offscreen framebuffer the size of the window,
+	 * so the scene can be presented again without being redrawn
+	 */
+	static void bindSceneFramebuffer();
+
+	/**
+	 * \brief Copies the last scene drawn in the offscreen framebuffer to the window and binds the window back
+	 */
+	static void presentSceneFramebuffer();
+
+	/**
+	 * \brief World space box of a mesh instance, flagged as an occluder if it is large and solid
+	 */
+	static InstanceBounds computeBounds(MeshID mesh, const glm::mat4& transform, int mode);
+
+	/**
+	 * \brief Shared by the transform column submits, colors is per transform or nullptr for color everywhere
+	 */
+	static void submitTransforms(MeshID mesh, const TransformColumns& transforms, const glm::vec4* colors, const glm::vec4& color,
+		Shader& shader, int mode);
+
+	/**
+	 * \brief Compacts the visible instances of the frame's sortedInstances into culledInstances/culledCommands
+	 */
+	static void cullCPU(const Frustum& frustum);
+
+	/**
+	 * \brief Dispatches shaders/cull.glsl, which writes the visible instances and counts directly in the GPU buffers
+	 */
+	static void cullGPU();
+
+	/**
+	 * \brief Reads back the GPU indirect buffer and compares it to the CPU reference
+	 */
+	static uint32_t validateGPUCulling();
+
+	/**
+	 * \brief Draws the occluders in the Hi-Z depth buffer and builds the pyramid
+	 */
+	static void buildHiZ();
+
+	/**
+	 * \brief Uploads the point lights and bins them in the cluster grid (shaders/cluster.glsl)
+	 */
+	static void buildClusters();
+
+	/**
+	 * \brief Fits the cascades to the camera frustum and draws the triangle meshes in each of them.
+	 * Every cascade only draws the instances inside its own light frustum
+	 */
+	static void buildShadowMaps();
+
+	/**
+	 * \brief Cascade matrices and splits read by shaders/shader.glsl and shaders/deferred.glsl
+	 */
+	static void setShadowUniforms(Shader& shader);
+
+	/**
+	 * \brief Binds and clears the G-buffer, the scene draws that follow fill it
+	 */
+	static void bindGBuffer();
+
+	/**
+	 * \brief Lights the G-buffer into the target framebuffer with one full screen triangle. The depth is
+	 * written back so the skybox is still depth tested
+	 */
+	static void drawDeferredLighting(const glm::vec4& clusterParams, bool clustered);
+
+	/**
+	 * \brief (Re)creates the depth buffer and pyramid textures when the window size changes
+	 */
+	static void resizeHiZ(uint32_t width, uint32_t height);
+
+	static void resizeSceneFramebuffer(uint32_t width, uint32_t height);
+
+	static void resizeGBuffer(uint32_t width, uint32_t height);
+
+	static void resizeShadowMaps(uint32_t resolution, uint32_t cascades);
+
+	/**
+	 * \brief CPU version of the Hi-Z test in shaders/cull.glsl, reads hiZLevels
+	 */
+	static bool isOccludedCPU(const InstanceBounds& box);
+
 private:
 	inline static Camera* camera = nullptr;
 	inline static Light* light = nullptr;
 	inline static Shader* shader = nullptr;		// Default shader
 	inline static Shader* skyboxShader = nullptr;		// Skybox shader
+	inline static Shader* cullShader = nullptr;
+	inline static Shader* depthShader = nullptr;
+	inline static Shader* hiZShader = nullptr;
+	inline static Shader* clusterShader = nullptr;
+	inline static Shader* gBufferShader = nullptr;
+	inline static Shader* deferredShader = nullptr;
+	inline static Shader* shadowShader = nullptr;
+	inline static Shader* unpackShader = nullptr;
 	inline static int renderingMode = 0x0004;
 	inline static RendererInfo info;
+	inline static RendererStats stats;				// Written while drawing
+	inline static RendererStats publishedStats;		// Read by the UI
+	inline static MeshArena* arena = nullptr;
+	inline static uint32_t targetFramebuffer = 0;	// Framebuffer the scene is drawn to (0 is the window)
+
+	inline static RenderFrame frames[2];
+	inline static uint32_t recordIndex = 0;
+	inline static const RenderFrame* current = nullptr;	// Frame being drawn
+
+	inline static CullingMode cullingMode = CullingMode::GPU;
+	inline static bool validateCulling = false;
+	inline static bool occlusionCulling = false;
+	inline static bool clusteredLighting = true;
+	inline static GpuReadback cullReadback;			// Visible and occluded counters of the culling pass
+	inline static GpuTimer clusterTimer;
+	inline static GpuReadback clusterReadback;		// Overflow counters of the light binning pass
+	inline static GpuTimer drawTimer;
+	inline static GpuTimer lightingTimer;
+	inline static LightingPath lightingPath = LightingPath::Forward;
+	inline static ShadowSettings shadowSettings;
+	inline static GpuTimer shadowTimer;
+	inline static glm::mat4 shadowMatrices[ShadowSettings::MaxCascades];	// World to cascade clip space
+	inline static glm::vec4 cascadeSplits = glm::vec4(0.0f);				// View depth where every cascade ends
+	inline static std::vector<uint8_t> shadowMasks;		// Per sorted instance, one bit per cascade it is drawn in
+	inline static std::vector<uint32_t> casterOffsets;	// Per command, casters of the cascade then where they go
+	inline static float occluderMinSize = 0.5f;	// Smallest box side for a triangle mesh to be drawn in the pre-pass
+	inline static std::vector<std::vector<float>> hiZLevels;	// CPU copy of the pyramid for the CPU culling mode
+	inline static std::vector<InstanceData> culledInstances;
+	inline static std::vector<DrawElementsIndirectCommand> culledCommands;
+	inline static std::vector<uint8_t> cullResults;		// Per sorted instance, written in parallel by cullCPU
+	inline static TransformSoA gridTransforms;		// Boxes of the grid, rebuilt from the tile levels when one changes
+	inline static bool gridDirty = true;
+	inline static LodSettings gridLod = { true, 6.0f, 0.25f };
+	inline static LodStats gridLodStats;
+	inline static std::vector<uint8_t> gridCollapsed[LodStats::MaxLevels];	// Per tile of every level, last LOD choice
+	inline static uint32_t gridRows = 0;			// Cells per axis of the grid the tile states belong to
 
 	inline static glm::vec3 ZERO = glm::vec3(0);
 	inline static glm::vec3 ONE = glm::vec3(1);
 	inline static glm::vec4 WHITE = glm::vec4(1);
 public:
 	inline static int GridSize = 100;
+	static constexpr int MaxGridSize = 4000;		// Bound of the UI, 16M cells when the grid LOD is off
+	static constexpr uint32_t GridLodFactor = 10;	// Cells per axis of a tile, per level
+
+	// Cluster grid of the clustered forward lighting, must match shaders/cluster.glsl and shaders/shader.glsl
+	static constexpr uint32_t ClusterX = 16;
+	static constexpr uint32_t ClusterY = 9;
+	static constexpr uint32_t ClusterZ = 24;
+	static constexpr uint32_t MaxLightsPerCluster = 128;
 };
 
@@ -0,0 +1,210 @@
+#include "SceneCompiler.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Reads count numbers of an array member, leaves out untouched if the member is missing
+	bool readFloats(const JsonValue& object, const char* key, float* out, size_t count, std::string& error)
+	{
+		const JsonValue* value = object.find(key);
+		if (!value)
+			return true;
+
+		if (!value->isArray() || value->array.size() != count
+			|| std::any_of(value->array.begin(), value->array.end(), [](const JsonValue& v) { return !v.isNumber(); })) {
+			error = std::string("\"") + key + "\" must be an array of " + std::to_string(count) + " numbers";
+			return false;
+		}
+		for (size_t i = 0; i < count; i++)
+			out[i] = (float)value->array[i].number;
+		return true;
+	}
+
+	// Counts of a grid, whole numbers whose product fits the uint32_t object count of a scene file
+	bool readGridCount(const JsonValue& object, uint32_t* out, std::string& error)
+	{
+		const JsonValue* value = object.find("count");
+		if (!value)
+			return true;
+
+		double product = 1.0;
+		bool valid = value->isArray() && value->array.size() == 2;
+		for (size_t i = 0; i < 2 && valid; i++) {
+			const JsonValue& count = value->array[i];
+			valid = count.isNumber() && count.number >= 0.0 && count.number == std::floor(count.number);
+			product *= valid ? count.number : 0.0;
+		}
+		if (!valid || product >= 4294967296.0) {
+			error = "\"count\" must be an array of 2 whole numbers, at most 2^32 - 1 objects";
+			return false;
+		}
+		out[0] = (uint32_t)value->array[0].number;
+		out[1] = (uint32_t)value->array[1].number;
+		return true;
+	}
+
+	bool readFloat(const JsonValue& object, const char* key, float& out, std::string& error)
+	{
+		const JsonValue* value = object.find(key);
+		if (!value)
+			return true;
+		if (!value->isNumber()) {
+			error = std::string("\"") + key + "\" must be a number";
+			return false;
+		}
+		out = (float)value->number;
+		return true;
+	}
+
+	// Index of the mesh in the table of the scene, added on first use
+	bool readMesh(const JsonValue& object, SceneDescription& scene, uint32_t& mesh, std::string& error)
+	{
+		const JsonValue* value = object.find("mesh");
+		const std::string name = value ? value->string : "cube";
+		if (value && !value->isString()) {
+			error = "\"mesh\" must be a string";
+			return false;
+		}
+
+		const auto found = std::find(scene.meshes.begin(), scene.meshes.end(), name);
+		mesh = (uint32_t)(found - scene.meshes.begin());
+		if (found == scene.meshes.end())
+			scene.meshes.push_back(name);
+		return true;
+	}
+
+	bool readObject(const JsonValue& object, SceneDescription& scene, SceneObject& out, std::string& error)
+	{
+		if (!object.isObject()) {
+			error = "objects must be JSON objects";
+			return false;
+		}
+
+		glm::vec3 degrees = glm::vec3(0);
+		if (!readMesh(object, scene, out.mesh, error)
+			|| !readFloats(object, "position", &out.position.x, 3, error)
+			|| !readFloats(object, "rotation", &degrees.x, 3, error)
+			|| !readFloats(object, "color", &out.color.x, 4, error))
+			return false;
+		out.rotation = Transform::fromEuler(degrees);
+
+		const JsonValue* scale = object.find("scale");
+		if (scale && scale->isNumber())
+			out.scale = glm::vec3((float)scale->number);
+		else if (!readFloats(object, "scale", &out.scale.x, 3, error))
+			return false;
+		return true;
+	}
+}
+
+bool SceneCompiler::compile(const std::string& input, const std::string& output)
+{
+	std::ifstream file(input);
+	if (!file) {
+		std::cout << "Failed to open " << input << std::endl;
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	JsonValue document;
+	SceneDescription scene;
+	std::string error;
+	if (!Json::parse(text.str(), document, error) || !parse(document, scene, error)) {
+		std::cout << input << ": " << error << std::endl;
+		return false;
+	}
+
+	if (!SceneFile::write(output, scene))
+		return false;
+
+	std::cout << input << ": " << scene.objects.size() << " objects, " << scene.meshes.size() << " meshes, "
+		<< scene.pointLights.size() << " point lights" << std::endl;
+	return true;
+}
+
+bool SceneCompiler::parse(const JsonValue& document, SceneDescription& scene, std::string& error)
+{
+	if (!document.isObject()) {
+		error = "the document must be a JSON object";
+		return false;
+	}
+
+	if (const JsonValue* light = document.find("light")) {
+		if (!light->isObject()) {
+			error = "\"light\" must be a JSON object";
+			return false;
+		}
+		if (!readFloats(*light, "position", &scene.light.position.x, 3, error)
+			|| !readFloats(*light, "color", &scene.light.color.x, 4, error)
+			|| !readFloat(*light, "ambient", scene.light.ambientStrength, error))
+			return false;
+	}
+
+	if (const JsonValue* objects = document.find("objects")) {
+		if (!objects->isArray()) {
+			error = "\"objects\" must be an array";
+			return false;
+		}
+		for (const JsonValue& object : objects->array) {
+			SceneObject parsed;
+			if (!readObject(object, scene, parsed, error))
+				return false;
+			scene.objects.push_back(parsed);
+		}
+	}
+
+	// Rows and columns of the same object on the xz plane, the way to author large scenes
+	if (const JsonValue* grids = document.find("grids")) {
+		if (!grids->isArray()) {
+			error = "\"grids\" must be an array";
+			return false;
+		}
+		for (const JsonValue& grid : grids->array) {
+			SceneObject object;
+			uint32_t count[2] = { 1, 1 };
+			float spacing[2] = { 1, 1 };
+			if (!readObject(grid, scene, object, error)
+				|| !readGridCount(grid, count, error)
+				|| !readFloats(grid, "spacing", spacing, 2, error))
+				return false;
+			if ((uint64_t)count[0] * count[1] > UINT32_MAX - scene.objects.size()) {
+				error = "a scene holds at most 2^32 - 1 objects";
+				return false;
+			}
+
+			const glm::vec3 origin = object.position;
+			for (uint32_t z = 0; z < count[1]; z++) {
+				for (uint32_t x = 0; x < count[0]; x++) {
+					object.position = origin + glm::vec3(x * spacing[0], 0.0f, z * spacing[1]);
+					scene.objects.push_back(object);
+				}
+			}
+		}
+	}
+
+	if (const JsonValue* lights = document.find("pointLights")) {
+		if (!lights->isArray()) {
+			error = "\"pointLights\" must be an array";
+			return false;
+		}
+		for (const JsonValue& light : lights->array) {
+			glm::vec3 position = glm::vec3(0);
+			PointLight parsed;
+			if (!light.isObject()) {
+				error = "point lights must be JSON objects";
+				return false;
+			}
+			if (!readFloats(light, "position", &position.x, 3, error)
+				|| !readFloats(light, "color", &parsed.color.x, 3, error)
+				|| !readFloat(light, "intensity", parsed.intensity, error)
+				|| !readFloat(light, "radius", parsed.radius, error))
+				return false;
+			scene.pointLights.push_back({ glm::vec4(position, parsed.radius), glm::vec4(parsed.color, parsed.intensity) });
+		}
+	}
+	return true;
+}
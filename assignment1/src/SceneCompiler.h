@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include "SceneFile.h"
+#include "Json.h"
+
+/**
+ * \brief Offline compiler of the JSON authoring form of a scene into a scene file, run with --compile-scene input.json output.scene
+ *
+ * {
+ *   "light": { "position": [0, 30, 0], "color": [1, 1, 1, 1], "ambient": 0.5 },
+ *   "objects": [ { "mesh": "olaf", "position": [0, 0, 0], "rotation": [0, 45, 0], "scale": 1, "color": [1, 1, 1, 1] } ],
+ *   "grids": [ { "mesh": "cube", "count": [1000, 1000], "spacing": [2, 2], "position": [-1000, 0, -1000], ...same as an object } ],
+ *   "pointLights": [ { "position": [0, 2, 0], "color": [1, 0.5, 0.2], "intensity": 2, "radius": 6 } ]
+ * }
+ *
+ * Meshes are "cube", "olaf" or the path of a cooked mesh. Rotations are Euler angles in degrees (see Transform::fromEuler),
+ * a scale is a number or one per axis. Every member is optional
+ */
+class SceneCompiler
+{
+public:
+	/**
+	 * \return false if the input can't be parsed or the output written, the reason is printed
+	 */
+	static bool compile(const std::string& input, const std::string& output);
+
+	/**
+	 * \param error Set to the reason when false is returned
+	 */
+	static bool parse(const JsonValue& document, SceneDescription& scene, std::string& error);
+};
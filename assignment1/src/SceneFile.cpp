@@ -0,0 +1,249 @@
+#include "SceneFile.h"
+#include "BinaryFile.h"
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <chrono>
+#include <random>
+
+bool SceneFile::open(const std::string& path)
+{
+	close();
+	file = std::make_unique<MappedFile>(path, true);
+	const size_t size = file->getSize();
+	const SceneFileHeader* mapped = (const SceneFileHeader*)file->getData();
+
+	bool valid = file->isOpen() && size >= sizeof(SceneFileHeader)
+		&& mapped->magic == SceneFileHeader::Magic && mapped->version == SceneFileHeader::Version;
+	if (valid) {
+		const uint64_t objects = mapped->objectCount;
+		valid = BinaryFile::fits(mapped->meshOffset, mapped->meshCount * sizeof(SceneMesh), size)
+			&& BinaryFile::fits(mapped->stringOffset, mapped->stringSize, size)
+			&& BinaryFile::fits(mapped->colorOffset, objects * sizeof(glm::vec4), size)
+			&& BinaryFile::fits(mapped->pointLightOffset, mapped->pointLightCount * sizeof(PointLightData), size);
+		for (int axis = 0; axis < 3 && valid; axis++)
+			valid = BinaryFile::fits(mapped->positionOffset[axis], objects * sizeof(float), size)
+				&& BinaryFile::fits(mapped->scaleOffset[axis], objects * sizeof(float), size);
+		for (int component = 0; component < 4 && valid; component++)
+			valid = BinaryFile::fits(mapped->rotationOffset[component], objects * sizeof(float), size);
+
+		// The names and the object ranges are read without checks afterwards
+		const char* strings = (const char*)file->getData() + mapped->stringOffset;
+		valid = valid && (mapped->meshCount == 0 || (mapped->stringSize > 0 && strings[mapped->stringSize - 1] == '\0'));
+		const SceneMesh* meshes = (const SceneMesh*)((const char*)file->getData() + mapped->meshOffset);
+		for (uint32_t i = 0; i < mapped->meshCount && valid; i++) {
+			valid = meshes[i].nameOffset < mapped->stringSize
+				&& meshes[i].firstObject <= mapped->objectCount && meshes[i].objectCount <= mapped->objectCount - meshes[i].firstObject;
+		}
+	}
+
+	if (!valid) {
+		std::cout << "Failed to load scene " << path << ", not a scene file (see --compile-scene)" << std::endl;
+		file.reset();
+		return false;
+	}
+
+	header = mapped;
+	return true;
+}
+
+void SceneFile::close()
+{
+	header = nullptr;
+	file.reset();
+	patches.clear();
+	patchIndices.clear();
+}
+
+Light SceneFile::getLight() const
+{
+	Light light;
+	light.position = header->lightPosition;
+	light.color = header->lightColor;
+	light.ambientStrength = header->ambientStrength;
+	return light;
+}
+
+TransformColumns SceneFile::getTransforms(const SceneMesh& mesh) const
+{
+	TransformColumns columns;
+	for (int axis = 0; axis < 3; axis++) {
+		columns.position[axis] = at<float>(header->positionOffset[axis]) + mesh.firstObject;
+		columns.scale[axis] = at<float>(header->scaleOffset[axis]) + mesh.firstObject;
+	}
+	for (int component = 0; component < 4; component++)
+		columns.rotation[component] = at<float>(header->rotationOffset[component]) + mesh.firstObject;
+	columns.count = mesh.objectCount;
+	return columns;
+}
+
+Transform SceneFile::getTransform(uint32_t object) const
+{
+	Transform transform;
+	for (int axis = 0; axis < 3; axis++) {
+		transform.position[axis] = at<float>(header->positionOffset[axis])[object];
+		transform.scale[axis] = at<float>(header->scaleOffset[axis])[object];
+	}
+	transform.rotation = glm::quat(at<float>(header->rotationOffset[3])[object], at<float>(header->rotationOffset[0])[object],
+		at<float>(header->rotationOffset[1])[object], at<float>(header->rotationOffset[2])[object]);
+	return transform;
+}
+
+uint32_t SceneFile::findMesh(uint32_t object) const
+{
+	for (uint32_t i = 0; i < header->meshCount; i++) {
+		const SceneMesh& mesh = getMesh(i);
+		if (object >= mesh.firstObject && object - mesh.firstObject < mesh.objectCount)
+			return i;
+	}
+	return header->meshCount;
+}
+
+void SceneFile::setTransform(uint32_t object, const Transform& transform)
+{
+	const float rotation[4] = { transform.rotation.x, transform.rotation.y, transform.rotation.z, transform.rotation.w };
+	for (int axis = 0; axis < 3; axis++) {
+		edit(header->positionOffset[axis] + object * sizeof(float), &transform.position[axis], sizeof(float));
+		edit(header->scaleOffset[axis] + object * sizeof(float), &transform.scale[axis], sizeof(float));
+	}
+	for (int component = 0; component < 4; component++)
+		edit(header->rotationOffset[component] + object * sizeof(float), &rotation[component], sizeof(float));
+}
+
+void SceneFile::setColor(uint32_t object, const glm::vec4& color)
+{
+	edit(header->colorOffset + object * sizeof(glm::vec4), &color, sizeof(glm::vec4));
+}
+
+void SceneFile::setLight(const Light& light)
+{
+	edit(offsetof(SceneFileHeader, lightColor), &light.color, sizeof(glm::vec4));
+	edit(offsetof(SceneFileHeader, lightPosition), &light.position, sizeof(glm::vec3));
+	edit(offsetof(SceneFileHeader, ambientStrength), &light.ambientStrength, sizeof(float));
+}
+
+void SceneFile::takePatches(std::vector<ScenePatch>& patches)
+{
+	patches.clear();
+	std::swap(patches, this->patches);
+	patchIndices.clear();
+}
+
+bool SceneFile::apply(const ScenePatch& patch)
+{
+	const size_t size = file->getSize();
+	if (patch.size > ScenePatch::MaxSize || patch.offset > size || patch.size > size - patch.offset)
+		return false;
+
+	// The light in the header or the sections after the names, the layout itself is never patched
+	const bool light = patch.offset >= offsetof(SceneFileHeader, lightColor) && patch.offset + patch.size <= offsetof(SceneFileHeader, saveId);
+	if (!light && patch.offset < header->positionOffset[0])
+		return false;
+
+	std::memcpy((char*)file->getWritableData() + patch.offset, patch.data, patch.size);
+	return true;
+}
+
+void SceneFile::edit(uint64_t offset, const void* data, uint32_t size)
+{
+	// The UI sets every value of what it shows, unchanged ones make no patch
+	char* mapped = (char*)file->getWritableData() + offset;
+	if (std::memcmp(mapped, data, size) == 0)
+		return;
+	std::memcpy(mapped, data, size);
+
+	auto found = patchIndices.find(offset);
+	if (found == patchIndices.end()) {
+		found = patchIndices.emplace(offset, (uint32_t)patches.size()).first;
+		patches.push_back({ offset, size, 0 });
+	}
+	ScenePatch& patch = patches[found->second];
+	patch.size = size;
+	std::memcpy(patch.data, data, size);
+}
+
+bool SceneFile::write(const std::string& path, const SceneDescription& scene)
+{
+	if (scene.objects.size() > UINT32_MAX) {
+		std::cout << "Failed to write " << path << ", " << scene.objects.size() << " objects, a scene file holds at most 2^32 - 1" << std::endl;
+		return false;
+	}
+	const uint32_t objectCount = (uint32_t)scene.objects.size();
+	const uint32_t meshCount = (uint32_t)scene.meshes.size();
+
+	// Counting sort of the objects by mesh
+	std::vector<SceneMesh> meshes(meshCount, SceneMesh{});
+	for (const SceneObject& object : scene.objects) {
+		if (object.mesh >= meshCount) {
+			std::cout << "Failed to write " << path << ", an object uses mesh " << object.mesh << " of " << meshCount << std::endl;
+			return false;
+		}
+		meshes[object.mesh].objectCount++;
+	}
+
+	std::string strings;
+	for (uint32_t i = 0, first = 0; i < meshCount; i++) {
+		meshes[i].firstObject = first;
+		meshes[i].nameOffset = (uint32_t)strings.size();
+		first += meshes[i].objectCount;
+		strings += scene.meshes[i];
+		strings += '\0';
+	}
+
+	SceneFileHeader header = {};
+	header.magic = SceneFileHeader::Magic;
+	header.version = SceneFileHeader::Version;
+	header.meshCount = meshCount;
+	header.objectCount = objectCount;
+	header.pointLightCount = (uint32_t)scene.pointLights.size();
+	header.stringSize = (uint32_t)strings.size();
+	header.lightColor = scene.light.color;
+	header.lightPosition = scene.light.position;
+	header.ambientStrength = scene.light.ambientStrength;
+	header.saveId = ((uint64_t)std::random_device()() << 32) ^ (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+
+	size_t offset = BinaryFile::align(sizeof(header));
+	auto section = [&offset](size_t bytes) {
+		const size_t start = offset;
+		offset = BinaryFile::align(offset + bytes);
+		return start;
+	};
+	header.meshOffset = section(meshCount * sizeof(SceneMesh));
+	header.stringOffset = section(strings.size());
+	for (int axis = 0; axis < 3; axis++)
+		header.positionOffset[axis] = section(objectCount * sizeof(float));
+	for (int component = 0; component < 4; component++)
+		header.rotationOffset[component] = section(objectCount * sizeof(float));
+	for (int axis = 0; axis < 3; axis++)
+		header.scaleOffset[axis] = section(objectCount * sizeof(float));
+	header.colorOffset = section(objectCount * sizeof(glm::vec4));
+	header.pointLightOffset = section(scene.pointLights.size() * sizeof(PointLightData));
+
+	// Assembled in memory, one write
+	std::vector<char> bytes(offset, 0);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + header.meshOffset, meshes.data(), meshCount * sizeof(SceneMesh));
+	std::memcpy(bytes.data() + header.stringOffset, strings.data(), strings.size());
+	if (!scene.pointLights.empty())
+		std::memcpy(bytes.data() + header.pointLightOffset, scene.pointLights.data(), scene.pointLights.size() * sizeof(PointLightData));
+
+	auto column = [&bytes](uint64_t offset) { return (float*)(bytes.data() + offset); };
+	glm::vec4* colors = (glm::vec4*)(bytes.data() + header.colorOffset);
+	std::vector<uint32_t> next(meshCount);
+	for (uint32_t i = 0; i < meshCount; i++)
+		next[i] = meshes[i].firstObject;
+
+	for (const SceneObject& object : scene.objects) {
+		const uint32_t slot = next[object.mesh]++;
+		const float rotation[4] = { object.rotation.x, object.rotation.y, object.rotation.z, object.rotation.w };
+		for (int axis = 0; axis < 3; axis++) {
+			column(header.positionOffset[axis])[slot] = object.position[axis];
+			column(header.scaleOffset[axis])[slot] = object.scale[axis];
+		}
+		for (int component = 0; component < 4; component++)
+			column(header.rotationOffset[component])[slot] = rotation[component];
+		colors[slot] = object.color;
+	}
+
+	return BinaryFile::write(path, bytes.data(), bytes.size());
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Light.h"
+#include "MappedFile.h"
+#include "TransformSoA.h"
+#include "Transform.h"
+
+/**
+ * \brief Start of a scene file. Every section is a flat array at a 16 byte aligned offset from the start of the file,
+ * nothing points into memory: the mapped file is used as is. Objects are sorted by mesh, the transforms and colours
+ * are one column per component so they go straight to the SIMD composition of the Renderer
+ */
+struct SceneFileHeader {
+	static constexpr uint32_t Magic = 0x454E4353;	// "SCNE"
+	static constexpr uint32_t Version = 2;
+
+	uint32_t magic;
+	uint32_t version;
+	uint32_t meshCount;
+	uint32_t objectCount;
+	uint32_t pointLightCount;
+	uint32_t stringSize;		// Bytes of the mesh names, each one null terminated
+	glm::vec4 lightColor;		// The sun (Light)
+	glm::vec3 lightPosition;
+	float ambientStrength;
+	uint64_t saveId;			// New at every write, the journal of another write is ignored (see SceneJournal)
+
+	// Byte offsets from the start of the file
+	uint64_t meshOffset;		// SceneMesh[meshCount]
+	uint64_t stringOffset;
+	uint64_t positionOffset[3];	// float[objectCount] each
+	uint64_t rotationOffset[4];	// Quaternion x, y, z, w
+	uint64_t scaleOffset[3];
+	uint64_t colorOffset;		// glm::vec4[objectCount]
+	uint64_t pointLightOffset;	// PointLightData[pointLightCount]
+};
+
+// Objects firstObject to firstObject + objectCount all use the mesh
+struct SceneMesh {
+	uint32_t nameOffset;		// In the string section: "cube", "olaf" or the path of a cooked mesh
+	uint32_t firstObject;
+	uint32_t objectCount;
+	uint32_t padding;
+};
+
+// Bytes an edit wrote at an offset of the file, the records of the SceneJournal
+struct ScenePatch {
+	static constexpr uint32_t MaxSize = 32;		// A PointLightData
+
+	uint64_t offset;
+	uint32_t size;
+	uint32_t checksum;			// Set by the journal, a torn record does not match
+	uint8_t data[MaxSize];
+};
+
+// Editable form of a scene, written by SceneFile::write
+struct SceneObject {
+	uint32_t mesh;				// Index in SceneDescription::meshes
+	glm::vec3 position = glm::vec3(0);
+	glm::quat rotation = glm::quat(1, 0, 0, 0);
+	glm::vec3 scale = glm::vec3(1);
+	glm::vec4 color = glm::vec4(1);
+};
+
+struct SceneDescription {
+	Light light;
+	std::vector<std::string> meshes;
+	std::vector<SceneObject> objects;
+	std::vector<PointLightData> pointLights;
+};
+
+/**
+ * \brief View of a mapped scene file, opening it only checks the header and the section bounds.
+ * The mapping is copy-on-write: edits change the drawn scene and are kept as patches for the journal, the file is untouched
+ */
+class SceneFile
+{
+public:
+	/**
+	 * \return false if the file is missing or not a scene of this version, the reason is printed
+	 */
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return header != nullptr; }
+
+	const SceneFileHeader& getHeader() const { return *header; }
+	Light getLight() const;
+
+	uint32_t getMeshCount() const { return header->meshCount; }
+	const SceneMesh& getMesh(uint32_t index) const { return at<SceneMesh>(header->meshOffset)[index]; }
+	const char* getMeshName(const SceneMesh& mesh) const { return at<char>(header->stringOffset) + mesh.nameOffset; }
+
+	/**
+	 * \return The transforms of the objects of the mesh, in the mapped file
+	 */
+	TransformColumns getTransforms(const SceneMesh& mesh) const;
+	const glm::vec4* getColors(const SceneMesh& mesh) const { return at<glm::vec4>(header->colorOffset) + mesh.firstObject; }
+
+	const PointLightData* getPointLights() const { return at<PointLightData>(header->pointLightOffset); }
+
+	Transform getTransform(uint32_t object) const;
+	const glm::vec4& getColor(uint32_t object) const { return at<glm::vec4>(header->colorOffset)[object]; }
+
+	/**
+	 * \return Index of the mesh drawing the object
+	 */
+	uint32_t findMesh(uint32_t object) const;
+
+	/**
+	 * \brief Only the bytes of the values that changed become patches, editing them again before takePatches
+	 * replaces the pending patch
+	 */
+	void setTransform(uint32_t object, const Transform& transform);
+	void setColor(uint32_t object, const glm::vec4& color);
+	void setLight(const Light& light);
+
+	/**
+	 * \brief Moves the patches of the edits since the last call to patches
+	 */
+	void takePatches(std::vector<ScenePatch>& patches);
+	bool hasPatches() const { return !patches.empty(); }
+
+	/**
+	 * \brief Writes a patch of the journal into the mapping without keeping it
+	 * \return false if it writes outside of the light, the transforms, the colours and the point lights
+	 */
+	bool apply(const ScenePatch& patch);
+
+	/**
+	 * \brief Sorts the objects by mesh (stable) and writes the sections, the file is on disk when it returns
+	 */
+	static bool write(const std::string& path, const SceneDescription& scene);
+
+private:
+	template<typename T>
+	const T* at(uint64_t offset) const { return (const T*)((const char*)file->getData() + offset); }
+
+	void edit(uint64_t offset, const void* data, uint32_t size);
+
+	std::unique_ptr<MappedFile> file;
+	const SceneFileHeader* header = nullptr;
+	std::vector<ScenePatch> patches;
+	std::unordered_map<uint64_t, uint32_t> patchIndices;	// Offset to index in patches
+};
@@ -0,0 +1,217 @@
+#include "SceneJournal.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+	// FNV-1a of the record, its checksum counted as 0
+	uint32_t checksum(ScenePatch patch)
+	{
+		patch.checksum = 0;
+		const uint8_t* bytes = (const uint8_t*)&patch;
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < sizeof(patch); i++)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	}
+
+	float elapsedMs(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+SceneJournal::~SceneJournal()
+{
+	close();
+}
+
+bool SceneJournal::open(const std::string& scenePath, SceneFile& scene)
+{
+	close();
+	this->scenePath = scenePath;
+	journalPath = scenePath + ".journal";
+	saveId = scene.getHeader().saveId;
+	journaled.clear();
+	stats = Stats();
+
+	// Crash recovery: the records a run left are written into the mapping
+	std::ifstream in(journalPath, std::ios::binary);
+	SceneJournalHeader header;
+	bool recovered = false;
+	if (in.read((char*)&header, sizeof(header))) {
+		if (header.magic != SceneJournalHeader::Magic || header.version != SceneJournalHeader::Version || header.saveId != saveId) {
+			std::cout << "Discarded journal " << journalPath << ", it patches another write of the scene" << std::endl;
+		} else {
+			recovered = true;
+			ScenePatch patch;
+			while (in.read((char*)&patch, sizeof(patch))) {
+				if (patch.checksum != checksum(patch) || !scene.apply(patch)) {
+					std::cout << "Journal " << journalPath << " is torn after " << journaled.size() << " records, the rest is dropped" << std::endl;
+					break;
+				}
+				journaled.push_back(patch);
+			}
+		}
+	}
+	in.close();
+
+	if (recovered) {
+		// Cut after the last good record, which never leaves the disk: appends go after it
+		std::error_code error;
+		std::filesystem::resize_file(journalPath, sizeof(header) + journaled.size() * sizeof(ScenePatch), error);
+		journal.clear();
+		journal.open(journalPath, std::ios::binary | std::ios::app);
+		if (error || !journal) {
+			std::cout << "Failed to reopen " << journalPath << std::endl;
+			return false;
+		}
+	} else if (!reset()) {
+		return false;
+	}
+	stats.replayed = stats.records = (uint32_t)journaled.size();
+
+	running = true;
+	compactionRequested = journaled.size() >= CompactionRecords;
+	thread = std::thread(&SceneJournal::threadLoop, this);
+	return true;
+}
+
+void SceneJournal::close()
+{
+	if (!isOpen())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	condition.notify_all();
+	thread.join();
+	journal.close();
+
+	// Compacted: the scene file has everything
+	if (journaled.empty())
+		std::remove(journalPath.c_str());
+}
+
+void SceneJournal::append(std::vector<ScenePatch>& patches)
+{
+	if (isOpen() && !patches.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queued.insert(queued.end(), patches.begin(), patches.end());
+		}
+		condition.notify_all();
+	}
+	patches.clear();
+}
+
+void SceneJournal::requestCompaction()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		compactionRequested = true;
+	}
+	condition.notify_all();
+}
+
+SceneJournal::Stats SceneJournal::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void SceneJournal::threadLoop()
+{
+	while (true) {
+		bool compacting;
+		bool stopping;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return !queued.empty() || compactionRequested || !running; });
+			std::swap(queued, writing);
+			stopping = !running;
+			compacting = compactionRequested || stopping;
+			compactionRequested = false;
+		}
+
+		if (!writing.empty()) {
+			write(writing);
+			writing.clear();
+		}
+		if (compacting || journaled.size() >= CompactionRecords)
+			compact();
+		if (stopping)
+			break;
+	}
+}
+
+void SceneJournal::write(const std::vector<ScenePatch>& patches)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	const size_t first = journaled.size();
+	for (ScenePatch patch : patches) {
+		patch.checksum = checksum(patch);
+		journaled.push_back(patch);
+	}
+
+	// Flushed to the OS at every append, a crash of the process loses nothing
+	journal.write((const char*)(journaled.data() + first), (std::streamsize)(patches.size() * sizeof(ScenePatch)));
+	journal.flush();
+	if (!journal)
+		std::cout << "Failed to append to " << journalPath << std::endl;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.records = (uint32_t)journaled.size();
+	stats.appends++;
+	stats.appendMs = elapsedMs(start);
+}
+
+void SceneJournal::compact()
+{
+	if (journaled.empty())
+		return;
+
+	// In place, the layout of the scene never changes. The mapping of the scene is copy-on-write and
+	// every patched value was already written to it, so it keeps its own copy of those pages
+	const auto start = std::chrono::high_resolution_clock::now();
+	std::fstream scene(scenePath, std::ios::in | std::ios::out | std::ios::binary);
+	for (const ScenePatch& patch : journaled) {
+		scene.seekp((std::streamoff)patch.offset);
+		scene.write((const char*)patch.data, patch.size);
+	}
+	scene.flush();
+	if (!scene) {
+		std::cout << "Failed to compact " << journalPath << " into " << scenePath << ", the journal is kept" << std::endl;
+		return;
+	}
+	scene.close();
+
+	// Only emptied once the scene has every record
+	if (!reset())
+		return;
+	journaled.clear();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.records = 0;
+	stats.compactions++;
+	stats.compactionMs = elapsedMs(start);
+}
+
+bool SceneJournal::reset()
+{
+	journal.close();
+	journal.clear();
+	journal.open(journalPath, std::ios::binary | std::ios::trunc);
+
+	const SceneJournalHeader header = { SceneJournalHeader::Magic, SceneJournalHeader::Version, saveId };
+	journal.write((const char*)&header, sizeof(header));
+	journal.flush();
+	if (!journal) {
+		std::cout << "Failed to write " << journalPath << std::endl;
+		return false;
+	}
+	return true;
+}
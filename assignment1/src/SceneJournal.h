@@ -0,0 +1,87 @@
+#pragma once
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SceneFile.h"
+
+// Start of a journal file, followed by ScenePatch records
+struct SceneJournalHeader {
+	static constexpr uint32_t Magic = 0x4C4E524A;	// "JRNL"
+	static constexpr uint32_t Version = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t saveId;			// SceneFileHeader::saveId of the scene it patches
+};
+
+/**
+ * \brief Append-only journal of the edits of a scene file, next to it (path + ".journal"). A save appends the patches of
+ * the values that changed, compaction writes the journaled patches in place into the scene file then empties the journal.
+ * Both run on the journal thread, the frame only hands the patches over.
+ * Patches hold whole values, replaying one twice is harmless: a crash during a compaction loses nothing
+ */
+class SceneJournal
+{
+public:
+	static constexpr uint32_t CompactionRecords = 4096;	// Journal length that starts a compaction
+
+	struct Stats {
+		uint32_t replayed = 0;		// Records left by the last run (it did not close the journal)
+		uint32_t records = 0;		// Records in the journal file
+		uint32_t appends = 0;
+		uint32_t compactions = 0;
+		float appendMs = 0.0f;		// Last append, on the journal thread
+		float compactionMs = 0.0f;	// Last compaction, on the journal thread
+	};
+
+	~SceneJournal();
+
+	/**
+	 * \brief Replays the journal of the scene into its mapping (crash recovery), then starts the journal thread.
+	 * The records after a torn one are dropped, the journal of another write of the scene is discarded
+	 */
+	bool open(const std::string& scenePath, SceneFile& scene);
+
+	/**
+	 * \brief Appends what is queued, compacts and stops the journal thread
+	 */
+	void close();
+	bool isOpen() const { return thread.joinable(); }
+
+	/**
+	 * \brief Queues the patches for the journal thread and returns at once, patches is left empty
+	 */
+	void append(std::vector<ScenePatch>& patches);
+
+	void requestCompaction();
+
+	Stats getStats() const;
+
+private:
+	void threadLoop();
+
+	// Journal thread
+	void write(const std::vector<ScenePatch>& patches);
+	void compact();
+	bool reset();		// Empties the journal file, only the header is left
+
+	std::string scenePath;
+	std::string journalPath;
+	uint64_t saveId = 0;
+
+	// Owned by the journal thread once it runs
+	std::ofstream journal;
+	std::vector<ScenePatch> journaled;		// Records of the journal file, in order
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<ScenePatch> queued;
+	std::vector<ScenePatch> writing;		// Swapped with queued by the journal thread
+	bool compactionRequested = false;
+	bool running = false;
+	Stats stats;
+};
@@ -2,9 +2,17 @@
 #include <assert.h>
 #include "Renderer.h"
 #include <iostream>
+#include <algorithm>
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
+#include "Picking.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "Components.h"
+#include "Systems.h"
+#include "BinaryFile.h"
+#include <numeric>
 
 static void handleErrors(GLenum source, GLenum type, GLuint id,
 						 GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
@@ -42,13 +50,21 @@ SceneManager::SceneManager(uint32_t width, uint32_t height)
 
 	glfwSetWindowUserPointer(window, data);
 
+	// Per frame CPU work is spread over every core, GL calls stay on this thread
+	JobSystem::init();
+
 	// Default renderer settings
 	shader = new Shader("shaders/shader.glsl");
 
 	Renderer::init();
+	Olaf::bakeMesh();
 	Renderer::setCamera(&camera);
 	Renderer::setDefaultShader(shader);
 	Renderer::setLight(&light);
+
+	// The light is edited as a component, copied to the Renderer light every frame
+	lightEntity = registry.create();
+	registry.add<Light>(lightEntity, light);
 }
 
 SceneManager::~SceneManager()
@@ -64,27 +80,134 @@ void SceneManager::run()
 	glEnable(GL_PROGRAM_POINT_SIZE);
 	glDebugMessageCallback(handleErrors, 0);
 
+	// Never try to catch up more than this, otherwise a slow frame makes the next one even slower
+	constexpr float maxFrameTime = 0.25f;
+
+	// The render thread takes the context, no GL call is made on this thread until it stops
+	if (renderThreadEnabled) {
+		pacer.applySwapInterval();			// Detects the adaptive vsync support while the context is current
+		ImGui_ImplOpenGL3_NewFrame();		// Creates the ImGui font texture and shaders
+		glfwMakeContextCurrent(nullptr);
+		renderThread.start(window);
+	}
+
 	float lastFrameTime = glfwGetTime();
 	while (!glfwWindowShouldClose(window)) {
 		const float dt = glfwGetTime() - lastFrameTime;
 		lastFrameTime += dt;
+		dispatchInputEvents();
+		if (!renderThread.isRunning())
+			pacer.applySwapInterval();
+
+		// Simulate in fixed steps, the rendering interpolates between the last two
+		const float tickDt = 1.0f / tickRate;
+		accumulator += glm::min(dt, maxFrameTime);
+		ticksLastFrame = 0;
+		while (accumulator >= tickDt) {
+			onFixedUpdate(tickDt);
+			accumulator -= tickDt;
+			ticksLastFrame++;
+		}
+		interpolationAlpha = accumulator / tickDt;
+		camera.interpolate(interpolationAlpha);
+		Systems::lights(registry, light);
+		updateSceneJournal(dt);
+
+		// Render on demand: the scene is only redrawn when something it depends on changed,
+		// the UI only while there is input to process
+		const bool onDemand = pacer.getMode() == FramePacer::Mode::OnDemand;
+		if (!onDemand)
+			renderedState.valid = false;	// The scene framebuffer is not kept up to date
+		const bool drawScene = !onDemand || isSceneDirty();
+		if (inputEvents != handledInputEvents) {
+			handledInputEvents = inputEvents;
+			uiFrames = uiSettleFrames;
+		}
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (onDemand && !drawScene && uiFrames == 0) {
+			// The window still shows the last frame, sleep until an event (or the timeout, to keep ticking)
+			idleStats.idleWaits++;
+			glfwWaitEventsTimeout(idleTimeout);
+			continue;
+		}
 
-		// Draw x, y grid and skybox
-		
-		Renderer::drawGrid();
-		onUpdate(dt);
-		
-		// skybox cube
-		Renderer::drawSkyBox();
+		// Record the frame, the GL work happens in Renderer::renderFrame
+		Renderer::beginFrame(drawScene, onDemand);
+		if (drawScene) {
+			// Draw x, y grid and skybox
+			Renderer::beginScene();
+			Renderer::drawGrid();
+			onUpdate(dt);
+			Renderer::endScene();
+
+			// skybox cube
+			Renderer::drawSkyBox();
+			idleStats.sceneFrames++;
+		} else {
+			idleStats.presentedFrames++;
+		}
+
+		if (onDemand)
+			renderedState = captureState();
 
-		// Draw UI on top of everything
-		onUI();
+		if (renderThread.isRunning()) {
+			// The render thread draws this frame while the next one is recorded
+			onUI();
+			renderThread.submit(ImGui::GetDrawData(), pacer.getSwapInterval());
+		} else {
+			Renderer::renderFrame(Renderer::getRecordIndex());
+			Renderer::publishStats();
 
-		glfwSwapBuffers(window);
+			// Draw UI on top of everything
+			onUI();
+			glfwSwapBuffers(window);
+		}
+		uiFrames = glm::max(uiFrames - 1, 0);
+
+		updateLightBenchmark();
+		pacer.recordFrame(dt);
+		pacer.waitForNextFrame();
 		glfwPollEvents();
 	}
+
+	renderThread.stop();
+}
+
+SceneManager::RenderedState SceneManager::captureState() const
+{
+	RenderedState state;
+	state.cameraVersion = camera.getVersion();
+	state.light = light;
+	state.gridSize = Renderer::GridSize;
+	state.crowdSize = crowdSize;
+	state.prefabCount = (int)prefabs.size();
+	state.pointLightCount = (int)pointLights.size();
+	state.selected = selected;
+	state.renderingMode = Renderer::getRenderingMode();
+	state.valid = true;
+
+	state.objectsMoving = objectsMoving || !prefabs.empty();	// The prefabs always spin
+	return state;
+}
+
+bool SceneManager::isSceneDirty()
+{
+	const RenderedState current = captureState();
+	const RenderedState& last = renderedState;
+
+	// Objects moving on the last drawn frame need one more frame to reach their final interpolated transform
+	const bool dirty = sceneDirty || !last.valid || current.objectsMoving || last.objectsMoving
+		|| current.cameraVersion != last.cameraVersion
+		|| current.light.position != last.light.position || current.light.color != last.light.color
+		|| current.light.ambientStrength != last.light.ambientStrength
+		|| current.gridSize != last.gridSize || current.crowdSize != last.crowdSize
+		|| current.prefabCount != last.prefabCount || current.pointLightCount != last.pointLightCount
+		|| lightBenchmark.step >= 0
+		|| current.selected != last.selected || current.renderingMode != last.renderingMode
+		|| pickRequested;
+
+	sceneDirty = false;
+	return dirty;
 }
 
 void SceneManager::onCreate()
@@ -93,37 +216,11 @@ void SceneManager::onCreate()
 	camera.setPosition({ -3, 4, 10 });
 	olaf.onCreate(*this);
 
-	constexpr float camSpeed = 0.08f;
-	constexpr float camRotSpeed = 5.0f; // Degress
-
-	addKeyEvent(GLFW_KEY_UP, [=](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		auto& camera = scene.getCamera();
-		auto camRot = camera.getRotation();
-		camRot.x += camRotSpeed;
-		camera.setRotation(camRot);
-	});
-
-	addKeyEvent(GLFW_KEY_DOWN, [=](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		auto& camera = scene.getCamera();
-		auto camRot = camera.getRotation();
-		camRot.x -= camRotSpeed;
-		camera.setRotation(camRot);;
-		});
-
-	// Camera rotation
-	addKeyEvent(GLFW_KEY_RIGHT, [=](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		auto& camera = scene.getCamera();
-		auto camRot = camera.getRotation();
-		camRot.y += camRotSpeed;
-		camera.setRotation(camRot);
-		});
-
-	addKeyEvent(GLFW_KEY_LEFT, [=](SceneManager& scene, WindowUserData& data, KeyAction action) {
-		auto& camera = scene.getCamera();
-		auto camRot = camera.getRotation();
-		camRot.y -= camRotSpeed;
-		camera.setRotation(camRot);
-		});
+	// Camera rotation, sampled every tick in onFixedUpdate
+	inputActions.bind(InputActions::CameraPitchUp, KeyCode::UP);
+	inputActions.bind(InputActions::CameraPitchDown, KeyCode::DOWN);
+	inputActions.bind(InputActions::CameraYawRight, KeyCode::RIGHT);
+	inputActions.bind(InputActions::CameraYawLeft, KeyCode::LEFT);
 
 	addKeyEvent(GLFW_KEY_HOME, [=](SceneManager& scene, WindowUserData& data, KeyAction action) {
 		auto& camera = scene.getCamera();
@@ -154,7 +251,8 @@ void SceneManager::onCreate()
 		ImGuiIO& io = ImGui::GetIO(); (void)io;
 		io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
 		//io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
-		io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;         // Enable Multi-Viewport / Platform Windows
+		if (!renderThreadEnabled)
+			io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;     // Enable Multi-Viewport / Platform Windows (they need the context on this thread)
 
 		ImGui::StyleColorsDark();
 		ImGuiStyle& style = ImGui::GetStyle();
@@ -171,11 +269,307 @@ void SceneManager::onCreate()
 	}
 }
 
+void SceneManager::onFixedUpdate(float dt)
+{
+	SHADO_PROFILE_FUNCTION();
+
+	// Key state, once per tick. Typing in the UI does not move anything
+	const bool uiKeyboard = ImGui::GetCurrentContext() && ImGui::GetIO().WantCaptureKeyboard;
+	inputActions.sample(*this, !uiKeyboard);
+
+	constexpr float cameraTurnSpeed = 150.0f;	// Degrees per second
+	const glm::vec2 cameraTurn = {
+		inputActions.axis(InputActions::CameraPitchDown, InputActions::CameraPitchUp),
+		inputActions.axis(InputActions::CameraYawLeft, InputActions::CameraYawRight)
+	};
+	camera.onFixedUpdate();
+	if (cameraTurn != glm::vec2(0.0f))
+		camera.rotate(cameraTurn.x * cameraTurnSpeed * dt, cameraTurn.y * cameraTurnSpeed * dt);
+
+	camera.onUpdate(dt);
+	JobSystem::parallelFor(getObjectCount(), 1024, [this, dt](uint32_t begin, uint32_t end) {
+		for (uint32_t id = begin; id < end; id++)
+			getObject(id).onFixedUpdate(dt);
+	});
+	objectsMoving = false;		// Every Olaf caught up with its state
+	Systems::movement(registry, dt);
+
+	olaf.onInput(inputActions, dt);
+	if (olaf.isMoving())
+		markMoved(0);
+}
+
+void SceneManager::markMoved(uint32_t id)
+{
+	objectsMoving = true;
+	sceneDirty = true;
+	if (id < indexedStates.size() && !indexedStates[id].moved) {
+		indexedStates[id].moved = true;
+		movedObjects.push_back(id);
+	}
+}
+
 void SceneManager::onUpdate(float dt)
 {
+	SHADO_PROFILE_FUNCTION();
+
 	lastDt = dt;
-	camera.onUpdate(dt);
-	olaf.onUpdate(dt);
+	updateSpatialIndex();
+
+	if (pickRequested) {
+		pick(getMousePos());
+		pickRequested = false;
+	}
+
+	// Only the Olafs in the view frustum are updated and drawn. The parts are computed in parallel,
+	// then queued in order (the Renderer queue is not thread safe)
+	visibleObjects.clear();
+	spatialIndex.queryFrustum(camera.getFrustum(), visibleObjects);
+
+	// Level of detail from the size of the bounds on screen: the baked mesh, or a single box
+	objectLods.resize(getObjectCount(), 0);
+	JobSystem::parallelFor((uint32_t)visibleObjects.size(), 256, [this](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const AABB& bounds = spatialIndex.getBounds(visibleObjects[i]);
+			const float distance = glm::length(bounds.center() - camera.getPosition());
+			const float size = Lod::projectedSize(glm::length(bounds.extent()) * 2.0f, distance, camera.getProjection(), camera.getHeight());
+
+			uint8_t& lod = objectLods[visibleObjects[i]];
+			lod = Lod::isCoarse(size, olafLod, lod != 0);
+		}
+	});
+
+	// One instance per Olaf: the full ones first, then the boxes
+	olafLodStats = LodStats();
+	for (uint32_t object : visibleObjects)
+		olafLodStats.objects[objectLods[object]]++;
+
+	const uint32_t meshCount = olafLodStats.objects[0];
+	uint32_t next[2] = { 0, meshCount };
+	visibleSlots.resize(visibleObjects.size());
+	for (uint32_t i = 0; i < visibleObjects.size(); i++)
+		visibleSlots[i] = next[objectLods[visibleObjects[i]]]++;
+
+	visibleInstances.resize(visibleObjects.size());
+	JobSystem::parallelFor((uint32_t)visibleObjects.size(), 256, [this](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const Olaf& object = getObject(visibleObjects[i]);
+			if (objectLods[visibleObjects[i]]) {
+				const Olaf::Part proxy = object.computeProxy(interpolationAlpha);
+				visibleInstances[visibleSlots[i]] = { proxy.transform, proxy.color };
+			} else {
+				visibleInstances[visibleSlots[i]] = { object.computeMeshTransform(interpolationAlpha), glm::vec4(1.0f) };
+			}
+		}
+	});
+
+	olafLodStats.instances[0] = meshCount;
+	olafLodStats.instances[1] = (uint32_t)visibleObjects.size() - meshCount;
+	Renderer::submit(Olaf::getMesh(), visibleInstances.data(), meshCount);
+	Renderer::submit(Renderer::getCubeMesh(), visibleInstances.data() + meshCount, olafLodStats.instances[1]);
+
+	// Entities of the registry
+	updatePrefabs();
+	updatePointLights();
+	Systems::transforms(registry);
+	Systems::render(registry);
+	Systems::pointLights(registry);
+
+	// Scene file, the columns of the mapping go straight to the SIMD composition
+	if (sceneFile.isOpen()) {
+		for (uint32_t i = 0; i < sceneFile.getMeshCount(); i++) {
+			const SceneMesh& mesh = sceneFile.getMesh(i);
+			if (sceneMeshes[i] != InvalidMesh)
+				Renderer::submit(sceneMeshes[i], sceneFile.getTransforms(mesh), sceneFile.getColors(mesh));
+		}
+		Renderer::submitLights(sceneFile.getPointLights(), sceneFile.getHeader().pointLightCount);
+	}
+
+	// Outline the selection
+	if (selected < getObjectCount()) {
+		const AABB& bounds = spatialIndex.getBounds(selected);
+		Renderer::drawCube(bounds.center(), glm::vec3(0), bounds.extent() * 2.0f, { 0, 1, 1, 1 }, *shader, GL_LINES);
+	}
+}
+
+void SceneManager::pick(const glm::vec2& mouse)
+{
+	ScopedTimer timer("Picking");	// Always reported, the result is also shown in the Olaf settings
+
+	const Ray ray = Picking::screenRay(camera, mouse);
+	constexpr float maxDistance = 1000.0f;
+
+	// Broad phase: objects whose box is crossed by the ray
+	pickCandidates.clear();
+	spatialIndex.queryRay(ray, maxDistance, pickCandidates);
+
+	pickBoxes.resize(pickCandidates.size());
+	pickDistances.resize(pickCandidates.size());
+	for (uint32_t i = 0; i < pickCandidates.size(); i++)
+		pickBoxes[i] = spatialIndex.getBounds(pickCandidates[i]);
+	Picking::intersectAABBs(ray, pickBoxes.data(), (uint32_t)pickBoxes.size(), maxDistance, pickDistances.data());
+
+	// Narrow phase front to back, stop once the boxes start behind the closest part hit
+	pickOrder.resize(pickCandidates.size());
+	std::iota(pickOrder.begin(), pickOrder.end(), 0);
+	std::sort(pickOrder.begin(), pickOrder.end(), [this](uint32_t a, uint32_t b) { return pickDistances[a] < pickDistances[b]; });
+
+	PickResult result;
+	float closest = maxDistance;
+	for (uint32_t candidate : pickOrder) {
+		if (pickDistances[candidate] > closest)
+			break;
+
+		std::array<glm::mat4, Olaf::PART_COUNT> transforms;
+		const auto parts = getObject(pickCandidates[candidate]).computeParts();
+		for (int i = 0; i < Olaf::PART_COUNT; i++)
+			transforms[i] = parts[i].transform;
+
+		float distance;
+		const int part = Picking::intersectOBBs(ray, transforms.data(), Olaf::PART_COUNT, closest, distance);
+		if (part >= 0 && distance < closest) {
+			closest = distance;
+			result.object = (int)pickCandidates[candidate];
+			result.part = part;
+			result.distance = distance;
+		}
+	}
+
+	if (result.object >= 0)
+		selected = (uint32_t)result.object;
+
+	result.candidates = (uint32_t)pickCandidates.size();
+	result.timeMs = timer.elapsedMs();
+	lastPick = result;
+}
+
+void SceneManager::updateSpatialIndex()
+{
+	SHADO_PROFILE_FUNCTION();
+
+	if (indexedGridSize != Renderer::GridSize) {
+		spatialIndex.reset(Renderer::GridSize);
+		indexedGridSize = Renderer::GridSize;
+	}
+
+	// Grow or shrink the crowd
+	const uint32_t wanted = (uint32_t)std::max(crowdSize, 0);
+	while (crowd.size() > wanted) {
+		spatialIndex.remove(getObjectCount() - 1);
+		crowd.pop_back();
+		indexedStates.pop_back();
+	}
+	while (crowd.size() < wanted) {
+		crowd.emplace_back();
+		crowd.back().randomPosition();
+	}
+
+	// Marked ones are updated, new ones inserted. Ids of removed objects may still be queued
+	for (uint32_t id : movedObjects) {
+		if (id >= indexedStates.size())
+			continue;
+
+		const Olaf& object = getObject(id);
+		const IndexedState state = { object.getPosition(), object.getRotation(), object.getScale() };
+		IndexedState& indexed = indexedStates[id];
+		if (indexed.position != state.position || indexed.rotation != state.rotation || indexed.scale != state.scale)
+			spatialIndex.update(id, object.getBounds());
+		indexed = state;
+	}
+	movedObjects.clear();
+
+	for (uint32_t id = (uint32_t)indexedStates.size(); id < getObjectCount(); id++) {
+		const Olaf& object = getObject(id);
+		indexedStates.push_back({ object.getPosition(), object.getRotation(), object.getScale() });
+		spatialIndex.insert(id, object.getBounds());
+	}
+
+	spatialIndex.commit();
+}
+
+void SceneManager::updatePrefabs()
+{
+	const uint32_t wanted = (uint32_t)std::max(prefabCount, 0);
+	while (prefabs.size() > wanted) {
+		Systems::destroyHierarchy(registry, prefabs.back());
+		prefabs.pop_back();
+	}
+
+	const int half = Renderer::GridSize / 2;
+	while (prefabs.size() < wanted) {
+		const glm::vec3 position = { rand() % Renderer::GridSize - half, 0, rand() % Renderer::GridSize - half };
+		const Entity root = Olaf::createPrefab(registry, position, Transform::fromEuler({ 0, (float)(rand() % 360), 0 }));
+		registry.add<Velocity>(root, { glm::vec3(0), { 0, 30.0f + (float)(rand() % 60), 0 } });
+		prefabs.push_back(root);
+	}
+}
+
+void SceneManager::updatePointLights()
+{
+	const uint32_t wanted = (uint32_t)std::max(pointLightCount, 0);
+	while (pointLights.size() > wanted) {
+		registry.destroy(pointLights.back());
+		pointLights.pop_back();
+	}
+
+	const int half = Renderer::GridSize / 2;
+	while (pointLights.size() < wanted) {
+		const Entity entity = registry.create();
+		const glm::vec3 position = { rand() % Renderer::GridSize - half, 0.5f + (float)(rand() % 30) / 10.0f, rand() % Renderer::GridSize - half };
+		const glm::vec3 color = { (float)(rand() % 256) / 255.0f, (float)(rand() % 256) / 255.0f, (float)(rand() % 256) / 255.0f };
+		registry.add<Transform>(entity, { position });
+		registry.add<PointLight>(entity, { color, 4.0f, 4.0f });
+		pointLights.push_back(entity);
+	}
+}
+
+void SceneManager::updateLightBenchmark()
+{
+	static constexpr int lightCounts[] = { 1, 100, 1000, 10000 };
+	LightBenchmark& bench = lightBenchmark;
+	if (bench.step < 0)
+		return;
+
+	if (bench.frame >= LightBenchmark::warmupFrames) {
+		const RendererStats& stats = Renderer::getStats();
+		bench.clusterMs += stats.clusterMs;
+		bench.drawMs += stats.drawMs;
+		bench.lightingMs += stats.lightingMs;
+		bench.overflowClusters = std::max(bench.overflowClusters, stats.overflowClusters);
+	}
+
+	if (++bench.frame < LightBenchmark::warmupFrames + LightBenchmark::measuredFrames)
+		return;
+
+	const float frames = (float)LightBenchmark::measuredFrames;
+	bench.results.push_back({ pointLightCount, Renderer::getLightingPath(),
+		bench.clusterMs / frames, bench.drawMs / frames, bench.lightingMs / frames, bench.overflowClusters });
+	bench.frame = 0;
+	bench.clusterMs = bench.drawMs = bench.lightingMs = 0.0f;
+	bench.overflowClusters = 0;
+
+	// Both paths are measured on the same lights before moving to the next count
+	if (++bench.step < (int)(sizeof(lightCounts) / sizeof(lightCounts[0])) * 2) {
+		pointLightCount = lightCounts[bench.step / 2];
+		Renderer::setLightingPath(bench.step % 2 ? LightingPath::Deferred : LightingPath::Forward);
+	} else {
+		bench.step = -1;
+		pointLightCount = bench.savedLightCount;
+		Renderer::setLightingPath(bench.savedPath);
+	}
+}
+
+// Level of detail settings and what was drawn at every level, shared by the grid and the Olafs
+static bool editLod(const char* id, LodSettings& settings, const LodStats& stats, const char* const* levels, int levelCount)
+{
+	ImGui::PushID(id);
+	bool changed = ImGui::Checkbox("level of detail ", &settings.enabled);
+	changed |= ImGui::DragFloat("LOD threshold (pixels) ", &settings.threshold, 0.5f, 1.0f, 500.0f);
+	changed |= ImGui::SliderFloat("LOD hysteresis ", &settings.hysteresis, 0.0f, 0.9f);
+	for (int level = 0; level < levelCount; level++)
+		ImGui::Text("%s: %u drawn, %u instances", levels[level], stats.objects[level], stats.instances[level]);
+	ImGui::PopID();
+	return changed;
 }
 
 void SceneManager::onUI() {
@@ -205,12 +599,52 @@ void SceneManager::onUI() {
 	// Olaf settings
 	bool openOlaf = ImGui::TreeNodeEx((void*)typeid(Olaf).hash_code(), treeNodeFlags, "Olaf settings");
 	if (openOlaf) {
-		ImGui::DragFloat3("position (Shift + w,a,s,d) ", (float*)&olaf.position);
-		ImGui::DragFloat3("rotation (a, d): ", (float*)&olaf.rotation);
-		ImGui::DragFloat("scale: (u, j)", &olaf.scale);
+		if (selected >= getObjectCount())
+			selected = 0;
+		Olaf& edited = getObject(selected);
+
+		ImGui::Text("Editing Olaf #%u (click an Olaf to select it)", selected);
+		if (lastPick.object >= 0)
+			ImGui::Text("Last pick: part %d at %.2f, %u candidates, %.3f ms", lastPick.part, lastPick.distance, lastPick.candidates, lastPick.timeMs);
+		else
+			ImGui::Text("Last pick: nothing, %u candidates, %.3f ms", lastPick.candidates, lastPick.timeMs);
+
+		if (ImGui::DragFloat3("position (Shift + w,a,s,d) ", (float*)&edited.position))
+			markMoved(selected);
+		glm::vec3 rotation = Transform::toEuler(edited.rotation);
+		if (ImGui::DragFloat3("rotation (a, d): ", (float*)&rotation)) {
+			edited.rotation = Transform::fromEuler(rotation);
+			markMoved(selected);
+		}
+		if (ImGui::DragFloat("scale: (u, j)", &edited.scale))
+			markMoved(selected);
 		
-		if (ImGui::Button("random position"))
-			olaf.randomPosition();
+		if (ImGui::Button("random position")) {
+			edited.randomPosition();
+			markMoved(selected);
+		}
+
+		ImGui::DragInt("crowd size ", &crowdSize, 10.0f, 0, 1000000);
+
+		// Spatial index used to cull and query the Olafs
+		int indexType = (int)spatialIndex.getType();
+		ImGui::Text("Spatial index");
+		ImGui::SameLine();
+		if (ImGui::RadioButton("Loose grid", &indexType, (int)SpatialIndex::Type::Grid))
+			spatialIndex.setType(SpatialIndex::Type::Grid);
+		ImGui::SameLine();
+		if (ImGui::RadioButton("BVH", &indexType, (int)SpatialIndex::Type::BVH))
+			spatialIndex.setType(SpatialIndex::Type::BVH);
+
+		ImGui::Text("Visible Olafs: %u / %u", (uint32_t)visibleObjects.size(), getObjectCount());
+		static const char* const olafLevels[] = { "Baked mesh", "Single box" };
+		editLod("olaf", olafLod, olafLodStats, olafLevels, 2);
+
+		neighbours.clear();
+		spatialIndex.queryRadius(olaf.getPosition(), 10.0f, neighbours);
+		// The controllable Olaf finds itself, unless it is not indexed yet
+		const uint32_t others = (uint32_t)std::count_if(neighbours.begin(), neighbours.end(), [](uint32_t id) { return id != 0; });
+		ImGui::Text("Olafs within 10 units: %u", others);
 
 		ImGui::TreePop();
 	}
@@ -221,15 +655,57 @@ void SceneManager::onUI() {
 		if (ImGui::DragFloat3("position ", (float*)&camera.position))
 			camera.recalculateMatrix();
 
-		if (ImGui::DragFloat3("rotation (arrow keys)", (float*)&camera.rotation))
-			camera.recalculateMatrix();
+		glm::vec3 rotation = camera.getRotation();
+		if (ImGui::DragFloat3("rotation (arrow keys)", (float*)&rotation))
+			camera.setRotation(rotation);
 		ImGui::TreePop();
 	}
 
 	// Grid size
 	bool openGrid = ImGui::TreeNodeEx((void*)typeid(Renderer).hash_code(), treeNodeFlags, "Grid settings");
 	if (openGrid) {
-		ImGui::DragInt("Grid count ", &Renderer::GridSize);
+		ImGui::DragInt("Grid count ", &Renderer::GridSize, 1.0f, 1, Renderer::MaxGridSize);
+		Renderer::GridSize = glm::clamp(Renderer::GridSize, 1, Renderer::MaxGridSize);
+
+		// Far tiles only keep every 10th / 100th line
+		LodSettings gridLod = Renderer::getGridLod();
+		static const char* const gridLevels[] = { "Cells", "10x10 tiles", "100x100 tiles" };
+		if (editLod("grid", gridLod, Renderer::getGridLodStats(), gridLevels, LodStats::MaxLevels))
+			Renderer::setGridLod(gridLod);
+
+		const RendererStats& stats = Renderer::getStats();
+		ImGui::Text("Draw calls: %u, indirect commands: %u, instances: %u",
+			stats.apiDrawCalls, stats.commandCount, stats.instanceCount);
+
+		// Frustum culling
+		int cullingMode = (int)Renderer::getCullingMode();
+		ImGui::Text("Culling");
+		ImGui::SameLine();
+		if (ImGui::RadioButton("None", &cullingMode, (int)CullingMode::None))
+			Renderer::setCullingMode(CullingMode::None);
+		ImGui::SameLine();
+		if (ImGui::RadioButton("CPU", &cullingMode, (int)CullingMode::CPU))
+			Renderer::setCullingMode(CullingMode::CPU);
+		ImGui::SameLine();
+		if (ImGui::RadioButton("GPU", &cullingMode, (int)CullingMode::GPU))
+			Renderer::setCullingMode(CullingMode::GPU);
+
+		if (Renderer::getCullingMode() == CullingMode::GPU) {
+			bool validate = Renderer::isCullingValidated();
+			if (ImGui::Checkbox("Validate against CPU reference", &validate))
+				Renderer::setCullingValidation(validate);
+
+			if (validate)
+				ImGui::Text("Mismatching commands: %u", stats.validationErrors);
+		}
+
+		bool occlusion = Renderer::isOcclusionCulling();
+		if (ImGui::Checkbox("Hi-Z occlusion culling", &occlusion))
+			Renderer::setOcclusionCulling(occlusion);
+
+		ImGui::Text("Visible instances: %u / %u", stats.visibleCount, stats.instanceCount);
+		if (occlusion && Renderer::getCullingMode() != CullingMode::None)
+			ImGui::Text("Occluders: %u, occluded instances: %u", stats.occluderCount, stats.occludedCount);
 
 		// Select menu to change Rendering mode
 		static int selected_radio = 0;
@@ -258,20 +734,273 @@ void SceneManager::onUI() {
 		ImGui::TreePop();
 	}
 
+	// Simulation settings
+	bool openSimulation = ImGui::TreeNodeEx((void*)typeid(SceneManager).hash_code(), treeNodeFlags, "Simulation settings");
+	if (openSimulation) {
+		float rate = tickRate;
+		if (ImGui::DragFloat("tick rate (Hz) ", &rate, 1.0f, 1.0f, 1000.0f))
+			setTickRate(rate);
+
+		ImGui::Text("Ticks last frame: %u, interpolation: %.2f", ticksLastFrame, interpolationAlpha);
+		ImGui::Text("Input events last frame: %u, dropped: %u", inputEventsLastFrame, droppedInputEvents);
+
+		bool jobs = JobSystem::isEnabled();
+		if (ImGui::Checkbox("job system ", &jobs))
+			JobSystem::setEnabled(jobs);
+		ImGui::SameLine();
+		ImGui::Text("%u threads, %u jobs stolen last frame", JobSystem::getThreadCount(), JobSystem::getStealCount());
+		JobSystem::resetStealCount();
+
+		ImGui::TreePop();
+	}
+
+	// Entity component system
+	bool openEntities = ImGui::TreeNodeEx((void*)typeid(Registry).hash_code(), treeNodeFlags, "Entities");
+	if (openEntities) {
+		ImGui::DragInt("spinning Olafs ", &prefabCount, 10.0f, 0, 100000);
+		ImGui::Text("%u entities, %u moving", registry.getEntityCount(), registry.pool<Velocity>().size());
+
+		if (ImGui::Button("run benchmarks"))
+			benchmarkResults = Benchmark::runAll();
+		ImGui::SameLine();
+		ImGui::Text("10k, 100k and 1M items, blocks for a few seconds");
+		ImGui::Text("Transform composition kernel: %s", TransformSoA::getInstructionSet());
+
+		for (const Benchmark::Result& result : benchmarkResults)
+			ImGui::Text("%s, %u: %.3f ms (%.2f ns per item)", result.name, result.count, result.ms, result.nsPerItem);
+
+		if (loadedMeshes.empty())
+			ImGui::Text("No cooked mesh, start with --mesh file.mesh (cook one with --cook input.obj output.mesh)");
+		else if (GpuVertexCounter::isSupported())
+			ImGui::Text("Vertex shader invocations of one draw (GPU), load the mesh cooked with --no-optimize too to compare");
+		for (const LoadedMesh& loaded : loadedMeshes) {
+			const CookedMeshHeader& header = loaded.header;
+			ImGui::Text("%s: %u vertices, %u triangles, %u meshlets, %u-bit indices, loaded in %.2f ms", loaded.path.c_str(),
+				header.vertexCount, header.indexCount / 3, header.meshletCount, header.indexSize * 8, loaded.loadMs);
+			if (loaded.vertexInvocations > 0 && header.indexCount > 0)
+				ImGui::Text("    %llu invocations, %.3f per triangle (ACMR), %.3f per vertex (ATVR)", (unsigned long long)loaded.vertexInvocations,
+					(float)loaded.vertexInvocations * 3.0f / header.indexCount, (float)loaded.vertexInvocations / header.vertexCount);
+		}
+
+		ImGui::TreePop();
+	}
+
+	// Scene file
+	bool openSceneFile = ImGui::TreeNodeEx((void*)typeid(SceneFile).hash_code(), treeNodeFlags, "Scene file");
+	if (openSceneFile) {
+		if (sceneFile.isOpen()) {
+			const SceneFileHeader& header = sceneFile.getHeader();
+			ImGui::Text("Scene %s: %u objects, %u meshes, %u point lights, loaded in %.2f ms", scenePath.c_str(),
+				header.objectCount, header.meshCount, header.pointLightCount, sceneLoadMs);
+		} else {
+			ImGui::Text("No scene file, start with --scene file.scene (compile one with --compile-scene input.json output.scene)");
+		}
+		ImGui::InputText("scene file ", sceneFileName, sizeof(sceneFileName));
+		ImGui::SameLine();
+		if (ImGui::Button("save scene"))
+			sceneMessage = saveScene(sceneFileName) ? std::string("Saved ") + sceneFileName : "Save failed, see the console";
+		if (!sceneMessage.empty())
+			ImGui::Text("%s", sceneMessage.c_str());
+
+		if (sceneFile.isOpen() && sceneFile.getHeader().objectCount > 0) {
+			// Edits go to the mapping, the journal saves them
+			const uint32_t objectCount = sceneFile.getHeader().objectCount;
+			ImGui::DragInt("object ", &sceneObject, 1.0f, 0, (int)objectCount - 1);
+			sceneObject = glm::clamp(sceneObject, 0, (int)objectCount - 1);
+			const uint32_t object = (uint32_t)sceneObject;
+			ImGui::Text("Mesh: %s", sceneFile.getMeshName(sceneFile.getMesh(sceneFile.findMesh(object))));
+
+			Transform transform = sceneFile.getTransform(object);
+			glm::vec3 rotation = Transform::toEuler(transform.rotation);
+			bool edited = ImGui::DragFloat3("position  ", (float*)&transform.position);
+			if (ImGui::DragFloat3("rotation  ", (float*)&rotation)) {
+				transform.rotation = Transform::fromEuler(rotation);
+				edited = true;
+			}
+			edited |= ImGui::DragFloat3("scale  ", (float*)&transform.scale, 0.05f);
+			if (edited) {
+				sceneFile.setTransform(object, transform);
+				sceneDirty = true;
+			}
+
+			glm::vec4 color = sceneFile.getColor(object);
+			if (ImGui::ColorEdit4("colour  ", (float*)&color)) {
+				sceneFile.setColor(object, color);
+				sceneDirty = true;
+			}
+
+			// Journal
+			ImGui::Checkbox("autosave ", &autosave);
+			ImGui::SameLine();
+			ImGui::DragFloat("interval (s) ", &autosaveInterval, 0.1f, 0.1f, 60.0f);
+			if (ImGui::Button("save edits"))
+				flushSceneEdits();
+			ImGui::SameLine();
+			if (ImGui::Button("compact journal"))
+				sceneJournal.requestCompaction();
+
+			const SceneJournal::Stats stats = sceneJournal.getStats();
+			ImGui::Text("Journal: %u records, %u replayed at load, compacted at %u", stats.records, stats.replayed, SceneJournal::CompactionRecords);
+			ImGui::Text("%u appends, last %.3f ms, %u compactions, last %.3f ms (journal thread)",
+				stats.appends, stats.appendMs, stats.compactions, stats.compactionMs);
+		}
+
+		ImGui::TreePop();
+	}
+
+	// Frame pacing
+	bool openPacing = ImGui::TreeNodeEx((void*)typeid(FramePacer).hash_code(), treeNodeFlags, "Frame pacing");
+	if (openPacing) {
+		ImGui::Text("Render on demand redraws the scene only when the camera, an Olaf, the light, the grid or the UI changed");
+
+		const FramePacer::Mode current = pacer.getMode();
+		if (ImGui::BeginCombo("mode ", FramePacer::getModeName(current))) {
+			for (int i = 0; i <= (int)FramePacer::Mode::OnDemand; i++) {
+				const FramePacer::Mode mode = (FramePacer::Mode)i;
+				if (ImGui::Selectable(FramePacer::getModeName(mode), mode == current))
+					pacer.setMode(mode);
+			}
+			ImGui::EndCombo();
+		}
+
+		if (current == FramePacer::Mode::Limiter) {
+			float fps = pacer.getTargetFps();
+			if (ImGui::DragFloat("target fps ", &fps, 1.0f, 1.0f, 1000.0f))
+				pacer.setTargetFps(fps);
+		}
+
+		if (pacer.isAdaptiveFallback())
+			ImGui::Text("Adaptive vsync is not supported by the driver, using vsync");
+
+		const FramePacer::Stats& stats = pacer.getStats();
+		ImGui::Text("Frame time: %.2f ms (%.1f fps), min %.2f, max %.2f",
+			stats.meanMs, stats.meanMs > 0.0f ? 1000.0f / stats.meanMs : 0.0f, stats.minMs, stats.maxMs);
+		ImGui::Text("Variance: %.3f ms^2, std dev: %.3f ms", stats.varianceMs2, stats.stdDevMs);
+		if (current == FramePacer::Mode::OnDemand)
+			ImGui::Text("Scene redraws: %u, UI only frames: %u, idle waits: %u",
+				idleStats.sceneFrames, idleStats.presentedFrames, idleStats.idleWaits);
+
+		if (renderThread.isRunning()) {
+			int latency = (int)renderThread.getFrameLatency();
+			ImGui::Text("Render thread frame latency:");
+			ImGui::SameLine();
+			bool changed = ImGui::RadioButton("0 (sync every frame)", &latency, 0);
+			ImGui::SameLine();
+			changed |= ImGui::RadioButton("1 frame", &latency, 1);
+			if (changed)
+				renderThread.setFrameLatency((uint32_t)latency);
+			ImGui::Text("Main thread wait: %.2f ms, render thread draw: %.2f ms", renderThread.getWaitMs(), renderThread.getDrawMs());
+		} else {
+			ImGui::Text("Single threaded, start with --render-thread to draw on a dedicated thread");
+		}
+
+		ImGui::TreePop();
+	}
+
+	// Profiler
+	bool openProfiler = ImGui::TreeNodeEx((void*)typeid(Profiler).hash_code(), treeNodeFlags, "Profiler");
+	if (openProfiler) {
+		Profiler::onUI();
+		ImGui::TreePop();
+	}
+
 	// Light settings
 	bool openLight = ImGui::TreeNodeEx((void*)typeid(Light).hash_code(), treeNodeFlags, "Light settings");
 	if (openLight) {
-		ImGui::DragFloat3("position ", (float*) &light.position);
-		ImGui::ColorEdit4("colour ", (float*)&light.color);
-		ImGui::DragFloat("ambiant strength ", &light.ambientStrength, 0.01);
+		Light& edited = registry.get<Light>(lightEntity);
+		ImGui::DragFloat3("position ", (float*) &edited.position);
+		ImGui::ColorEdit4("colour ", (float*)&edited.color);
+		ImGui::DragFloat("ambiant strength ", &edited.ambientStrength, 0.01);
+
+		// Clustered forward point lights
+		bool clustered = Renderer::isClusteredLighting();
+		if (ImGui::Checkbox("clustered point lights ", &clustered))
+			Renderer::setClusteredLighting(clustered);
+		ImGui::DragInt("point lights ", &pointLightCount, 10.0f, 0, 100000);
+
+		int path = (int)Renderer::getLightingPath();
+		ImGui::Text("Lighting:");
+		ImGui::SameLine();
+		bool pathChanged = ImGui::RadioButton("forward", &path, (int)LightingPath::Forward);
+		ImGui::SameLine();
+		pathChanged |= ImGui::RadioButton("deferred", &path, (int)LightingPath::Deferred);
+		if (pathChanged)
+			Renderer::setLightingPath((LightingPath)path);
+
+		const RendererStats& stats = Renderer::getStats();
+		ImGui::Text("%u lights, %ux%ux%u clusters, binning %.3f ms (GPU)", stats.pointLightCount,
+			Renderer::ClusterX, Renderer::ClusterY, Renderer::ClusterZ, stats.clusterMs);
+		if (stats.overflowClusters > 0)
+			ImGui::Text("%u clusters touch more than %u lights, %u lights left out, the lighting is incomplete there",
+				stats.overflowClusters, Renderer::MaxLightsPerCluster, stats.droppedClusterLights);
+		if (Renderer::getLightingPath() == LightingPath::Deferred)
+			ImGui::Text("G-buffer %.3f ms, lighting %.3f ms (GPU)", stats.drawMs, stats.lightingMs);
+		else
+			ImGui::Text("Scene draws %.3f ms (GPU)", stats.drawMs);
+
+		// Cascaded shadow maps of the scene light
+		ShadowSettings shadows = Renderer::getShadowSettings();
+		bool shadowsChanged = ImGui::Checkbox("shadows ", &shadows.enabled);
+		int resolution = (int)shadows.resolution;
+		ImGui::Text("Shadow resolution:");
+		for (int size : { 512, 1024, 2048, 4096 }) {
+			ImGui::SameLine();
+			shadowsChanged |= ImGui::RadioButton(std::to_string(size).c_str(), &resolution, size);
+		}
+		shadows.resolution = (uint32_t)resolution;
+		int cascades = (int)shadows.cascadeCount;
+		shadowsChanged |= ImGui::SliderInt("cascades ", &cascades, 1, (int)ShadowSettings::MaxCascades);
+		shadows.cascadeCount = (uint32_t)cascades;
+		shadowsChanged |= ImGui::DragFloat("shadow distance ", &shadows.distance, 1.0f, 10.0f, Camera::FarPlane);
+		shadowsChanged |= ImGui::SliderFloat("cascade split lambda ", &shadows.splitLambda, 0.0f, 1.0f);
+		if (shadowsChanged)
+			Renderer::setShadowSettings(shadows);
+
+		if (shadows.enabled) {
+			ImGui::Text("Shadow pass %.3f ms (GPU), casters per cascade:", stats.shadowMs);
+			for (uint32_t c = 0; c < shadows.cascadeCount; c++) {
+				ImGui::SameLine();
+				ImGui::Text("%u", stats.shadowCasters[c]);
+			}
+		}
+
+		if (lightBenchmark.step < 0 && ImGui::Button("benchmark 1 / 100 / 1000 / 10000 lights, forward and deferred")) {
+			lightBenchmark.results.clear();
+			lightBenchmark.savedLightCount = pointLightCount;
+			lightBenchmark.savedPath = Renderer::getLightingPath();
+			lightBenchmark.step = 0;
+			lightBenchmark.frame = 0;
+			pointLightCount = 1;
+			Renderer::setLightingPath(LightingPath::Forward);
+		} else if (lightBenchmark.step >= 0) {
+			ImGui::Text("Benchmark running, %d lights", pointLightCount);
+		}
+
+		for (const LightBenchmark::Result& result : lightBenchmark.results) {
+			if (result.path == LightingPath::Deferred)
+				ImGui::Text("%5d lights deferred: binning %.3f ms, G-buffer %.3f ms, lighting %.3f ms, total %.3f ms", result.lights,
+					result.clusterMs, result.drawMs, result.lightingMs, result.clusterMs + result.drawMs + result.lightingMs);
+			else
+				ImGui::Text("%5d lights forward:  binning %.3f ms, scene draws %.3f ms, total %.3f ms", result.lights,
+					result.clusterMs, result.drawMs, result.clusterMs + result.drawMs);
+			if (result.overflowClusters > 0)
+				ImGui::Text("      up to %u clusters over %u lights, the lighting is incomplete", result.overflowClusters, Renderer::MaxLightsPerCluster);
+		}
 
 		ImGui::TreePop();
 	}
 	
 	ImGui::End();
 
+	// Any widget being edited may change the scene, it is redrawn on the next frame
+	const ImGuiIO& uiIO = ImGui::GetIO();
+	if (ImGui::IsAnyItemActive() || (ImGui::IsAnyItemHovered() && ImGui::IsMouseReleased(ImGuiMouseButton_Left)) || uiIO.WantTextInput)
+		sceneDirty = true;
 
 	ImGui::Render();
+	if (renderThread.isRunning())
+		return;	// Drawn by the render thread
+
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 	ImGuiIO& io = ImGui::GetIO();
@@ -287,7 +1016,13 @@ void SceneManager::onUI() {
 void SceneManager::onDestroyed()
 {
 	olaf.onDestroyed();
+	JobSystem::shutdown();
+
+	// The journal is compacted into the scene file
+	flushSceneEdits();
+	sceneJournal.close();
 
+	Renderer::shutdown();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -300,7 +1035,262 @@ void SceneManager::onDestroyed()
 
 void SceneManager::addKeyEvent(int key, KeyEvent func)
 {
-	keyEvents.push_back(std::make_pair(key, func));
+	assert(key >= 0 && key < KEY_TABLE_SIZE, "Key code out of the handler table");
+	keyHandlers[key].push_back(func);
+}
+
+void SceneManager::loadMesh(const std::string& path)
+{
+	ScopedTimer timer("Mesh loading");
+	CookedMeshHeader header;
+	const MeshID mesh = Renderer::loadMesh(path, &header);
+	if (mesh == InvalidMesh)
+		return;
+
+	// Scaled to a few units and standing on the grid, one after the other along x
+	constexpr float size = 5.0f;
+	constexpr float spacing = 8.0f;
+	const glm::vec3 extent = header.boundsMax - header.boundsMin;
+	const float scale = size / glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 1e-6f));
+	const glm::vec3 center = (header.boundsMin + header.boundsMax) * 0.5f;
+	const glm::vec3 position = glm::vec3(loadedMeshes.size() * spacing, 0.0f, -spacing)
+		- glm::vec3(center.x, header.boundsMin.y, center.z) * scale;
+
+	const Entity entity = registry.create();
+	registry.add<Transform>(entity, { position, glm::quat(1, 0, 0, 0), glm::vec3(scale) });
+	registry.add<WorldTransform>(entity);
+	registry.add<MeshRenderer>(entity, { mesh });
+	registry.add<Color>(entity);
+
+	const float loadMs = timer.elapsedMs();
+	loadedMeshes.push_back({ path, entity, mesh, header, loadMs, Renderer::measureVertexInvocations(mesh) });
+	sceneDirty = true;
+}
+
+bool SceneManager::loadScene(const std::string& path)
+{
+	return openScene(path, true);
+}
+
+bool SceneManager::openScene(const std::string& path, bool loadMeshes)
+{
+	ScopedTimer timer("Scene loading");
+	flushSceneEdits();
+	sceneJournal.close();
+	if (!sceneFile.open(path))
+		return false;
+	sceneJournal.open(path, sceneFile);
+	sceneObject = 0;
+
+	// Cooked meshes are loaded once even when a previous scene used them
+	sceneMeshes.clear();
+	for (uint32_t i = 0; i < sceneFile.getMeshCount(); i++) {
+		const std::string name = sceneFile.getMeshName(sceneFile.getMesh(i));
+		MeshID mesh = InvalidMesh;
+		if (name == "cube")
+			mesh = Renderer::getCubeMesh();
+		else if (name == "olaf")
+			mesh = Olaf::getMesh();
+		else {
+			// Once loaded a cooked mesh stays in loadedMeshes, reloading a saved scene finds every mesh it drew there
+			const auto loaded = std::find_if(loadedMeshes.begin(), loadedMeshes.end(), [&name](const LoadedMesh& m) { return m.path == name; });
+			if (loaded != loadedMeshes.end()) {
+				mesh = loaded->mesh;
+			} else if (loadMeshes) {
+				ScopedTimer meshTimer("Mesh loading");
+				CookedMeshHeader header;
+				mesh = Renderer::loadMesh(name, &header);
+				if (mesh != InvalidMesh) {
+					const float loadMs = meshTimer.elapsedMs();
+					loadedMeshes.push_back({ name, NullEntity, mesh, header, loadMs, Renderer::measureVertexInvocations(mesh) });
+				}
+			}
+		}
+		sceneMeshes.push_back(mesh);
+	}
+
+	// What saveScene writes is drawn from the file now
+	for (LoadedMesh& loaded : loadedMeshes) {
+		if (loaded.entity != NullEntity)
+			registry.destroy(loaded.entity);
+		loaded.entity = NullEntity;
+	}
+	crowdSize = 0;
+	pointLightCount = 0;
+
+	registry.get<Light>(lightEntity) = sceneFile.getLight();
+	scenePath = path;
+	sceneLoadMs = timer.elapsedMs();
+	sceneDirty = true;
+	return true;
+}
+
+bool SceneManager::saveScene(const std::string& path)
+{
+	SceneDescription scene;
+	scene.light = registry.get<Light>(lightEntity);
+
+	auto meshIndex = [&scene](const std::string& name) {
+		const auto found = std::find(scene.meshes.begin(), scene.meshes.end(), name);
+		if (found != scene.meshes.end())
+			return (uint32_t)(found - scene.meshes.begin());
+		scene.meshes.push_back(name);
+		return (uint32_t)scene.meshes.size() - 1;
+	};
+
+	const uint32_t olafMesh = meshIndex("olaf");
+	for (uint32_t id = 1; id < getObjectCount(); id++) {
+		const Transform transform = getObject(id).getMeshTransform();
+		scene.objects.push_back({ olafMesh, transform.position, transform.rotation, transform.scale, glm::vec4(1.0f) });
+	}
+
+	// Static mesh entities, the parts of the prefabs have a Parent
+	registry.each<MeshRenderer, Transform>([&](Entity entity, const MeshRenderer& renderer, const Transform& transform) {
+		if (registry.has<Parent>(entity) || registry.has<Velocity>(entity))
+			return;
+
+		std::string name = renderer.mesh == Renderer::getCubeMesh() ? "cube" : renderer.mesh == Olaf::getMesh() ? "olaf" : "";
+		for (const LoadedMesh& loaded : loadedMeshes) {
+			if (loaded.entity == entity)
+				name = loaded.path;
+		}
+		if (name.empty())
+			return;
+
+		const Color* color = registry.tryGet<Color>(entity);
+		scene.objects.push_back({ meshIndex(name), transform.position, transform.rotation, transform.scale, color ? color->value : glm::vec4(1.0f) });
+	});
+
+	registry.each<PointLight, Transform>([&scene](Entity entity, const PointLight& light, const Transform& transform) {
+		scene.pointLights.push_back({ glm::vec4(transform.position, light.radius), glm::vec4(light.color, light.intensity) });
+	});
+
+	// Objects of the loaded scene file, read back from the columns
+	if (sceneFile.isOpen()) {
+		for (uint32_t i = 0; i < sceneFile.getMeshCount(); i++) {
+			const SceneMesh& mesh = sceneFile.getMesh(i);
+			const uint32_t index = meshIndex(sceneFile.getMeshName(mesh));
+			const TransformColumns columns = sceneFile.getTransforms(mesh);
+			const glm::vec4* colors = sceneFile.getColors(mesh);
+			for (uint32_t o = 0; o < columns.count; o++) {
+				SceneObject object;
+				object.mesh = index;
+				object.position = { columns.position[0][o], columns.position[1][o], columns.position[2][o] };
+				object.rotation = glm::quat(columns.rotation[3][o], columns.rotation[0][o], columns.rotation[1][o], columns.rotation[2][o]);
+				object.scale = { columns.scale[0][o], columns.scale[1][o], columns.scale[2][o] };
+				object.color = colors[o];
+				scene.objects.push_back(object);
+			}
+		}
+		const PointLightData* lights = sceneFile.getPointLights();
+		scene.pointLights.insert(scene.pointLights.end(), lights, lights + sceneFile.getHeader().pointLightCount);
+	}
+
+	// The file may be the mapped one, it is written to a copy first
+	const std::string temporary = path + ".tmp";
+	if (!SceneFile::write(temporary, scene))
+		return false;
+	const bool reload = sceneFile.isOpen() && path == scenePath;
+	if (reload) {
+		// The new file has the edits, the journal goes with the old one
+		sceneJournal.close();
+		sceneFile.close();
+	}
+	if (!BinaryFile::replace(temporary, path))
+		return false;
+	// Called from the UI while run() draws, possibly on the render thread: no mesh is loaded
+	return reload ? openScene(path, false) : true;
+}
+
+void SceneManager::updateSceneJournal(float dt)
+{
+	if (!sceneFile.isOpen())
+		return;
+
+	// The light is edited as a component
+	const Light& edited = registry.get<Light>(lightEntity);
+	const Light saved = sceneFile.getLight();
+	if (edited.position != saved.position || edited.color != saved.color || edited.ambientStrength != saved.ambientStrength)
+		sceneFile.setLight(edited);
+
+	// A drag edits the same values every frame, they are journaled once per interval
+	autosaveTimer += dt;
+	if (autosave && autosaveTimer >= autosaveInterval) {
+		flushSceneEdits();
+		autosaveTimer = 0.0f;
+	}
+}
+
+void SceneManager::flushSceneEdits()
+{
+	if (!sceneFile.isOpen() || !sceneFile.hasPatches())
+		return;
+
+	sceneFile.takePatches(scenePatches);
+	sceneJournal.append(scenePatches);
+}
+
+void SceneManager::pushInputEvent(GLFWwindow* window, const InputEvent& event)
+{
+	SceneManager& scene = *((WindowUserData*)glfwGetWindowUserPointer(window))->sceneManager;
+	if (!scene.inputQueue.push(event))
+		scene.droppedInputEvents++;
+}
+
+void SceneManager::dispatchInputEvents()
+{
+	WindowUserData& data = *(WindowUserData*)glfwGetWindowUserPointer(window);
+
+	inputEventsLastFrame = 0;
+	InputEvent event;
+	while (inputQueue.pop(event)) {
+		inputEvents++;
+		inputEventsLastFrame++;
+
+		switch (event.type) {
+		case InputEvent::Key:
+			if (event.code < 0 || event.code >= KEY_TABLE_SIZE || keyHandlers[event.code].empty())
+				break;
+
+			// Shortcuts edit the scene. Every handler of the key runs
+			sceneDirty = true;
+			for (KeyEvent& handler : keyHandlers[event.code])
+				handler(*this, data, (KeyAction)event.action);
+			break;
+
+		// A left click that did not drag (dragging moves the camera) selects the Olaf under the cursor
+		case InputEvent::MouseButton:
+			if (event.code != GLFW_MOUSE_BUTTON_LEFT)
+				break;
+
+			if (event.action == GLFW_PRESS) {
+				pressPosition = { event.x, event.y };
+			} else if (event.action == GLFW_RELEASE) {
+				const bool uiHovered = ImGui::GetCurrentContext() && ImGui::GetIO().WantCaptureMouse;
+				if (!uiHovered && glm::length(glm::vec2(event.x, event.y) - pressPosition) < 3.0f)
+					pickRequested = true;
+			}
+			break;
+
+		case InputEvent::Resize:
+			data.width = (uint32_t)event.x;
+			data.height = (uint32_t)event.y;
+			sceneDirty = true;
+
+			// The viewport is set by Renderer::renderFrame, on the thread owning the context
+			camera.setWindowSize(data.width, data.height);
+			break;
+
+		// The window content was lost (uncovered, restored...), the render on demand mode must draw it again
+		case InputEvent::Refresh:
+			sceneDirty = true;
+			break;
+
+		// Cursor and scroll events only wake up the render on demand mode
+		default:
+			break;
+		}
+	}
 }
 
 bool SceneManager::isKeyDown(KeyCode keyCode) const {
@@ -324,27 +1314,32 @@ glm::vec2 SceneManager::getMousePos() const {
 
 void SceneManager::listenToEvents(GLFWwindow* window) {
 
+	// The callbacks only queue the events, SceneManager::dispatchInputEvents handles them once per frame.
+	// ImGui chains its own callbacks after these
 	glfwSetWindowSizeCallback(window, [](GLFWwindow* window, int width, int height) {
-		WindowUserData& data = *(WindowUserData*)glfwGetWindowUserPointer(window);
-		data.width = width;
-		data.height = height;
+		pushInputEvent(window, { InputEvent::Resize, 0, 0, 0, (float)width, (float)height });
+	});
 
-		glViewport(0, 0, width, height);
-		data.sceneManager->getCamera().setWindowSize(width, height);
+	glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods) {
+		double x, y;
+		glfwGetCursorPos(window, &x, &y);
+		pushInputEvent(window, { InputEvent::MouseButton, (uint8_t)action, (uint16_t)mods, button, (float)x, (float)y });
 	});
 
-	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
-		WindowUserData* data = (WindowUserData*)glfwGetWindowUserPointer(window);
-		auto& keyEvents = data->sceneManager->keyEvents;
+	glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x, double y) {
+		pushInputEvent(window, { InputEvent::CursorPos, 0, 0, 0, (float)x, (float)y });
+	});
 
-		for (std::pair<int, KeyEvent>& pair : keyEvents)
-		{
-			if (key == pair.first)
-			{
-				pair.second(*data->sceneManager, *data, (KeyAction)action);
-				break;
-			}
-		}
+	glfwSetScrollCallback(window, [](GLFWwindow* window, double x, double y) {
+		pushInputEvent(window, { InputEvent::Scroll, 0, 0, 0, (float)x, (float)y });
+	});
+
+	glfwSetWindowRefreshCallback(window, [](GLFWwindow* window) {
+		pushInputEvent(window, { InputEvent::Refresh, 0, 0, 0, 0.0f, 0.0f });
+	});
+
+	glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+		pushInputEvent(window, { InputEvent::Key, (uint8_t)action, (uint16_t)mods, key, 0.0f, 0.0f });
 	});
 }
 
@@ -8,6 +8,17 @@
 #include <Olaf.h>
 #include "KeyCodes.h"
 #include "Light.h"
+#include "SpatialIndex.h"
+#include "Renderer.h"
+#include "FramePacer.h"
+#include "RenderThread.h"
+#include "InputQueue.h"
+#include "InputActions.h"
+#include "ECS.h"
+#include "Benchmark.h"
+#include "SceneFile.h"
+#include "SceneJournal.h"
+#include <array>
 
 class SceneManager;
 
@@ -29,13 +40,65 @@ public:
 
 	void run();
 	void onCreate();
+	/**
+	 * \brief Simulation step, runs at getTickRate() independently of the frame rate
+	 */
+	void onFixedUpdate(float dt);
+
+	/**
+	 * \brief Called once per frame, draws the scene interpolated between the last two ticks
+	 */
 	void onUpdate(float dt);
 	void onUI();
 	void onDestroyed();
 
+	/**
+	 * \brief Adds a handler to a key, every handler of the key runs when it is pressed, repeated or released
+	 * \param key GLFW key code, below KEY_TABLE_SIZE
+	 */
 	void addKeyEvent(int key, KeyEvent func);
 
+	/**
+	 * \brief Loads a cooked mesh and places it in a row behind the grid origin, as an entity of the registry.
+	 * Must be called before run (the upload needs the GL context)
+	 */
+	void loadMesh(const std::string& path);
+
+	/**
+	 * \brief Maps a scene file, its objects and point lights are drawn every frame straight from the mapping and its
+	 * light replaces the scene light. The crowd, the mesh entities and the point light entities are removed, a saved
+	 * scene holds them. Replaces the scene file loaded before. Must be called before run (cooked meshes are loaded).
+	 * The edits a previous run left in the journal of the scene are replayed
+	 */
+	bool loadScene(const std::string& path);
+
+	/**
+	 * \brief Writes the scene as it is: the crowd, the static mesh entities, the point lights, the light and the objects
+	 * of the loaded scene file. The controllable Olaf and the spinning ones are simulated and left out.
+	 * The edits of the loaded scene file are saved by its journal, this is only needed for the rest
+	 */
+	bool saveScene(const std::string& path);
+
+	static constexpr int KEY_TABLE_SIZE = 512;	// Covers every GLFW key code (GLFW_KEY_LAST is 348)
+
+	/**
+	 * \brief Draws on a dedicated thread owning the GL context. Must be called before onCreate
+	 * (ImGui platform windows are disabled, they need the context on the main thread)
+	 */
+	void setRenderThreadEnabled(bool cond) { renderThreadEnabled = cond; }
+
+	void setTickRate(float ticksPerSecond) { tickRate = glm::max(ticksPerSecond, 1.0f); }
+	float getTickRate() const { return tickRate; }
+
 	Camera& getCamera() { return camera; }
+	InputActions& getInputActions() { return inputActions; }
+
+	/**
+	 * \brief Call after changing the transform of an object: queues it for the spatial index and keeps render on
+	 * demand drawing until the next tick. The ticks themselves don't move the Olafs
+	 */
+	void markMoved(uint32_t id);
+
 	GLFWwindow* getWindow() { return window; }
 
 	bool isKeyDown(KeyCode keyCode) const;
@@ -46,8 +109,89 @@ public:
 private:
 	void listenToEvents(GLFWwindow* window);
 
+	/**
+	 * \brief Called by the GLFW callbacks, queues the event for the next dispatchInputEvents()
+	 */
+	static void pushInputEvent(GLFWwindow* window, const InputEvent& event);
+
+	/**
+	 * \brief Drains the input queue and runs the handlers, once per frame before the simulation
+	 */
+	void dispatchInputEvents();
+
+	/**
+	 * \brief Resizes the crowd and pushes the Olafs that moved to the spatial index
+	 */
+	void updateSpatialIndex();
+
+	/**
+	 * \brief Selects the Olaf under the cursor: spatial index ray query, then SIMD tests against the parts
+	 */
+	void pick(const glm::vec2& mouse);
+
+	/**
+	 * \brief Spawns or destroys Olaf prefabs in the registry until there are prefabCount of them
+	 */
+	void updatePrefabs();
+
+	/**
+	 * \brief Spawns or destroys point light entities until there are pointLightCount of them
+	 */
+	void updatePointLights();
+
+	/**
+	 * \brief Steps the light benchmark, once per frame after the stats of the last drawn frame are published
+	 */
+	void updateLightBenchmark();
+
+	/**
+	 * \brief loadScene, but the cooked meshes not loaded yet are only loaded if loadMeshes is true (it needs the GL context),
+	 * otherwise they are not drawn. The meshes a scene drew before are always reused
+	 */
+	bool openScene(const std::string& path, bool loadMeshes);
+
+	/**
+	 * \brief Records the light in the scene file if it was edited, and hands the edits to the journal every autosave interval
+	 */
+	void updateSceneJournal(float dt);
+
+	/**
+	 * \brief Hands the edits of the scene file to the journal thread
+	 */
+	void flushSceneEdits();
+
+	// Everything the drawn scene depends on, compared between frames by the render on demand mode
+	struct RenderedState {
+		uint32_t cameraVersion = 0;
+		Light light;
+		int gridSize = 0;
+		int crowdSize = 0;
+		int prefabCount = 0;
+		int pointLightCount = 0;
+		uint32_t selected = 0;
+		int renderingMode = 0;
+		bool objectsMoving = false;
+		bool valid = false;
+	};
+
+	RenderedState captureState() const;
+
+	/**
+	 * \brief Render on demand: true if the scene changed since the last frame drawn in the scene framebuffer
+	 */
+	bool isSceneDirty();
+
+	// Spatial index id 0 is the controllable Olaf, id i + 1 is crowd[i]
+	Olaf& getObject(uint32_t id) { return id == 0 ? olaf : crowd[id - 1]; }
+	const Olaf& getObject(uint32_t id) const { return id == 0 ? olaf : crowd[id - 1]; }
+	uint32_t getObjectCount() const { return (uint32_t)crowd.size() + 1; }
+
 private:
-	std::vector<std::pair<int, KeyEvent>> keyEvents;
+	std::array<std::vector<KeyEvent>, KEY_TABLE_SIZE> keyHandlers;	// Indexed by key code
+	SPSCQueue<InputEvent, 1024> inputQueue;
+	uint32_t inputEventsLastFrame = 0;
+	uint32_t droppedInputEvents = 0;
+	InputActions inputActions;
 
 	GLFWwindow* window;
 	Camera camera;
@@ -55,6 +199,144 @@ private:
 	Light light;
 	Olaf olaf;
 
-	float lastDt = 0.0f;	
+	// Extra Olafs scattered on the grid
+	std::vector<Olaf> crowd;
+	int crowdSize = 0;
+
+	// Entities, the light and the spinning Olaf prefabs live in the registry
+	Registry registry;
+	Entity lightEntity = NullEntity;
+	std::vector<Entity> prefabs;		// Roots of the Olaf prefabs
+	int prefabCount = 0;
+	std::vector<Benchmark::Result> benchmarkResults;
+
+	// Meshes given with --mesh
+	struct LoadedMesh {
+		std::string path;
+		Entity entity;				// NullEntity once a scene file took it over
+		MeshID mesh;
+		CookedMeshHeader header;
+		float loadMs;
+		uint64_t vertexInvocations;	// One draw, see Renderer::measureVertexInvocations
+	};
+	std::vector<LoadedMesh> loadedMeshes;
+
+	// Scene file given with --scene
+	SceneFile sceneFile;
+	std::string scenePath;
+	std::vector<MeshID> sceneMeshes;		// Arena mesh of every mesh of the file, InvalidMesh if it failed to load
+	float sceneLoadMs = 0.0f;
+	std::string sceneMessage;				// Result of the last save
+	char sceneFileName[256] = "scene.scene";	// Edited in the UI
+	int sceneObject = 0;					// Object of the scene file edited in the UI
+
+	// Edits of the scene file are journaled, see SceneJournal
+	SceneJournal sceneJournal;
+	std::vector<ScenePatch> scenePatches;
+	bool autosave = true;
+	float autosaveInterval = 1.0f;			// Seconds
+	float autosaveTimer = 0.0f;
+
+	// Point lights scattered over the grid, drawn by the clustered forward pass
+	std::vector<Entity> pointLights;
+	int pointLightCount = 0;
+
+	// Runs the scene at 1, 100, 1000 and 10000 point lights, forward then deferred, and averages the GPU times
+	struct LightBenchmark {
+		static constexpr int warmupFrames = 10;		// Covers the GPU timer latency and the light respawn
+		static constexpr int measuredFrames = 60;
+
+		struct Result {
+			int lights;
+			LightingPath path;
+			float clusterMs;
+			float drawMs;
+			float lightingMs;
+			uint32_t overflowClusters;	// Most in a measured frame
+		};
+
+		int step = -1;			// Light count index * 2 + lighting path, -1 when not running
+		int frame = 0;
+		int savedLightCount = 0;
+		LightingPath savedPath = LightingPath::Forward;
+		float clusterMs = 0.0f;
+		float drawMs = 0.0f;
+		float lightingMs = 0.0f;
+		uint32_t overflowClusters = 0;
+		std::vector<Result> results;
+	};
+	LightBenchmark lightBenchmark;
+
+	// State of every object when it was last pushed to the spatial index
+	struct IndexedState {
+		glm::vec3 position;
+		glm::quat rotation;
+		float scale;
+		bool moved = false;		// In movedObjects
+	};
+
+	SpatialIndex spatialIndex;
+	std::vector<IndexedState> indexedStates;
+	std::vector<uint32_t> movedObjects;		// Marked since the last index update, objects not indexed yet are not in it
+	bool objectsMoving = false;				// An object was marked since the last tick, it is drawn interpolated
+	std::vector<uint32_t> visibleObjects;
+	std::vector<InstanceData> visibleInstances;	// One per visible Olaf, filled by the job system
+	std::vector<uint32_t> visibleSlots;			// Index in visibleInstances of every visible Olaf
+
+	// Far Olafs are drawn as a single box, the choice is kept per object for the hysteresis
+	LodSettings olafLod = { true, 40.0f, 0.25f };
+	std::vector<uint8_t> objectLods;			// Indexed like the spatial index, 1 when drawn as a box
+	LodStats olafLodStats;
+	std::vector<uint32_t> neighbours;
+	int indexedGridSize = -1;
+
+	// Mouse picking
+	struct PickResult {
+		int object = -1;
+		int part = -1;
+		float distance = 0.0f;
+		float timeMs = 0.0f;
+		uint32_t candidates = 0;
+	};
+
+	uint32_t selected = 0;			// Object edited in the Olaf settings
+	PickResult lastPick;
+	bool pickRequested = false;
+	glm::vec2 pressPosition = glm::vec2(0.0f);
+	std::vector<uint32_t> pickCandidates;
+	std::vector<AABB> pickBoxes;
+	std::vector<float> pickDistances;
+	std::vector<uint32_t> pickOrder;
+
+	float lastDt = 0.0f;
+
+	// Fixed timestep
+	float tickRate = 60.0f;				// Simulation ticks per second
+	float accumulator = 0.0f;			// Time not simulated yet
+	float interpolationAlpha = 1.0f;	// accumulator / tick duration after the last tick
+	uint32_t ticksLastFrame = 0;
+
+	// Frame pacing
+	FramePacer pacer;
+	uint32_t inputEvents = 0;			// Incremented for every dispatched input event
+	uint32_t handledInputEvents = 0;
+
+	// Render thread
+	RenderThread renderThread;
+	bool renderThreadEnabled = false;
+
+	// Render on demand
+	static constexpr int uiSettleFrames = 3;		// UI frames drawn after an input (ImGui needs a few to settle)
+	static constexpr double idleTimeout = 0.1;		// Longest sleep while idle, in seconds
+	int uiFrames = 0;
+	bool sceneDirty = true;				// Set by the events, the UI and markMoved, for the changes not captured in RenderedState
+	RenderedState renderedState;
+
+	struct IdleStats {
+		uint32_t sceneFrames = 0;		// Frames where the scene was redrawn
+		uint32_t presentedFrames = 0;	// Frames where the last scene was presented again under a new UI
+		uint32_t idleWaits = 0;			// Iterations that slept without drawing
+	};
+	IdleStats idleStats;
 };
 
@@ -10,6 +10,8 @@ static GLenum ShaderTypeFromString(const std::string& type)
 		return GL_VERTEX_SHADER;
 	if (type == "fragment" || type == "pixel")
 		return GL_FRAGMENT_SHADER;
+	if (type == "compute")
+		return GL_COMPUTE_SHADER;
 	return 0;
 }
 
@@ -117,7 +119,8 @@ void Shader::compile(const std::unordered_map<GLenum, std::string>& shaderSource
 	GLuint program = glCreateProgram();
 	assert(shaderSources.size() <= 2, "We only support 2 shaders for now");
 
-	std::array<GLenum, 2> glShaderIDs;
+	// Compute programs only fill the first entry
+	std::array<GLenum, 2> glShaderIDs = {};
 	int glShaderIDIndex = 0;
 	for (auto& kv : shaderSources)
 	{
@@ -172,17 +175,17 @@ void Shader::compile(const std::unordered_map<GLenum, std::string>& shaderSource
 		// We don't need the program anymore.
 		glDeleteProgram(program);
 
-		for (auto id : glShaderIDs)
-			glDeleteShader(id);
+		for (int i = 0; i < glShaderIDIndex; i++)
+			glDeleteShader(glShaderIDs[i]);
 
 		assert(false, std::string("Shader link failure!") + std::string(infoLog.data()));
 		return;
 	}
 
-	for (auto id : glShaderIDs)
+	for (int i = 0; i < glShaderIDIndex; i++)
 	{
-		glDetachShader(program, id);
-		glDeleteShader(id);
+		glDetachShader(program, glShaderIDs[i]);
+		glDeleteShader(glShaderIDs[i]);
 	}
 }
 
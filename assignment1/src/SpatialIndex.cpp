@@ -0,0 +1,503 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * *****************************
+ * ******** Loose grid *********
+ * *****************************
+ */
+void LooseGrid::reset(int gridSize, int cellSize)
+{
+	this->cellSize = std::max(cellSize, 1);
+	cellsPerAxis = std::max((gridSize + this->cellSize - 1) / this->cellSize, 1);
+	origin = glm::vec2(-gridSize / 2);
+	maxHalfSize = 0.0f;
+
+	cells.clear();
+	cells.resize(cellsPerAxis * cellsPerAxis);
+	occupied.clear();
+
+	// Put back the objects that were already there
+	for (uint32_t id = 0; id < locations.size(); id++) {
+		if (locations[id].cell < 0)
+			continue;
+
+		locations[id].cell = -1;
+		insert(id, objectBoxes[id]);
+	}
+}
+
+int LooseGrid::cellOf(const glm::vec3& point) const
+{
+	// Objects outside of the grid are kept in the border cells
+	const int x = std::clamp((int)std::floor((point.x - origin.x) / cellSize), 0, cellsPerAxis - 1);
+	const int z = std::clamp((int)std::floor((point.z - origin.y) / cellSize), 0, cellsPerAxis - 1);
+	return z * cellsPerAxis + x;
+}
+
+void LooseGrid::attach(uint32_t id, int cellIndex)
+{
+	Cell& cell = cells[cellIndex];
+	if (cell.objects.empty()) {
+		cell.occupiedSlot = (int)occupied.size();
+		occupied.push_back(cellIndex);
+	}
+
+	locations[id] = { cellIndex, (uint32_t)cell.objects.size() };
+	cell.objects.push_back(id);
+	cell.bounds.merge(objectBoxes[id]);
+}
+
+void LooseGrid::detach(uint32_t id)
+{
+	const Location location = locations[id];
+	Cell& cell = cells[location.cell];
+
+	// Swap remove
+	const uint32_t last = cell.objects.back();
+	cell.objects[location.slot] = last;
+	locations[last].slot = location.slot;
+	cell.objects.pop_back();
+	locations[id].cell = -1;
+
+	if (cell.objects.empty()) {
+		const int movedCell = occupied.back();
+		occupied[cell.occupiedSlot] = movedCell;
+		cells[movedCell].occupiedSlot = cell.occupiedSlot;
+		occupied.pop_back();
+		cell.occupiedSlot = -1;
+	}
+
+	refreshBounds(cell);
+}
+
+void LooseGrid::refreshBounds(Cell& cell)
+{
+	cell.bounds = AABB();
+	for (uint32_t id : cell.objects)
+		cell.bounds.merge(objectBoxes[id]);
+}
+
+void LooseGrid::insert(uint32_t id, const AABB& box)
+{
+	if (id >= locations.size()) {
+		locations.resize(id + 1);
+		objectBoxes.resize(id + 1);
+	}
+
+	objectBoxes[id] = box;
+	maxHalfSize = std::max({ maxHalfSize, box.extent().x, box.extent().z });
+	attach(id, cellOf(box.center()));
+}
+
+void LooseGrid::update(uint32_t id, const AABB& box)
+{
+	const int cell = cellOf(box.center());
+	maxHalfSize = std::max({ maxHalfSize, box.extent().x, box.extent().z });
+
+	if (cell != locations[id].cell) {
+		detach(id);
+		objectBoxes[id] = box;
+		attach(id, cell);
+	} else {
+		objectBoxes[id] = box;
+		refreshBounds(cells[cell]);
+	}
+}
+
+void LooseGrid::remove(uint32_t id)
+{
+	if (id < locations.size() && locations[id].cell >= 0)
+		detach(id);
+}
+
+void LooseGrid::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+	for (int cellIndex : occupied) {
+		const Cell& cell = cells[cellIndex];
+		if (!frustum.intersects(cell.bounds.min, cell.bounds.max))
+			continue;
+
+		for (uint32_t id : cell.objects) {
+			if (frustum.intersects(objectBoxes[id].min, objectBoxes[id].max))
+				out.push_back(id);
+		}
+	}
+}
+
+void LooseGrid::queryAABB(const AABB& area, std::vector<uint32_t>& out) const
+{
+	// An object overlapping the area has its center at most maxHalfSize away from it
+	const glm::vec3 margin(maxHalfSize, 0.0f, maxHalfSize);
+	const int first = cellOf(area.min - margin);
+	const int last = cellOf(area.max + margin);
+
+	for (int z = first / cellsPerAxis; z <= last / cellsPerAxis; z++) {
+		for (int x = first % cellsPerAxis; x <= last % cellsPerAxis; x++) {
+			const Cell& cell = cells[z * cellsPerAxis + x];
+			if (cell.objects.empty() || !cell.bounds.intersects(area))
+				continue;
+
+			for (uint32_t id : cell.objects) {
+				if (objectBoxes[id].intersects(area))
+					out.push_back(id);
+			}
+		}
+	}
+}
+
+void LooseGrid::queryRay(const Ray& ray, float maxT, std::vector<uint32_t>& out) const
+{
+	float t;
+	for (int cellIndex : occupied) {
+		const Cell& cell = cells[cellIndex];
+		if (!ray.intersects(cell.bounds, maxT, t))
+			continue;
+
+		for (uint32_t id : cell.objects) {
+			if (ray.intersects(objectBoxes[id], maxT, t))
+				out.push_back(id);
+		}
+	}
+}
+
+/**
+ * *****************************
+ * ************ BVH ************
+ * *****************************
+ */
+static constexpr uint32_t BVH_LEAF_SIZE = 4;
+static constexpr int BVH_BIN_COUNT = 12;
+
+void BVH::build(const std::vector<AABB>& boxes)
+{
+	this->boxes = boxes;
+	nodes.clear();
+	objects.clear();
+	leafOf.assign(boxes.size(), -1);
+
+	for (uint32_t id = 0; id < boxes.size(); id++) {
+		if (boxes[id].isValid())
+			objects.push_back(id);
+	}
+
+	if (objects.empty()) {
+		buildCost = currentCost = 0.0f;
+		return;
+	}
+
+	nodes.reserve(2 * objects.size() / BVH_LEAF_SIZE + 1);
+	buildNode(0, (uint32_t)objects.size(), -1, boxes);
+	buildCost = currentCost = cost();
+}
+
+int BVH::buildNode(uint32_t first, uint32_t count, int parent, const std::vector<AABB>& boxes)
+{
+	const int index = (int)nodes.size();
+	nodes.emplace_back();
+	nodes[index].parent = parent;
+
+	AABB bounds, centroids;
+	for (uint32_t i = first; i < first + count; i++) {
+		bounds.merge(boxes[objects[i]]);
+		centroids.merge(boxes[objects[i]].center());
+	}
+	nodes[index].bounds = bounds;
+
+	auto makeLeaf = [&]() {
+		nodes[index].first = first;
+		nodes[index].count = count;
+		for (uint32_t i = first; i < first + count; i++)
+			leafOf[objects[i]] = index;
+		return index;
+	};
+
+	if (count <= BVH_LEAF_SIZE)
+		return makeLeaf();
+
+	// Binned SAH over the axis with the largest centroid spread
+	const glm::vec3 spread = centroids.max - centroids.min;
+	const int axis = spread.x > spread.y && spread.x > spread.z ? 0 : (spread.y > spread.z ? 1 : 2);
+	if (spread[axis] <= 0.0f)
+		return makeLeaf();
+
+	struct Bin {
+		AABB bounds;
+		uint32_t count = 0;
+	} bins[BVH_BIN_COUNT];
+
+	const float binScale = BVH_BIN_COUNT / spread[axis];
+	auto binOf = [&](uint32_t id) {
+		return std::min((int)((boxes[id].center()[axis] - centroids.min[axis]) * binScale), BVH_BIN_COUNT - 1);
+	};
+
+	for (uint32_t i = first; i < first + count; i++) {
+		Bin& bin = bins[binOf(objects[i])];
+		bin.bounds.merge(boxes[objects[i]]);
+		bin.count++;
+	}
+
+	// Sweep from the right to get the cost of every split plane
+	float rightArea[BVH_BIN_COUNT - 1];
+	uint32_t rightCount[BVH_BIN_COUNT - 1];
+	AABB accumulated;
+	uint32_t accumulatedCount = 0;
+	for (int i = BVH_BIN_COUNT - 1; i > 0; i--) {
+		accumulated.merge(bins[i].bounds);
+		accumulatedCount += bins[i].count;
+		rightArea[i - 1] = accumulatedCount ? accumulated.surfaceArea() : 0.0f;
+		rightCount[i - 1] = accumulatedCount;
+	}
+
+	float bestCost = FLT_MAX;
+	int bestSplit = -1;
+	accumulated = AABB();
+	accumulatedCount = 0;
+	for (int i = 0; i < BVH_BIN_COUNT - 1; i++) {
+		accumulated.merge(bins[i].bounds);
+		accumulatedCount += bins[i].count;
+		if (accumulatedCount == 0 || rightCount[i] == 0)
+			continue;
+
+		const float splitCost = accumulatedCount * accumulated.surfaceArea() + rightCount[i] * rightArea[i];
+		if (splitCost < bestCost) {
+			bestCost = splitCost;
+			bestSplit = i;
+		}
+	}
+
+	// Not splitting is cheaper
+	if (bestSplit < 0 || bestCost >= count * bounds.surfaceArea())
+		return makeLeaf();
+
+	uint32_t* middle = std::partition(objects.data() + first, objects.data() + first + count,
+		[&](uint32_t id) { return binOf(id) <= bestSplit; });
+	const uint32_t leftCount = (uint32_t)(middle - (objects.data() + first));
+
+	const int left = buildNode(first, leftCount, index, boxes);
+	const int right = buildNode(first + leftCount, count - leftCount, index, boxes);
+	nodes[index].left = left;
+	nodes[index].right = right;
+	return index;
+}
+
+float BVH::cost() const
+{
+	float total = 0.0f;
+	for (const Node& node : nodes)
+		total += nodeCost(node);
+	return total;
+}
+
+void BVH::refit(uint32_t id, const AABB& box)
+{
+	boxes[id] = box;
+
+	int index = leafOf[id];
+	if (index < 0)
+		return;
+
+	// Leaf
+	Node& leaf = nodes[index];
+	currentCost -= nodeCost(leaf);
+	leaf.bounds = AABB();
+	for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++)
+		leaf.bounds.merge(boxes[objects[i]]);
+	currentCost += nodeCost(leaf);
+
+	// Ancestors, the cost is updated with the terms of the path instead of summing every node again
+	for (index = leaf.parent; index >= 0; index = nodes[index].parent) {
+		Node& node = nodes[index];
+		currentCost -= nodeCost(node);
+		node.bounds = nodes[node.left].bounds;
+		node.bounds.merge(nodes[node.right].bounds);
+		currentCost += nodeCost(node);
+	}
+}
+
+// Traversal stack of the queries, kept per thread so it only grows to the depth of the tree once
+static std::vector<int>& traversalStack()
+{
+	thread_local std::vector<int> stack;
+	stack.clear();
+	return stack;
+}
+
+void BVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<int>& stack = traversalStack();
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!frustum.intersects(node.bounds.min, node.bounds.max))
+			continue;
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				const AABB& box = boxes[objects[i]];
+				if (frustum.intersects(box.min, box.max))
+					out.push_back(objects[i]);
+			}
+		} else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+void BVH::queryAABB(const AABB& area, std::vector<uint32_t>& out) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<int>& stack = traversalStack();
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!node.bounds.intersects(area))
+			continue;
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (boxes[objects[i]].intersects(area))
+					out.push_back(objects[i]);
+			}
+		} else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+void BVH::queryRay(const Ray& ray, float maxT, std::vector<uint32_t>& out) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<int>& stack = traversalStack();
+	stack.push_back(0);
+
+	float t;
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!ray.intersects(node.bounds, maxT, t))
+			continue;
+
+		if (node.isLeaf()) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (ray.intersects(boxes[objects[i]], maxT, t))
+					out.push_back(objects[i]);
+			}
+		} else {
+			stack.push_back(node.left);
+			stack.push_back(node.right);
+		}
+	}
+}
+
+/**
+ * *****************************
+ * ******* Spatial index *******
+ * *****************************
+ */
+void SpatialIndex::reset(int gridSize, int cellSize)
+{
+	grid.reset(gridSize, cellSize);
+}
+
+void SpatialIndex::insert(uint32_t id, const AABB& box)
+{
+	if (id >= boxes.size())
+		boxes.resize(id + 1);
+
+	boxes[id] = box;
+	grid.insert(id, box);
+	objectCount++;
+	bvhDirty = true;
+}
+
+void SpatialIndex::update(uint32_t id, const AABB& box)
+{
+	boxes[id] = box;
+	grid.update(id, box);
+	moved.push_back(id);
+}
+
+void SpatialIndex::remove(uint32_t id)
+{
+	if (id >= boxes.size() || !boxes[id].isValid())
+		return;
+
+	boxes[id] = AABB();
+	grid.remove(id);
+	objectCount--;
+	bvhDirty = true;
+}
+
+void SpatialIndex::commit()
+{
+	if (type != Type::BVH) {
+		moved.clear();
+		return;
+	}
+
+	if (bvhDirty) {
+		bvh.build(boxes);
+		bvhDirty = false;
+	} else {
+		for (uint32_t id : moved)
+			bvh.refit(id, boxes[id]);
+
+		if (bvh.isDegraded())
+			bvh.build(boxes);
+	}
+
+	moved.clear();
+}
+
+void SpatialIndex::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+	if (type == Type::BVH)
+		bvh.queryFrustum(frustum, out);
+	else
+		grid.queryFrustum(frustum, out);
+}
+
+void SpatialIndex::queryAABB(const AABB& area, std::vector<uint32_t>& out) const
+{
+	if (type == Type::BVH)
+		bvh.queryAABB(area, out);
+	else
+		grid.queryAABB(area, out);
+}
+
+void SpatialIndex::queryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const
+{
+	const size_t first = out.size();
+	queryAABB({ center - glm::vec3(radius), center + glm::vec3(radius) }, out);
+
+	// Keep the boxes that really touch the sphere
+	const float radius2 = radius * radius;
+	out.erase(std::remove_if(out.begin() + first, out.end(), [&](uint32_t id) {
+		const glm::vec3 closest = glm::clamp(center, boxes[id].min, boxes[id].max);
+		const glm::vec3 delta = closest - center;
+		return glm::dot(delta, delta) > radius2;
+	}), out.end());
+}
+
+void SpatialIndex::queryRay(const Ray& ray, float maxT, std::vector<uint32_t>& out) const
+{
+	if (type == Type::BVH)
+		bvh.queryRay(ray, maxT, out);
+	else
+		grid.queryRay(ray, maxT, out);
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <vector>
+#include "AABB.h"
+#include "Frustum.h"
+
+/**
+ * \brief Loose uniform grid over the XZ plane, aligned with the Renderer grid lines.
+ * Objects are stored in the cell containing their center, each cell keeps the union of its objects' boxes
+ * so queries only look at the objects of the cells they touch
+ */
+class LooseGrid
+{
+public:
+	/**
+	 * \param gridSize Number of grid units covered along X and Z (Renderer::GridSize)
+	 * \param cellSize Size of one cell in grid units
+	 */
+	void reset(int gridSize, int cellSize);
+
+	void insert(uint32_t id, const AABB& box);
+	void update(uint32_t id, const AABB& box);
+	void remove(uint32_t id);
+
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void queryAABB(const AABB& area, std::vector<uint32_t>& out) const;
+	void queryRay(const Ray& ray, float maxT, std::vector<uint32_t>& out) const;
+
+	int getCellSize() const { return cellSize; }
+	uint32_t getOccupiedCellCount() const { return (uint32_t)occupied.size(); }
+
+private:
+	struct Cell {
+		std::vector<uint32_t> objects;
+		AABB bounds;			// Union of the objects' boxes
+		int occupiedSlot = -1;	// position in LooseGrid::occupied
+	};
+
+	// Where an object is stored
+	struct Location {
+		int cell = -1;
+		uint32_t slot = 0;
+	};
+
+	int cellOf(const glm::vec3& point) const;
+	void detach(uint32_t id);
+	void attach(uint32_t id, int cell);
+	void refreshBounds(Cell& cell);
+
+	std::vector<Cell> cells;
+	std::vector<int> occupied;				// Indices of the non empty cells
+	std::vector<Location> locations;		// Indexed by object id
+	std::vector<AABB> objectBoxes;			// Indexed by object id
+	glm::vec2 origin = glm::vec2(0.0f);
+	int cellSize = 1;
+	int cellsPerAxis = 0;
+	float maxHalfSize = 0.0f;				// Largest object half size, how far objects leak out of their cell
+};
+
+/**
+ * \brief Bounding volume hierarchy built with the binned surface area heuristic.
+ * Moving objects only refit the path from their leaf to the root, the tree is rebuilt when it degrades
+ */
+class BVH
+{
+public:
+	void build(const std::vector<AABB>& boxes);
+
+	/**
+	 * \brief Updates an object's box and refits its ancestors
+	 */
+	void refit(uint32_t id, const AABB& box);
+
+	/**
+	 * \return true once the refits made the tree noticeably worse than when it was built
+	 */
+	bool isDegraded() const { return nodes.size() > 0 && currentCost > buildCost * 1.5f; }
+
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void queryAABB(const AABB& area, std::vector<uint32_t>& out) const;
+	void queryRay(const Ray& ray, float maxT, std::vector<uint32_t>& out) const;
+
+	uint32_t getNodeCount() const { return (uint32_t)nodes.size(); }
+
+private:
+	struct Node {
+		AABB bounds;
+		int left = -1;		// Children for inner nodes
+		int right = -1;
+		int parent = -1;
+		uint32_t first = 0;	// Range in BVH::objects for leaves
+		uint32_t count = 0;
+
+		bool isLeaf() const { return count > 0; }
+	};
+
+	int buildNode(uint32_t first, uint32_t count, int parent, const std::vector<AABB>& boxes);
+	float cost() const;
+
+	// Term of the node in cost(), the area weighted by the objects of leaves
+	static float nodeCost(const Node& node) { return node.bounds.surfaceArea() * (node.isLeaf() ? node.count : 1.0f); }
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> objects;		// Object ids ordered by leaf
+	std::vector<int> leafOf;			// Indexed by object id
+	std::vector<AABB> boxes;			// Indexed by object id
+	float buildCost = 0.0f;
+	float currentCost = 0.0f;			// cost(), kept up to date by refit
+};
+
+/**
+ * \brief Spatial acceleration structure for the scene objects. The loose grid is always kept up to date,
+ * the BVH is optional and refitted/rebuilt in commit()
+ */
+class SpatialIndex
+{
+public:
+	enum class Type { Grid = 0, BVH };
+
+	void reset(int gridSize, int cellSize = 4);
+
+	void insert(uint32_t id, const AABB& box);
+	void update(uint32_t id, const AABB& box);
+	void remove(uint32_t id);
+
+	/**
+	 * \brief Applies the pending changes to the BVH. Call once per frame before querying
+	 */
+	void commit();
+
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void queryAABB(const AABB& area, std::vector<uint32_t>& out) const;
+	void queryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+
+	/**
+	 * \brief Objects whose box is hit by the ray, in no particular order
+	 */
+	void queryRay(const Ray& ray, float maxT, std::vector<uint32_t>& out) const;
+
+	void setType(Type type) { this->type = type; bvhDirty = true; }
+	Type getType() const { return type; }
+
+	const AABB& getBounds(uint32_t id) const { return boxes[id]; }
+	uint32_t getObjectCount() const { return objectCount; }
+	const LooseGrid& getGrid() const { return grid; }
+	const BVH& getBVH() const { return bvh; }
+
+private:
+	Type type = Type::Grid;
+	LooseGrid grid;
+	BVH bvh;
+	std::vector<AABB> boxes;		// Indexed by object id, invalid boxes are free slots
+	std::vector<uint32_t> moved;	// Objects to refit in the BVH
+	uint32_t objectCount = 0;
+	bool bvhDirty = true;			// Objects were added or removed, the BVH must be rebuilt
+};
@@ -0,0 +1,133 @@
+#include "Systems.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+void Systems::movement(Registry& registry, float dt)
+{
+	SHADO_PROFILE_FUNCTION();
+
+	ComponentPool<Velocity>& velocities = registry.pool<Velocity>();
+	ComponentPool<Transform>& transforms = registry.pool<Transform>();
+
+	JobSystem::parallelFor(velocities.size(), 4096, [&](uint32_t begin, uint32_t end) {
+		const Velocity* velocity = velocities.data();
+		const Entity* entities = velocities.getEntities();
+		for (uint32_t i = begin; i < end; i++) {
+			Transform* transform = transforms.tryGet(entities[i]);
+			if (!transform)
+				continue;
+
+			transform->position += velocity[i].linear * dt;
+			transform->rotation = glm::normalize(Transform::fromEuler(velocity[i].angular * dt) * transform->rotation);
+		}
+	});
+}
+
+void Systems::transforms(Registry& registry)
+{
+	SHADO_PROFILE_FUNCTION();
+
+	ComponentPool<WorldTransform>& worlds = registry.pool<WorldTransform>();
+	ComponentPool<Transform>& locals = registry.pool<Transform>();
+	ComponentPool<Parent>& parents = registry.pool<Parent>();
+
+	// Roots, their world transform is the local one
+	JobSystem::parallelFor(worlds.size(), 4096, [&](uint32_t begin, uint32_t end) {
+		WorldTransform* world = worlds.data();
+		const Entity* entities = worlds.getEntities();
+		for (uint32_t i = begin; i < end; i++) {
+			if (parents.has(entities[i]))
+				continue;
+
+			const Transform* local = locals.tryGet(entities[i]);
+			world[i].matrix = local ? local->toMatrix() : glm::mat4(1.0f);
+		}
+	});
+
+	// Children, their parent is a root so its world transform is done
+	JobSystem::parallelFor(parents.size(), 4096, [&](uint32_t begin, uint32_t end) {
+		const Parent* parent = parents.data();
+		const Entity* entities = parents.getEntities();
+		for (uint32_t i = begin; i < end; i++) {
+			WorldTransform* world = worlds.tryGet(entities[i]);
+			const WorldTransform* parentWorld = worlds.tryGet(parent[i].entity);
+			if (!world || !parentWorld)
+				continue;
+
+			const Transform* local = locals.tryGet(entities[i]);
+			world->matrix = local ? parentWorld->matrix * local->toMatrix() : parentWorld->matrix;
+		}
+	});
+}
+
+void Systems::render(Registry& registry)
+{
+	SHADO_PROFILE_FUNCTION();
+
+	ComponentPool<MeshRenderer>& renderers = registry.pool<MeshRenderer>();
+	ComponentPool<WorldTransform>& worlds = registry.pool<WorldTransform>();
+	ComponentPool<Color>& colors = registry.pool<Color>();
+
+	const MeshRenderer* renderer = renderers.data();
+	const Entity* entities = renderers.getEntities();
+	const uint32_t count = renderers.size();
+
+	instances.resize(count);
+	uint32_t batchStart = 0;
+	uint32_t instanceCount = 0;
+
+	auto flush = [&](uint32_t i) {
+		if (instanceCount > batchStart) {
+			const MeshRenderer& batch = renderer[i];
+			Shader& shader = batch.shader ? *batch.shader : Renderer::getDefaultShader();
+			const int mode = batch.mode >= 0 ? batch.mode : Renderer::getRenderingMode();
+			Renderer::submit(batch.mesh, instances.data() + batchStart, instanceCount - batchStart, shader, mode);
+		}
+		batchStart = instanceCount;
+	};
+
+	uint32_t batchRenderer = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		const MeshRenderer& current = renderer[i];
+		const MeshRenderer& batch = renderer[batchRenderer];
+		if (current.mesh != batch.mesh || current.shader != batch.shader || current.mode != batch.mode) {
+			flush(batchRenderer);
+			batchRenderer = i;
+		}
+
+		const WorldTransform* world = worlds.tryGet(entities[i]);
+		if (!world)
+			continue;
+
+		const Color* color = colors.tryGet(entities[i]);
+		instances[instanceCount++] = { world->matrix, color ? color->value : glm::vec4(1.0f) };
+	}
+	flush(batchRenderer);
+}
+
+bool Systems::lights(Registry& registry, Light& light)
+{
+	ComponentPool<Light>& lights = registry.pool<Light>();
+	if (lights.size() == 0)
+		return false;
+
+	light = lights.data()[0];
+	return true;
+}
+
+void Systems::pointLights(Registry& registry)
+{
+	registry.each<PointLight, Transform>([](Entity entity, const PointLight& light, const Transform& transform) {
+		Renderer::submitLight(transform.position, light);
+	});
+}
+
+void Systems::destroyHierarchy(Registry& registry, Entity root)
+{
+	if (const Children* children = registry.tryGet<Children>(root)) {
+		for (Entity child : children->entities)
+			registry.destroy(child);
+	}
+	registry.destroy(root);
+}
+
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "Components.h"
+#include "Renderer.h"
+
+/**
+ * \brief Systems of the ECS: each one walks the dense arrays of the components it needs,
+ * in parallel on the JobSystem when the work is large enough
+ */
+class Systems
+{
+public:
+	/**
+	 * \brief Integrates the Velocity of every entity into its Transform
+	 */
+	static void movement(Registry& registry, float dt);
+
+	/**
+	 * \brief Computes the WorldTransform of every entity, the roots first then their children
+	 */
+	static void transforms(Registry& registry);
+
+	/**
+	 * \brief Queues every entity with a WorldTransform, a MeshRenderer and a Color. Consecutive entities
+	 * sharing a mesh, a shader and a mode are submitted as one batch
+	 */
+	static void render(Registry& registry);
+
+	/**
+	 * \brief Copies the first Light component to the light used by the Renderer
+	 * \return false if there is no light entity
+	 */
+	static bool lights(Registry& registry, Light& light);
+
+	/**
+	 * \brief Queues every entity with a PointLight and a Transform for the clustered lighting
+	 */
+	static void pointLights(Registry& registry);
+
+	/**
+	 * \brief Destroys an entity and its Children
+	 */
+	static void destroyHierarchy(Registry& registry, Entity root);
+
+private:
+	inline static std::vector<InstanceData> instances;
+};
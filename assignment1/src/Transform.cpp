@@ -0,0 +1,43 @@
+#include "Transform.h"
+#include <cmath>
+
+glm::mat4 Transform::toMatrix(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& origin, const glm::vec3& scale)
+{
+	const glm::mat3 r = glm::mat3_cast(rotation);
+	return glm::mat4(
+		glm::vec4(r[0] * scale.x, 0.0f),
+		glm::vec4(r[1] * scale.y, 0.0f),
+		glm::vec4(r[2] * scale.z, 0.0f),
+		glm::vec4(origin + r * (position - origin), 1.0f));
+}
+
+glm::quat Transform::fromEuler(const glm::vec3& degrees)
+{
+	return glm::angleAxis(glm::radians(degrees.x), glm::vec3(1, 0, 0))
+		* glm::angleAxis(glm::radians(degrees.y), glm::vec3(0, 1, 0))
+		* glm::angleAxis(glm::radians(degrees.z), glm::vec3(0, 0, 1));
+}
+
+glm::vec3 Transform::toEuler(const glm::quat& rotation)
+{
+	// Column major, m[column][row] of rotateX * rotateY * rotateZ
+	const glm::mat3 m = glm::mat3_cast(rotation);
+	const float sinY = glm::clamp(m[2][0], -1.0f, 1.0f);
+
+	glm::vec3 radians;
+	radians.y = std::asin(sinY);
+	if (std::abs(sinY) < 0.9999f) {
+		radians.x = std::atan2(-m[2][1], m[2][2]);
+		radians.z = std::atan2(-m[1][0], m[0][0]);
+	} else {
+		// Gimbal lock, x and z turn around the same axis
+		radians.x = std::atan2(m[1][2], m[1][1]);
+		radians.z = 0.0f;
+	}
+	return glm::degrees(radians);
+}
+
+Transform Transform::mix(const Transform& a, const Transform& b, float alpha)
+{
+	return { glm::mix(a.position, b.position, alpha), glm::slerp(a.rotation, b.rotation, alpha), glm::mix(a.scale, b.scale, alpha) };
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/**
+ * \brief Position, rotation and scale. The rotation is a quaternion converted straight to a matrix,
+ * Euler angles are only used at the edges (UI, drawCube)
+ */
+struct Transform {
+	glm::vec3 position = glm::vec3(0);
+	glm::quat rotation = glm::quat(1, 0, 0, 0);
+	glm::vec3 scale = glm::vec3(1);
+
+	/**
+	 * \brief translate * rotate * scale
+	 */
+	glm::mat4 toMatrix() const { return toMatrix(position, rotation, position, scale); }
+
+	/**
+	 * \brief Rotates around origin instead of the position: translate(origin) * rotate * translate(position - origin) * scale
+	 */
+	static glm::mat4 toMatrix(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& origin, const glm::vec3& scale);
+
+	/**
+	 * \brief Same rotation as glm::rotate around x, then y, then z (the order drawCube always used)
+	 * \param degrees Euler angles in degrees
+	 */
+	static glm::quat fromEuler(const glm::vec3& degrees);
+
+	/**
+	 * \return Euler angles in degrees, fromEuler(toEuler(q)) is q
+	 */
+	static glm::vec3 toEuler(const glm::quat& rotation);
+
+	/**
+	 * \brief Interpolates the position and the scale linearly, the rotation along the shortest arc
+	 */
+	static Transform mix(const Transform& a, const Transform& b, float alpha);
+};
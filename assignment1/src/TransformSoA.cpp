@@ -0,0 +1,214 @@
+#include "TransformSoA.h"
+#include <emmintrin.h>
+#include <glm/gtx/transform.hpp>
+#include "Renderer.h"
+#ifdef __AVX2__
+	#include <immintrin.h>
+#endif
+
+namespace {
+	// The kernel is written once against these wrappers, for 4 (SSE) or 8 (AVX2) lanes
+	struct SSE {
+		using V = __m128;
+		static constexpr uint32_t Width = 4;
+
+		static V set1(float x) { return _mm_set1_ps(x); }
+		static V load(const float* p) { return _mm_loadu_ps(p); }
+		static V add(V a, V b) { return _mm_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+		static V signIfNegative(V a) { return _mm_and_ps(_mm_cmplt_ps(a, _mm_setzero_ps()), _mm_set1_ps(-0.0f)); }
+		static V flipSign(V a, V sign) { return _mm_xor_ps(a, sign); }
+
+		// Lane i of (x, y, z, w) is written to the 4 floats at first + i instances
+		static void transposeStore(V x, V y, V z, V w, float* first) {
+			constexpr size_t stride = sizeof(InstanceData) / sizeof(float);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(first, x);
+			_mm_storeu_ps(first + stride, y);
+			_mm_storeu_ps(first + stride * 2, z);
+			_mm_storeu_ps(first + stride * 3, w);
+		}
+
+		// columns[c][r]: row r of column c for every lane, stored as one column major matrix per lane
+		static void store(const V columns[4][3], const V normals[3][3], InstanceData* out) {
+			const V zero = _mm_setzero_ps();
+			for (int c = 0; c < 4; c++)
+				transposeStore(columns[c][0], columns[c][1], columns[c][2], c == 3 ? _mm_set1_ps(1.0f) : zero, &out[0].transform[c][0]);
+			for (int c = 0; c < 3; c++)
+				transposeStore(normals[c][0], normals[c][1], normals[c][2], zero, &out[0].normalMatrix[c][0]);
+		}
+	};
+
+#ifdef __AVX2__
+	struct AVX2 {
+		using V = __m256;
+		static constexpr uint32_t Width = 8;
+
+		static V set1(float x) { return _mm256_set1_ps(x); }
+		static V load(const float* p) { return _mm256_loadu_ps(p); }
+		static V add(V a, V b) { return _mm256_add_ps(a, b); }
+		static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+		static V signIfNegative(V a) { return _mm256_and_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_LT_OQ), _mm256_set1_ps(-0.0f)); }
+		static V flipSign(V a, V sign) { return _mm256_xor_ps(a, sign); }
+
+		// Each half goes through the SSE transpose
+		static void store(const V columns[4][3], const V normals[3][3], InstanceData* out) {
+			SSE::V low[4][3], high[4][3];
+			SSE::V lowNormals[3][3], highNormals[3][3];
+			for (int c = 0; c < 4; c++) {
+				for (int r = 0; r < 3; r++) {
+					low[c][r] = _mm256_castps256_ps128(columns[c][r]);
+					high[c][r] = _mm256_extractf128_ps(columns[c][r], 1);
+					if (c < 3) {
+						lowNormals[c][r] = _mm256_castps256_ps128(normals[c][r]);
+						highNormals[c][r] = _mm256_extractf128_ps(normals[c][r], 1);
+					}
+				}
+			}
+			SSE::store(low, lowNormals, out);
+			SSE::store(high, highNormals, out + 4);
+		}
+	};
+#endif
+
+	template<typename S>
+	uint32_t composeLanes(const TransformColumns& transforms, uint32_t begin, uint32_t end, InstanceData* out)
+	{
+		const float* const* position = transforms.position;
+		const float* const* rotation = transforms.rotation;
+		const float* const* scale = transforms.scale;
+		using V = typename S::V;
+		const V one = S::set1(1.0f);
+		const V two = S::set1(2.0f);
+
+		uint32_t i = begin;
+		for (; i + S::Width <= end; i += S::Width) {
+			const V x = S::load(&rotation[0][i]), y = S::load(&rotation[1][i]);
+			const V z = S::load(&rotation[2][i]), w = S::load(&rotation[3][i]);
+			const V sx = S::load(&scale[0][i]), sy = S::load(&scale[1][i]), sz = S::load(&scale[2][i]);
+
+			// Quaternion to rotation matrix (same as glm::mat3_cast), one column per axis, scaled
+			const V x2 = S::mul(x, two), y2 = S::mul(y, two), z2 = S::mul(z, two);
+			const V xx = S::mul(x, x2), yy = S::mul(y, y2), zz = S::mul(z, z2);
+			const V xy = S::mul(x, y2), xz = S::mul(x, z2), yz = S::mul(y, z2);
+			const V wx = S::mul(w, x2), wy = S::mul(w, y2), wz = S::mul(w, z2);
+
+			const V rotationColumns[3][3] = {
+				{ S::sub(one, S::add(yy, zz)), S::add(xy, wz), S::sub(xz, wy) },
+				{ S::sub(xy, wz), S::sub(one, S::add(xx, zz)), S::add(yz, wx) },
+				{ S::add(xz, wy), S::sub(yz, wx), S::sub(one, S::add(xx, yy)) },
+			};
+
+			// Normal matrix of R * S: R * S^-1 times the determinant, the cofactor scales need no division
+			const V cofactors[3] = { S::mul(sy, sz), S::mul(sz, sx), S::mul(sx, sy) };
+			const V sign = S::signIfNegative(S::mul(sx, cofactors[0]));
+
+			V columns[4][3];
+			V normals[3][3];
+			const V scales[3] = { sx, sy, sz };
+			for (int c = 0; c < 3; c++) {
+				for (int r = 0; r < 3; r++) {
+					columns[c][r] = S::mul(rotationColumns[c][r], scales[c]);
+					normals[c][r] = S::flipSign(S::mul(rotationColumns[c][r], cofactors[c]), sign);
+				}
+			}
+			for (int r = 0; r < 3; r++)
+				columns[3][r] = S::load(&position[r][i]);
+
+			S::store(columns, normals, out + (i - begin));
+		}
+		return i;
+	}
+}
+
+uint32_t TransformSoA::add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	const uint32_t index = size();
+	resize(index + 1);
+	set(index, position, rotation, scale);
+	return index;
+}
+
+void TransformSoA::set(uint32_t index, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	for (int axis = 0; axis < 3; axis++) {
+		this->position[axis][index] = position[axis];
+		this->scale[axis][index] = scale[axis];
+	}
+	this->rotation[0][index] = rotation.x;
+	this->rotation[1][index] = rotation.y;
+	this->rotation[2][index] = rotation.z;
+	this->rotation[3][index] = rotation.w;
+}
+
+void TransformSoA::resize(uint32_t count)
+{
+	for (int axis = 0; axis < 3; axis++) {
+		position[axis].resize(count, 0.0f);
+		rotation[axis].resize(count, 0.0f);
+		scale[axis].resize(count, 1.0f);
+	}
+	rotation[3].resize(count, 1.0f);	// Identity
+}
+
+TransformColumns TransformSoA::getColumns() const
+{
+	TransformColumns columns;
+	for (int axis = 0; axis < 3; axis++) {
+		columns.position[axis] = position[axis].data();
+		columns.scale[axis] = scale[axis].data();
+	}
+	for (int component = 0; component < 4; component++)
+		columns.rotation[component] = rotation[component].data();
+	columns.count = size();
+	return columns;
+}
+
+void TransformSoA::compose(const TransformColumns& transforms, uint32_t begin, uint32_t end, InstanceData* out)
+{
+#ifdef __AVX2__
+	const uint32_t done = composeLanes<AVX2>(transforms, begin, end, out);
+#else
+	const uint32_t done = composeLanes<SSE>(transforms, begin, end, out);
+#endif
+
+	// Fewer transforms left than lanes
+	composeScalar(transforms, done, end, out + (done - begin));
+}
+
+void TransformSoA::composeScalar(const TransformColumns& transforms, uint32_t begin, uint32_t end, InstanceData* out)
+{
+	const float* const* position = transforms.position;
+	const float* const* rotation = transforms.rotation;
+	const float* const* scale = transforms.scale;
+	for (uint32_t i = begin; i < end; i++) {
+		const glm::vec3 pos = { position[0][i], position[1][i], position[2][i] };
+		const glm::quat rot = { rotation[3][i], rotation[0][i], rotation[1][i], rotation[2][i] };
+		const glm::vec3 size = { scale[0][i], scale[1][i], scale[2][i] };
+		out[i - begin].transform = Transform::toMatrix(pos, rot, pos, size);
+		out[i - begin].computeNormalMatrix();
+	}
+}
+
+void TransformSoA::composeGlm(uint32_t begin, uint32_t end, InstanceData* out) const
+{
+	for (uint32_t i = begin; i < end; i++) {
+		const glm::vec3 pos = { position[0][i], position[1][i], position[2][i] };
+		const glm::quat rot = { rotation[3][i], rotation[0][i], rotation[1][i], rotation[2][i] };
+		const glm::vec3 size = { scale[0][i], scale[1][i], scale[2][i] };
+
+		out[i - begin].transform = glm::translate(glm::mat4(1.0), pos) * glm::mat4_cast(rot) * glm::scale(glm::mat4(1.0), size);
+		out[i - begin].computeNormalMatrix();
+	}
+}
+
+const char* TransformSoA::getInstructionSet()
+{
+#ifdef __AVX2__
+	return "AVX2";
+#else
+	return "SSE2";
+#endif
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Transform.h"
+
+struct InstanceData;
+
+// Non owning view of count transforms stored as columns, the arrays of a TransformSoA or of a mapped scene file
+struct TransformColumns {
+	const float* position[3];
+	const float* rotation[4];		// Quaternion x, y, z, w
+	const float* scale[3];
+	uint32_t count;
+};
+
+/**
+ * \brief Transforms stored as a structure of arrays: one array per component of the position,
+ * the rotation quaternion and the scale. The world matrices are composed 4 at a time with SSE,
+ * 8 at a time when built with AVX2, straight into the instance buffer of the Renderer
+ */
+class TransformSoA
+{
+public:
+	uint32_t add(const glm::vec3& position, const glm::quat& rotation = glm::quat(1, 0, 0, 0), const glm::vec3& scale = glm::vec3(1));
+	void set(uint32_t index, const glm::vec3& position, const glm::quat& rotation = glm::quat(1, 0, 0, 0), const glm::vec3& scale = glm::vec3(1));
+	void resize(uint32_t count);
+	void clear() { resize(0); }
+	uint32_t size() const { return (uint32_t)position[0].size(); }
+
+	/**
+	 * \brief Writes translate * rotate * scale of the transforms [begin, end) to out[0 .. end - begin),
+	 * the same matrix as Transform::toMatrix, and its normal matrix (see InstanceData::computeNormalMatrix).
+	 * The colour of out is not written
+	 */
+	void compose(uint32_t begin, uint32_t end, InstanceData* out) const { compose(getColumns(), begin, end, out); }
+	static void compose(const TransformColumns& transforms, uint32_t begin, uint32_t end, InstanceData* out);
+
+	/**
+	 * \brief Reference path, one glm matrix product per transform
+	 */
+	void composeGlm(uint32_t begin, uint32_t end, InstanceData* out) const;
+
+	/**
+	 * \return Name of the instruction set used by compose
+	 */
+	static const char* getInstructionSet();
+
+	TransformColumns getColumns() const;
+
+	float* getPositions(int axis) { return position[axis].data(); }
+	float* getRotations(int component) { return rotation[component].data(); }	// x, y, z, w
+	float* getScales(int axis) { return scale[axis].data(); }
+
+private:
+	static void composeScalar(const TransformColumns& transforms, uint32_t begin, uint32_t end, InstanceData* out);
+
+	std::vector<float> position[3];
+	std::vector<float> rotation[4];		// Quaternion x, y, z, w
+	std::vector<float> scale[3];
+};
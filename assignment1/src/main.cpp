@@ -1,17 +1,64 @@
 #include <iostream>
+#include <cstring>
 #include "SceneManager.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "MeshCooker.h"
+#include "SceneCompiler.h"
 
 int main(int argc, const char** argv) {
 	const float window_scale = 2.0f;
 	const uint32_t window_width = 1024, window_height = 786;
 
+	// Benchmarks and offline tools only, no window
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--benchmark") == 0) {
+			JobSystem::init();
+			Benchmark::print(Benchmark::runAll());
+			JobSystem::shutdown();
+			return 0;
+		}
+
+		if (std::strcmp(argv[i], "--cook") == 0) {
+			if (i + 2 >= argc) {
+				std::cout << "Usage: --cook input.obj|input.gltf|input.glb output.mesh [--no-optimize]" << std::endl;
+				return 1;
+			}
+			const bool optimize = i + 3 >= argc || std::strcmp(argv[i + 3], "--no-optimize") != 0;
+			return MeshCooker::cook(argv[i + 1], argv[i + 2], optimize) ? 0 : 1;
+		}
+
+		if (std::strcmp(argv[i], "--compile-scene") == 0) {
+			if (i + 2 >= argc) {
+				std::cout << "Usage: --compile-scene input.json output.scene" << std::endl;
+				return 1;
+			}
+			return SceneCompiler::compile(argv[i + 1], argv[i + 2]) ? 0 : 1;
+		}
+	}
+
 	// Init scene
 	SceneManager scene(window_width * window_scale, window_height * window_scale);
 
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--render-thread") == 0)
+			scene.setRenderThreadEnabled(true);
+	}
+
 	// Main game stuff
 	// Get and compile shader
 	scene.onCreate();
 
+	// Cooked meshes to place in the scene, then the scene file
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::strcmp(argv[i], "--mesh") == 0)
+			scene.loadMesh(argv[++i]);
+	}
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::strcmp(argv[i], "--scene") == 0)
+			scene.loadScene(argv[++i]);
+	}
+
 	// Game loop
 	scene.run();
 	